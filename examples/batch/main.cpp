@@ -0,0 +1,343 @@
+////////////////////////////////////////////////////////////////////////////////
+#include "config.h"
+#include "culling.h"
+#include "error.h"
+#include "io.h"
+#include "log.h"
+#include "task_queue.h"
+#include "glframebuffer.h"
+#include "glheadless_context.h"
+#include "glmaterial.h"
+#include "glmaterial_table.h"
+#include "glmodel.h"
+#include "glprogram.h"
+#include "glprogram_cache.h"
+#include "glprogram_permutations.h"
+#include "glreadback_ring.h"
+#include "glrender_queue.h"
+#include "glshader_loader.h"
+#include "gltexture_loader.h"
+#include "gluniform_blocks.h"
+
+////////////////////////////////////////////////////////////////////////////////
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+////////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+#define WINDOW_TITLE    "Lovelace Engine Batch"
+
+////////////////////////////////////////////////////////////////////////////////
+#define DEFAULT_POSES   LOVELACE_ROOT_DIR "examples/batch/poses.txt"
+#define DEFAULT_OUTPUT  "batch"
+#define NEAR_PLANE      0.01f
+#define FAR_PLANE       100.0f
+
+////////////////////////////////////////////////////////////////////////////////
+#define SUCCESS         0x0     // program finished successfully
+#define WINDOW_ERR      0x1     // window initialization failed
+#define GLAD_ERR        0x2     // could't initialize GLAD
+#define INIT_ERR        0x3     // GLFW initialization failed
+#define EXCEPT_ERR      0x4     // an exception has occurred
+#define USAGE_ERR       0x5     // unknown or malformed arguments
+
+////////////////////////////////////////////////////////////////////////////////
+struct options
+{
+        std::string backend             = al::gl::headless_context::isSupported() ? "egl" : "glfw";
+        std::string poses               = DEFAULT_POSES;
+        std::string output              = DEFAULT_OUTPUT;
+        int repeat                      = 1;
+        int slots                       = static_cast<int>(al::gl::READBACK_SLOTS);
+        int threads                     = std::max(1u, al::worker_pool::defaultThreads());
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// angles in degrees, pitch and yaw as fpscamera has them: yaw -90 looks down -z
+struct pose
+{
+        glm::vec3 mPosition             = glm::vec3(0.0f);
+        float mPitch                    = 0.0f;
+        float mYaw                      = -90.0f;
+        float mRoll                     = 0.0f;
+        float mFov                      = 90.0f;        // vertical
+        int mWidth                      = 0;
+        int mHeight                     = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static bool parseOptions(int argc, char** argv, options& o)
+{
+        // std::stoi throws on a value that isn't a number, that is a usage error too
+        try {
+                for (int i = 1; i < argc; ++i) {
+                        std::string arg = argv[i];
+                        if (i + 1 >= argc)
+                                return false;
+                        std::string value = argv[++i];
+
+                        if (arg == "--backend" && (value == "egl" || value == "glfw"))
+                                o.backend = value;
+                        else if (arg == "--poses")
+                                o.poses = value;
+                        else if (arg == "--output")
+                                o.output = value;
+                        else if (arg == "--repeat")
+                                o.repeat = std::stoi(value);
+                        else if (arg == "--slots")
+                                o.slots = std::stoi(value);
+                        else if (arg == "--threads")
+                                o.threads = std::stoi(value);
+                        else
+                                return false;
+                }
+        }
+        catch (const std::exception&) {
+                return false;
+        }
+        return o.repeat > 0 && o.slots > 0 && o.threads >= 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// one pose per line, "x y z pitch yaw roll fov width height"; blank lines and lines
+// starting with # are skipped
+static std::vector<pose> loadPoses(const std::string& url)
+{
+        std::istringstream file(al::read(url));
+        std::vector<pose> poses;
+        std::string line;
+        for (size_t number = 1; std::getline(file, line); ++number) {
+                size_t first = line.find_first_not_of(" \t\r");
+                if (first == std::string::npos || line[first] == '#')
+                        continue;
+
+                pose p;
+                std::istringstream fields(line);
+                fields >> p.mPosition.x >> p.mPosition.y >> p.mPosition.z >> p.mPitch >> p.mYaw >> p.mRoll
+                       >> p.mFov >> p.mWidth >> p.mHeight;
+                if (!fields || p.mWidth <= 0 || p.mHeight <= 0 || p.mFov <= 0.0f || p.mFov >= 180.0f)
+                        throw al::exception("", "", "loadPoses", url + ":" + std::to_string(number) + ": malformed pose", al::etype::unexpected);
+                poses.push_back(p);
+        }
+        if (poses.empty())
+                throw al::exception("", "", "loadPoses", "no poses in " + url, al::etype::unexpected);
+        return poses;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static glm::mat4 poseView(const pose& p)
+{
+        float pitch = glm::radians(p.mPitch), yaw = glm::radians(p.mYaw), roll = glm::radians(p.mRoll);
+        glm::vec3 direction(glm::cos(yaw) * glm::cos(pitch), glm::sin(pitch), glm::sin(yaw) * glm::cos(pitch));
+        glm::vec3 right = glm::normalize(glm::cross(direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+        glm::vec3 up = glm::cross(right, direction);
+        up = glm::cos(roll) * up + glm::sin(roll) * right;
+        return glm::lookAt(p.mPosition, p.mPosition + direction, up);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// renders the poses back to back, the GL thread never waits for an image: each one
+// is copied out through the readback ring while the next poses render, and the
+// copies that are done go to the encoder threads to be written as PPM files
+static void renderBatch(const options& o)
+{
+        std::vector<pose> poses = loadPoses(o.poses);
+        std::filesystem::create_directories(o.output);
+        std::cout << "[batch] " << o.backend << ": " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << '\n';
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+
+        al::gl::texture_loader textureLoader;
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_cache programCache(LOVELACE_ROOT_DIR ".cache/programs/");
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl", &programCache);
+        al::gl::model sponza(LOVELACE_ROOT_DIR "models/sponza/Sponza.gltf", textureLoader);
+
+        al::dir_light sun = {
+                glm::vec3(0.2f, 0.2f, 0.2f),            // ambient
+                glm::vec3(1.0f, 1.0f, 1.0f),            // diffuse
+                glm::vec3(1.0f, 1.0f, 1.0f),            // specular
+                glm::vec3(glm::cos(glm::radians(-60.0f)), glm::sin(glm::radians(-60.0f)), 0.0f),      // direction
+                0.5f                                    // intensity
+        };
+
+        al::gl::phong_material sponzaMat;
+        sponzaMat.mEnableAmbientTexture = true;
+        sponzaMat.mEnableDiffuseTexture = true;
+        sponzaMat.mEnableSpecularTexture = true;
+        al::gl::material_table materials;
+        int sponzaMatIndex = materials.add(sponzaMat);
+        materials.upload();
+
+        al::gl::shader_features phongFeatures;
+        phongFeatures.mNumDirLights = 1;
+        phongFeatures.mNumPointLights = 0;
+        phongFeatures.mNumSpotLights = 0;
+        phongFeatures.mUniformBlocks = true;
+        phongFeatures.mMaterialTable = true;
+        al::gl::program& program = *phongPrograms.get(al::gl::specialize(phongFeatures, sponzaMat));
+        program.use();
+        materials.attach(program);
+        program.uniform("uTexMultiplier", glm::vec2(1.0f, 1.0f));
+
+        glm::mat4 sponzaModel = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
+        al::cull_set sponzaBounds;
+        sponzaBounds.reserve(sponza.getNumMeshes());
+        for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                sponzaBounds.add(sponza.getMeshes()[i].getBounds(), sponzaModel * sponza.getMeshTransform(i));
+
+        al::gl::frame_blocks frameBlocks;
+        al::gl::render_queue renderQueue(&materials);
+        std::vector<unsigned char> visible;
+
+        // one target per resolution, poses of the same size share it
+        std::map<std::pair<int, int>, std::unique_ptr<al::gl::framebuffer>> targets;
+        al::gl::readback_ring ring(static_cast<size_t>(o.slots));
+
+        // at most two images queued per encoder, past that rendering waits for them
+        std::atomic<size_t> failures{0};
+        al::task_queue encoders(static_cast<unsigned>(o.threads), 2 * static_cast<size_t>(o.threads));
+        auto encode = [&](al::gl::readback& r) {
+                auto image = std::make_shared<al::gl::readback>(std::move(r));
+                encoders.push([&, image] {
+                        char name[32];
+                        std::snprintf(name, sizeof(name), "%06llu.ppm", static_cast<unsigned long long>(image->mTag));
+                        try {
+                                al::writePPM((std::filesystem::path(o.output) / name).string(), image->mWidth, image->mHeight, image->mPixels.data());
+                        }
+                        catch (const std::exception& e) {
+                                al::log(std::cerr, __FILE__, __LINE__, e.what());
+                                ++failures;
+                        }
+                });
+        };
+
+        size_t count = poses.size() * static_cast<size_t>(o.repeat);
+        al::gl::readback image;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; ++i) {
+                const pose& p = poses[i % poses.size()];
+                auto& target = targets[{ p.mWidth, p.mHeight }];
+                if (!target)
+                        target = std::make_unique<al::gl::framebuffer>(p.mWidth, p.mHeight, std::vector<int>{ GL_RGBA8 });
+
+                glm::mat4 projection = glm::perspective(glm::radians(p.mFov), static_cast<float>(p.mWidth) / p.mHeight, NEAR_PLANE, FAR_PLANE);
+                glm::mat4 view = poseView(p);
+
+                target->bind();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                frameBlocks.setCamera(projection, view, p.mPosition);
+                frameBlocks.setLights({ sun }, {}, {});
+                frameBlocks.upload();
+
+                program.use();
+                materials.bind();
+                sponzaBounds.cull(al::frustum(projection * view), visible);
+                sponza.submit(renderQueue, program, sponzaModel, visible, 0.0f, sponzaMatIndex);
+                renderQueue.execute();
+
+                // a slot is only waited on when the GPU is a whole ring behind
+                if (ring.isFull() && ring.resolve(image, true))
+                        encode(image);
+                ring.read(*target, i);
+                while (ring.resolve(image))
+                        encode(image);
+        }
+        std::chrono::duration<double> renderTime = std::chrono::steady_clock::now() - start;
+
+        while (ring.resolve(image, true))
+                encode(image);
+        encoders.wait();
+        std::chrono::duration<double> totalTime = std::chrono::steady_clock::now() - start;
+        program.halt();
+
+        const al::gl::readback_stats& stats = ring.getStats();
+        std::cout << "[batch] " << count << " images in " << totalTime.count() << " s: " << count / totalTime.count() << " images/s, "
+                  << count / renderTime.count() << " submitted/s\n";
+        std::cout << "[batch] readback: " << o.slots << " slots, waited on " << stats.mWaits << " of " << stats.mReads << " for "
+                  << stats.mWaitTime << " ms; " << o.threads << " encoder threads\n";
+        if (failures)
+                throw al::exception("", "", "renderBatch", std::to_string(failures.load()) + " images couldn't be written", al::etype::unexpected);
+        std::cout << "[batch] wrote " << o.output << '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+        options o;
+        if (!parseOptions(argc, argv, o)) {
+                std::cerr << "usage: " << argv[0] << " [--backend egl|glfw] [--poses poses.txt] [--output dir] [--repeat n] [--slots n] [--threads n]\n";
+                return USAGE_ERR;
+        }
+
+        if (o.backend == "egl") {
+                try {
+                        al::gl::headless_context context(1, 1);
+                        renderBatch(o);
+                }
+                catch (const std::exception& e) {
+                        al::log(std::cerr, __FILE__, __LINE__, e.what());
+                        return EXCEPT_ERR;
+                }
+                return SUCCESS;
+        }
+
+        // the window is never shown, nor swapped, so vsync doesn't get in the way
+        if (!glfwInit()) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLFW] Error: failed to initialized");
+                return INIT_ERR;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(1, 1, WINDOW_TITLE, nullptr, nullptr);
+        if (!window) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLFW] Error: couldn't create a window");
+                glfwTerminate();
+                return WINDOW_ERR;
+        }
+
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLAD] Error: couldn't initialize GLAD");
+                glfwTerminate();
+                return GLAD_ERR;
+        }
+        glfwSwapInterval(0);
+
+        try {
+                renderBatch(o);
+        }
+        catch (const std::exception& e) {
+                al::log(std::cerr, __FILE__, __LINE__, e.what());
+                glfwTerminate();
+                return EXCEPT_ERR;
+        }
+
+        glfwTerminate();
+        return SUCCESS;
+}
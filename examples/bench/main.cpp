@@ -0,0 +1,1859 @@
+////////////////////////////////////////////////////////////////////////////////
+#include "config.h"
+#include "culling.h"
+#include "fpscamera.h"
+#include "error.h"
+#include "log.h"
+#include "occlusion.h"
+#include "light_grid.h"
+#include "scene_graph.h"
+#include "lights.h"
+#include "glmaterial.h"
+#include "glmaterial_table.h"
+#include "glgeometry_pool.h"
+#include "glindirect_queue.h"
+#include "glinstance_buffer.h"
+#include "glclustered_lights.h"
+#include "glcommand_list.h"
+#include "gldeferred_renderer.h"
+#include "gldepth_prepass.h"
+#include "gldynamic_resolution.h"
+#include "glmesh.h"
+#include "glocclusion_queries.h"
+#include "glrender_queue.h"
+#include "glshadow_atlas.h"
+#include "glshadow_cascades.h"
+#include "glstate.h"
+#include "glstream_buffer.h"
+#include "gltexture_loader.h"
+#include "glshader_loader.h"
+#include "glprogram.h"
+#include "glprogram_permutations.h"
+#include "gluniform_blocks.h"
+#include "worker_pool.h"
+
+////////////////////////////////////////////////////////////////////////////////
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+////////////////////////////////////////////////////////////////////////////////
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <algorithm>
+#include <memory>
+
+////////////////////////////////////////////////////////////////////////////////
+#define WINDOW_TITLE    "Lovelace Engine Benchmarks"
+#define WINDOW_WIDTH    1280
+#define WINDOW_HEIGHT   720
+
+////////////////////////////////////////////////////////////////////////////////
+#define SUCCESS         0x0     // program finished successfully
+#define WINDOW_ERR      0x1     // window initialization failed
+#define GLAD_ERR        0x2     // could't initialize GLAD
+#define INIT_ERR        0x3     // GLFW initialization failed
+#define EXCEPT_ERR      0x4     // an exception has occurred
+
+////////////////////////////////////////////////////////////////////////////////
+#define UNIFORM_ITERATIONS      20000
+#define BLOCK_ITERATIONS        2000
+#define BLOCK_PROGRAMS          8
+#define REDUNDANT_FRAMES        2000
+#define REDUNDANT_OBJECTS       64
+#define MATERIAL_FRAMES         500
+#define MATERIAL_DRAWS          1024
+#define MATERIAL_COUNT          64
+#define QUEUE_FRAMES            200
+#define QUEUE_MESHES            512
+#define QUEUE_TEXTURES          16
+#define QUEUE_PROGRAMS          4
+#define STATE_FRAMES            200
+#define STATE_MESHES            512
+#define STATE_RUN               8
+#define CULL_FRAMES             200
+#define CULL_BOXES              16384
+#define CULL_EXTENT             500.0f
+#define SCENE_NODES             131072
+#define SCENE_FANOUT            8
+#define SCENE_ITERATIONS        20
+#define SCENE_MOVED             64
+#define INSTANCE_FRAMES         50
+#define INSTANCE_COUNT          4096
+#define INDIRECT_FRAMES         200
+#define INDIRECT_MESHES         2048
+#define INDIRECT_TEXTURES       8
+#define OCCLUSION_FRAMES        50
+#define OCCLUSION_WIDTH         256
+#define OCCLUSION_HEIGHT        128
+#define OCCLUSION_WALLS         16
+#define OCCLUSION_BOXES         16384
+#define QUERY_FRAMES            50
+#define QUERY_HIDDEN            256
+#define QUERY_SHOWN             64
+#define QUERY_DETAIL            8       // cubes along each side of a hidden object
+#define PREPASS_FRAMES          20
+#define PREPASS_LAYERS          16
+#define PREPASS_LIGHTS          32
+#define CLUSTER_FRAMES          10
+#define CLUSTER_BUILDS          100
+#define CLUSTER_AREA            200.0f  // side of the floor the lights are scattered over
+#define CLUSTER_RANGE           8.0f
+#define DEFERRED_FRAMES         10
+#define DEFERRED_LAYERS         8
+#define SHADOW_FRAMES           60
+#define SHADOW_GRID             24      // pillars along each side of the floor
+#define SHADOW_DYNAMIC          8       // cubes circling in front of the camera
+#define SHADOW_SIZE             1024
+#define ATLAS_FRAMES            30
+#define ATLAS_GRID              16      // pillars along each side of the floor
+#define ATLAS_LIGHTS            48      // shadowed point lights between the pillars
+#define ATLAS_DYNAMIC           4       // cubes circling in one corner of the floor
+#define RESOLUTION_FRAMES       40      // per phase: light, heavy, light again
+#define RESOLUTION_LIGHT        2       // overlapping layers of each phase, every one shaded
+#define RESOLUTION_HEAVY        12
+#define RESOLUTION_LIGHTS       32
+#define STREAM_FRAMES_RUN       30
+#define STREAM_DRAWS            128     // each with its own light, uploaded right before it
+#define COMMAND_FRAMES          20
+#define COMMAND_OBJECTS         8192    // spinning cubes, about half of them in view
+#define COMMAND_LISTS           8
+
+////////////////////////////////////////////////////////////////////////////////
+using bench_clock = std::chrono::steady_clock;
+
+////////////////////////////////////////////////////////////////////////////////
+static double secondsSince(bench_clock::time_point start)
+{
+        return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// one update is the per-draw uniform traffic of a phong draw with full light arrays
+static void benchUniforms()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::program& program = *phongPrograms.get(al::gl::shader_features{});
+
+        glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
+        glm::mat4 normal = glm::transpose(glm::inverse(model));
+        glm::mat4 pvm = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f) * model;
+
+        al::gl::phong_material material;
+        std::vector<al::dir_light> dirLights(2);
+        std::vector<al::point_light> pointLights(4);
+        std::vector<al::spot_light> spotLights(2);
+
+        program.use();
+
+        auto start = bench_clock::now();
+        for (int i = 0; i < UNIFORM_ITERATIONS; ++i) {
+                program.uniform("uModel", model);
+                program.uniform("uNormal", normal);
+                program.uniform("uPVM", pvm);
+                program.uniform("uMaterial", material);
+                program.uniform("uDirLights", dirLights);
+                program.uniform("uPointLights", pointLights);
+                program.uniform("uSpotLights", spotLights);
+        }
+        glFinish();
+        double byName = UNIFORM_ITERATIONS / secondsSince(start);
+
+        auto uModel             = program.handle<glm::mat4>("uModel");
+        auto uNormal            = program.handle<glm::mat4>("uNormal");
+        auto uPVM               = program.handle<glm::mat4>("uPVM");
+        auto uMaterial          = program.handle<al::gl::phong_material>("uMaterial");
+        auto uDirLights         = program.handle<std::vector<al::dir_light>>("uDirLights");
+        auto uPointLights       = program.handle<std::vector<al::point_light>>("uPointLights");
+        auto uSpotLights        = program.handle<std::vector<al::spot_light>>("uSpotLights");
+
+        start = bench_clock::now();
+        for (int i = 0; i < UNIFORM_ITERATIONS; ++i) {
+                program.uniform(uModel, model);
+                program.uniform(uNormal, normal);
+                program.uniform(uPVM, pvm);
+                program.uniform(uMaterial, material);
+                program.uniform(uDirLights, dirLights);
+                program.uniform(uPointLights, pointLights);
+                program.uniform(uSpotLights, spotLights);
+        }
+        glFinish();
+        double byHandle = UNIFORM_ITERATIONS / secondsSince(start);
+
+        program.halt();
+
+        std::cout << "[uniforms] by name:   " << byName << " updates/s\n";
+        std::cout << "[uniforms] by handle: " << byHandle << " updates/s (" << byHandle / byName << "x)\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// one frame sends camera and lights to every program, per program or once through blocks
+static void benchBlocks()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+
+        // distinct permutations stand in for the programs of a frame
+        std::vector<al::gl::shader_features> uniformFeatures(BLOCK_PROGRAMS);
+        std::vector<al::gl::shader_features> blockFeatures(BLOCK_PROGRAMS);
+        for (int i = 0; i < BLOCK_PROGRAMS; ++i) {
+                uniformFeatures[i].mNumPointLights = 4 + i;
+                blockFeatures[i].mNumPointLights = 4 + i;
+                blockFeatures[i].mUniformBlocks = true;
+        }
+        phongPrograms.compile(uniformFeatures);
+        phongPrograms.compile(blockFeatures);
+
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        glm::mat4 view(1.0f);
+        glm::vec3 viewPos(0.0f);
+
+        std::vector<al::dir_light> dirLights(2);
+        std::vector<al::point_light> pointLights(4);
+        std::vector<al::spot_light> spotLights(2);
+
+        std::vector<al::gl::program*> programs;
+        for (const al::gl::shader_features& features : uniformFeatures)
+                programs.push_back(phongPrograms.get(features));
+
+        auto start = bench_clock::now();
+        for (int i = 0; i < BLOCK_ITERATIONS; ++i) {
+                for (al::gl::program* program : programs) {
+                        program->use();
+                        program->uniform("uPVM", projection * view);
+                        program->uniform("uViewPos", viewPos);
+                        program->uniform("uDirLights", dirLights);
+                        program->uniform("uPointLights", pointLights);
+                        program->uniform("uSpotLights", spotLights);
+                }
+        }
+        glFinish();
+        double byUniforms = BLOCK_ITERATIONS / secondsSince(start);
+
+        al::gl::frame_blocks frameBlocks;
+
+        programs.clear();
+        for (const al::gl::shader_features& features : blockFeatures)
+                programs.push_back(phongPrograms.get(features));
+
+        start = bench_clock::now();
+        for (int i = 0; i < BLOCK_ITERATIONS; ++i) {
+                frameBlocks.setCamera(projection, view, viewPos);
+                frameBlocks.setLights(dirLights, pointLights, spotLights);
+                frameBlocks.upload();
+                for (al::gl::program* program : programs)
+                        program->use();
+        }
+        glFinish();
+        double byBlocks = BLOCK_ITERATIONS / secondsSince(start);
+
+        // counts past the old arrays only cost upload bandwidth
+        std::vector<al::point_light> manyPointLights(al::MAX_POINT_LIGHTS);
+        start = bench_clock::now();
+        for (int i = 0; i < BLOCK_ITERATIONS; ++i) {
+                frameBlocks.setLights(dirLights, manyPointLights, spotLights);
+                frameBlocks.upload();
+        }
+        glFinish();
+        double byBlocksMany = BLOCK_ITERATIONS / secondsSince(start);
+
+        programs.back()->halt();
+
+        std::cout << "[blocks] " << BLOCK_PROGRAMS << " programs, uniforms: " << byUniforms << " frames/s\n";
+        std::cout << "[blocks] " << BLOCK_PROGRAMS << " programs, blocks:   " << byBlocks << " frames/s (" << byBlocks / byUniforms << "x)\n";
+        std::cout << "[blocks] " << al::MAX_POINT_LIGHTS << " point lights, blocks: " << byBlocksMany << " frames/s\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// a static scene, objects share material and lights, only the model matrices differ
+static void benchRedundant()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::program& program = *phongPrograms.get(al::gl::shader_features{});
+
+        std::vector<glm::mat4> models;
+        for (int i = 0; i < REDUNDANT_OBJECTS; ++i)
+                models.push_back(glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i), 0.0f, 0.0f)));
+
+        al::gl::phong_material material;
+        std::vector<al::dir_light> dirLights(2);
+        std::vector<al::point_light> pointLights(4);
+        std::vector<al::spot_light> spotLights(2);
+
+        auto uModel             = program.handle<glm::mat4>("uModel");
+        auto uTexMultiplier     = program.handle<glm::vec2>("uTexMultiplier");
+        auto uMaterial          = program.handle<al::gl::phong_material>("uMaterial");
+        auto uDirLights         = program.handle<std::vector<al::dir_light>>("uDirLights");
+        auto uPointLights       = program.handle<std::vector<al::point_light>>("uPointLights");
+        auto uSpotLights        = program.handle<std::vector<al::spot_light>>("uSpotLights");
+
+        program.use();
+        program.resetUniformCounters();
+
+        auto start = bench_clock::now();
+        for (int i = 0; i < REDUNDANT_FRAMES; ++i) {
+                program.uniform(uDirLights, dirLights);
+                program.uniform(uPointLights, pointLights);
+                program.uniform(uSpotLights, spotLights);
+                for (const glm::mat4& model : models) {
+                        program.uniform(uModel, model);
+                        program.uniform(uTexMultiplier, glm::vec2(1.0f, 1.0f));
+                        program.uniform(uMaterial, material);
+                }
+        }
+        glFinish();
+        double frames = REDUNDANT_FRAMES / secondsSince(start);
+
+        program.halt();
+
+        size_t issued = program.getIssuedUniforms();
+        size_t skipped = program.getSkippedUniforms();
+        std::cout << "[redundant] " << REDUNDANT_OBJECTS << " objects: " << frames << " frames/s\n";
+        std::cout << "[redundant] issued " << issued << ", skipped " << skipped
+                  << " (" << 100.0 * skipped / (issued + skipped) << "%)\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// every draw switches material, as uniforms or as an index into the material table
+static void benchMaterials()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+
+        al::gl::shader_features tableFeatures;
+        tableFeatures.mMaterialTable = true;
+
+        al::gl::program& uniformProgram = *phongPrograms.get(al::gl::shader_features{});
+        al::gl::program& tableProgram = *phongPrograms.get(tableFeatures);
+
+        std::vector<al::gl::phong_material> materials(MATERIAL_COUNT);
+        al::gl::material_table table;
+        for (int i = 0; i < MATERIAL_COUNT; ++i) {
+                materials[i].mDiffuse = glm::vec3(static_cast<float>(i) / MATERIAL_COUNT);
+                materials[i].mShininess = static_cast<float>(1 + i);
+                table.add(materials[i]);
+        }
+        table.upload();
+
+        auto uMaterial = uniformProgram.handle<al::gl::phong_material>("uMaterial");
+        uniformProgram.use();
+
+        auto start = bench_clock::now();
+        for (int i = 0; i < MATERIAL_FRAMES; ++i)
+                for (int j = 0; j < MATERIAL_DRAWS; ++j)
+                        uniformProgram.uniform(uMaterial, materials[j % MATERIAL_COUNT]);
+        glFinish();
+        double byUniforms = MATERIAL_FRAMES / secondsSince(start);
+
+        auto uMaterialIndex = tableProgram.handle<int>("uMaterialIndex");
+        tableProgram.use();
+        table.attach(tableProgram);
+        table.bind();
+
+        start = bench_clock::now();
+        for (int i = 0; i < MATERIAL_FRAMES; ++i)
+                for (int j = 0; j < MATERIAL_DRAWS; ++j)
+                        tableProgram.uniform(uMaterialIndex, j % MATERIAL_COUNT);
+        glFinish();
+        double byTable = MATERIAL_FRAMES / secondsSince(start);
+
+        tableProgram.halt();
+
+        std::cout << "[materials] " << MATERIAL_DRAWS << " draws, uniforms: " << byUniforms << " frames/s\n";
+        std::cout << "[materials] " << MATERIAL_DRAWS << " draws, table:    " << byTable << " frames/s (" << byTable / byUniforms << "x)\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void printStats(const char* name, const al::gl::render_stats& stats, double frames)
+{
+        std::cout << "[queue] " << name << stats.mDraws << " draws, " << stats.mProgramSwitches << " program, "
+                  << stats.mTextureSwitches << " texture, " << stats.mVaoSwitches << " vao switches, " << frames << " frames/s\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// meshes with shuffled programs and textures, submitted in a random order every frame
+static void benchQueue()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::texture_loader textureLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+
+        std::vector<al::gl::program*> programs;
+        for (int i = 0; i < QUEUE_PROGRAMS; ++i) {
+                al::gl::shader_features features;
+                features.mNumPointLights = i;
+                programs.push_back(phongPrograms.get(features));
+        }
+
+        std::vector<al::gl::texture2D*> textures;
+        for (const auto& entry : std::filesystem::directory_iterator(LOVELACE_ROOT_DIR "models/sponza")) {
+                if (entry.path().extension() == ".jpg" && textures.size() < QUEUE_TEXTURES)
+                        textures.push_back(textureLoader.load2D(entry.path().string()));
+        }
+
+        std::mt19937 rng(42);
+        std::vector<al::gl::mesh> meshes;
+        meshes.reserve(QUEUE_MESHES);
+        std::vector<al::gl::program*> meshPrograms;
+        for (int i = 0; i < QUEUE_MESHES; ++i) {
+                meshes.push_back(al::gl::genCube());
+                meshes.back().mTextures = { textures[rng() % textures.size()], textures[rng() % textures.size()] };
+                meshPrograms.push_back(programs[rng() % programs.size()]);
+        }
+
+        // tiny cubes, so the rasterizer doesn't hide the state changes
+        glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.001f));
+        std::vector<int> order(QUEUE_MESHES);
+        for (int i = 0; i < QUEUE_MESHES; ++i)
+                order[i] = i;
+
+        al::gl::render_queue queue;
+        auto run = [&](bool sorting) {
+                queue.setSorting(sorting);
+                auto start = bench_clock::now();
+                for (int f = 0; f < QUEUE_FRAMES; ++f) {
+                        std::shuffle(order.begin(), order.end(), rng);
+                        for (int i : order)
+                                queue.submit(meshes[i], *meshPrograms[i], model, static_cast<float>(i) / QUEUE_MESHES);
+                        queue.execute();
+                }
+                glFinish();
+                return QUEUE_FRAMES / secondsSince(start);
+        };
+
+        double unsorted = run(false);
+        printStats("submission order: ", queue.getStats(), unsorted);
+        double sorted = run(true);
+        printStats("sorted:           ", queue.getStats(), sorted);
+        programs.back()->halt();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void printCounter(const char* name, const al::gl::state_counter& counter)
+{
+        std::cout << "[state] " << name << counter.mIssued / STATE_FRAMES << " issued, "
+                  << counter.mSkipped / STATE_FRAMES << " skipped per frame\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// meshes drawn one by one in file order, runs of neighbours share their textures like in sponza
+static void benchState()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::texture_loader textureLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::program& program = *phongPrograms.get(al::gl::shader_features{});
+
+        std::vector<al::gl::texture2D*> textures;
+        for (const auto& entry : std::filesystem::directory_iterator(LOVELACE_ROOT_DIR "models/sponza")) {
+                if (entry.path().extension() == ".jpg" && textures.size() < QUEUE_TEXTURES)
+                        textures.push_back(textureLoader.load2D(entry.path().string()));
+        }
+
+        std::vector<al::gl::mesh> meshes;
+        meshes.reserve(STATE_MESHES);
+        for (int i = 0; i < STATE_MESHES; ++i) {
+                meshes.push_back(al::gl::genCube());
+                al::gl::texture2D* texture = textures[(i / STATE_RUN) % textures.size()];
+                meshes.back().mTextures = { texture, texture };
+        }
+
+        auto uModel = program.handle<glm::mat4>("uModel");
+        glm::mat4 model = glm::scale(glm::mat4(1.0f), glm::vec3(0.001f));
+
+        al::gl::glstate().resetStats();
+        auto start = bench_clock::now();
+        for (int f = 0; f < STATE_FRAMES; ++f) {
+                program.use();
+                program.uniform(uModel, model);
+                for (const al::gl::mesh& m : meshes)
+                        m.draw();
+                program.halt();
+        }
+        glFinish();
+        double frames = STATE_FRAMES / secondsSince(start);
+
+        const al::gl::state_stats& stats = al::gl::glstate().getStats();
+        std::cout << "[state] " << STATE_MESHES << " meshes: " << frames << " frames/s\n";
+        printCounter("programs:        ", stats.mPrograms);
+        printCounter("vaos:            ", stats.mVaos);
+        printCounter("active textures: ", stats.mActiveTextures);
+        printCounter("textures:        ", stats.mTextures);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// boxes scattered around the origin, the camera turns a full circle over the frames
+static void benchCulling()
+{
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> position(-CULL_EXTENT, CULL_EXTENT);
+        std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+        al::cull_set set;
+        set.reserve(CULL_BOXES);
+        for (int i = 0; i < CULL_BOXES; ++i) {
+                al::bounds b;
+                b.mMin = glm::vec3(position(rng), position(rng), position(rng));
+                b.mMax = b.mMin + glm::vec3(size(rng), size(rng), size(rng));
+                set.add(b, glm::mat4(1.0f));
+        }
+
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        std::vector<al::frustum> frusta;
+        for (int f = 0; f < CULL_FRAMES; ++f) {
+                float angle = glm::radians(360.0f * f / CULL_FRAMES);
+                glm::vec3 direction(std::cos(angle), 0.0f, std::sin(angle));
+                frusta.emplace_back(projection * glm::lookAt(glm::vec3(0.0f), direction, glm::vec3(0.0f, 1.0f, 0.0f)));
+        }
+
+        std::vector<unsigned char> visible, reference;
+        size_t scalarVisible = 0, simdVisible = 0;
+
+        auto start = bench_clock::now();
+        for (const al::frustum& f : frusta)
+                scalarVisible += set.cullScalar(f, reference);
+        double scalarTime = secondsSince(start) * 1e6 / CULL_FRAMES;
+
+        start = bench_clock::now();
+        for (const al::frustum& f : frusta)
+                simdVisible += set.cull(f, visible);
+        double simdTime = secondsSince(start) * 1e6 / CULL_FRAMES;
+
+        if (scalarVisible != simdVisible || visible != reference)
+                throw al::exception("", "", "benchCulling", "SIMD and scalar culling disagree", al::etype::unexpected);
+
+        double culled = 100.0 * (1.0 - (double)simdVisible / ((double)CULL_BOXES * CULL_FRAMES));
+        std::cout << "[culling] " << CULL_BOXES << " boxes, " << culled << "% culled\n";
+        std::cout << "  scalar: " << scalarTime << " us/frame\n";
+        std::cout << "  simd:   " << simdTime << " us/frame\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// a balanced tree with SCENE_FANOUT children per node, added breadth first
+static void benchScene()
+{
+        al::scene_graph graph;
+        graph.reserve(SCENE_NODES);
+        graph.add(al::NO_PARENT);
+        for (int i = 1; i < SCENE_NODES; ++i)
+                graph.add((i - 1) / SCENE_FANOUT, glm::translate(glm::mat4(1.0f), glm::vec3(0.01f * (i % 7), 0.0f, 0.0f)));
+
+        // every node dirty
+        auto start = bench_clock::now();
+        for (int i = 0; i < SCENE_ITERATIONS; ++i) {
+                graph.setLocal(0, glm::rotate(glm::mat4(1.0f), 0.01f * i, glm::vec3(0.0f, 1.0f, 0.0f)));
+                graph.update();
+        }
+        double fullTime = secondsSince(start) * 1e3 / SCENE_ITERATIONS;
+
+        // a few nodes near the leaves move, most of the pass is flag checks
+        std::mt19937 rng(11);
+        std::uniform_int_distribution<int> leaves(SCENE_NODES / 2, SCENE_NODES - 1);
+        graph.resetUpdated();
+        start = bench_clock::now();
+        for (int i = 0; i < SCENE_ITERATIONS; ++i) {
+                for (int j = 0; j < SCENE_MOVED; ++j)
+                        graph.setLocal(leaves(rng), glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.01f * i, 0.0f)));
+                graph.update();
+        }
+        double partialTime = secondsSince(start) * 1e3 / SCENE_ITERATIONS;
+        size_t partialUpdated = graph.getUpdated() / SCENE_ITERATIONS;
+
+        // the world matrix of the last node against the product along its chain
+        glm::mat4 expected(1.0f);
+        for (int node = SCENE_NODES - 1; node != al::NO_PARENT; node = graph.getParent(node))
+                expected = graph.getLocal(node) * expected;
+        glm::vec4 error = graph.getWorld(SCENE_NODES - 1)[3] - expected[3];
+        if (std::abs(error.x) + std::abs(error.y) + std::abs(error.z) > 1e-3f)
+                throw al::exception("", "", "benchScene", "world matrix doesn't match its parent chain", al::etype::unexpected);
+
+        std::cout << "[scene] " << SCENE_NODES << " nodes\n";
+        std::cout << "  all dirty:       " << fullTime << " ms/update\n";
+        std::cout << "  " << SCENE_MOVED << " moved:        " << partialTime << " ms/update, " << partialUpdated << " matrices\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// the same cube at INSTANCE_COUNT places, one draw with per-draw uniforms each vs a single instanced draw
+static void benchInstancing()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mVertexFormat = al::gl::VERTEX_POSITION | al::gl::VERTEX_NORMAL;
+        al::gl::program& program = *phongPrograms.get(features);
+        features.mInstanced = true;
+        al::gl::program& instancedProgram = *phongPrograms.get(features);
+
+        al::gl::mesh cube = al::gl::genCube();
+        glm::mat4 projectionView = glm::perspective(glm::radians(90.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f) *
+                                   glm::lookAt(glm::vec3(0.0f, 0.0f, 80.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        std::vector<al::gl::instance_data> instances(INSTANCE_COUNT);
+        for (int i = 0; i < INSTANCE_COUNT; ++i) {
+                glm::vec3 position(static_cast<float>(i % 64) - 32.0f, static_cast<float>(i / 64) - 32.0f, 0.0f);
+                instances[i].mModel = glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.4f));
+        }
+
+        auto uPVM       = program.handle<glm::mat4>("uPVM");
+        auto uModel     = program.handle<glm::mat4>("uModel");
+        auto uNormal    = program.handle<glm::mat4>("uNormal");
+
+        program.use();
+        auto start = bench_clock::now();
+        for (int f = 0; f < INSTANCE_FRAMES; ++f) {
+                for (const al::gl::instance_data& instance : instances) {
+                        program.uniform(uPVM, projectionView * instance.mModel);
+                        program.uniform(uModel, instance.mModel);
+                        program.uniform(uNormal, glm::transpose(glm::inverse(instance.mModel)));
+                        cube.draw();
+                }
+        }
+        glFinish();
+        double byDraws = INSTANCE_FRAMES / secondsSince(start);
+
+        // the instance data is sent every frame, as it would be for moving props
+        al::gl::instance_buffer instanceBuffer(INSTANCE_COUNT);
+        instancedProgram.use();
+        instancedProgram.uniform("uProjectionView", projectionView);
+        instancedProgram.uniform("uModel", glm::mat4(1.0f));
+        start = bench_clock::now();
+        for (int f = 0; f < INSTANCE_FRAMES; ++f) {
+                instanceBuffer.set(instances);
+                cube.drawInstanced(instanceBuffer);
+        }
+        glFinish();
+        double byInstances = INSTANCE_FRAMES / secondsSince(start);
+        instancedProgram.halt();
+
+        std::cout << "[instancing] " << INSTANCE_COUNT << " cubes, draws:     " << byDraws << " frames/s\n";
+        std::cout << "[instancing] " << INSTANCE_COUNT << " cubes, instanced: " << byInstances << " frames/s (" << byInstances / byDraws << "x)\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// distinct cube meshes over a few texture sets, sorted queue vs one multi-draw per bucket
+static void benchIndirect()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::texture_loader textureLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+        features.mInstanced = true;
+        al::gl::program& instancedProgram = *phongPrograms.get(features);
+
+        std::vector<al::gl::texture2D*> textures;
+        for (const auto& entry : std::filesystem::directory_iterator(LOVELACE_ROOT_DIR "models/sponza")) {
+                if (entry.path().extension() == ".jpg" && textures.size() < INDIRECT_TEXTURES)
+                        textures.push_back(textureLoader.load2D(entry.path().string()));
+        }
+
+        glm::vec3 viewPos(0.0f, 0.0f, 40.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        al::dir_light sun;
+        sun.mDirection = glm::normalize(glm::vec3(-0.3f, -0.5f, -1.0f));
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(projection, view, viewPos);
+        frameBlocks.setLights({ sun }, {}, {});
+        frameBlocks.upload();
+
+        // without textures on disk the cubes keep the material's flat color
+        al::gl::phong_material material;
+        material.mDiffuse = glm::vec3(0.8f);
+        material.mSpecular = glm::vec3(0.2f);
+        material.mShininess = 16.0f;
+        material.mEnableAmbientTexture = material.mEnableDiffuseTexture = !textures.empty();
+        for (al::gl::program* p : { &program, &instancedProgram }) {
+                p->use();
+                p->uniform("uMaterial", material);
+        }
+
+        // small cubes in a grid filling the screen, so the rasterizer doesn't hide the per-draw cost
+        std::vector<al::gl::mesh> meshes;
+        std::vector<glm::mat4> models;
+        meshes.reserve(INDIRECT_MESHES);
+        al::gl::geometry_pool pool;
+        for (int i = 0; i < INDIRECT_MESHES; ++i) {
+                meshes.push_back(al::gl::genCube());
+                if (!textures.empty()) {
+                        al::gl::texture2D* texture = textures[i % textures.size()];
+                        meshes.back().mTextures = { texture, texture };
+                }
+                pool.add(meshes.back());
+
+                glm::vec3 position(static_cast<float>(i % 64) - 32.0f, static_cast<float>(i / 64) - 16.0f, 0.0f);
+                models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position * 1.2f), glm::vec3(0.2f)));
+        }
+        pool.upload();
+        glEnable(GL_DEPTH_TEST);
+
+        std::vector<unsigned char> pixels[3];
+        auto readImage = [&](int mode) {
+                pixels[mode].resize(WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+                glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels[mode].data());
+
+                // every cube covers a few pixels, a blank image means nothing was drawn
+                size_t covered = 0;
+                for (size_t i = 0; i < pixels[mode].size(); i += 4)
+                        covered += std::memcmp(&pixels[mode][i], pixels[mode].data(), 4) != 0;
+                if (covered < INDIRECT_MESHES)
+                        throw al::exception("", "", "benchIndirect", "the cubes weren't drawn", al::etype::unexpected);
+        };
+
+        al::gl::render_queue queue;
+        auto start = bench_clock::now();
+        for (int f = 0; f < INDIRECT_FRAMES; ++f) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                for (int i = 0; i < INDIRECT_MESHES; ++i)
+                        queue.submit(meshes[i], program, models[i]);
+                queue.execute();
+        }
+        glFinish();
+        double byQueue = INDIRECT_FRAMES / secondsSince(start);
+        readImage(0);
+        std::cout << "[indirect] render queue:  " << byQueue << " frames/s, " << queue.getStats().mDraws << " draw calls\n";
+
+        al::gl::indirect_queue indirect(pool);
+        for (bool multiDraw : { false, true }) {
+                indirect.setIndirect(multiDraw);
+                if (multiDraw && !indirect.isIndirect()) {
+                        std::cout << "[indirect] multi-draw indirect isn't supported\n";
+                        break;
+                }
+
+                start = bench_clock::now();
+                for (int f = 0; f < INDIRECT_FRAMES; ++f) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        for (int i = 0; i < INDIRECT_MESHES; ++i)
+                                indirect.submit(meshes[i], instancedProgram, models[i]);
+                        indirect.execute();
+                }
+                glFinish();
+                double frames = INDIRECT_FRAMES / secondsSince(start);
+                readImage(multiDraw ? 2 : 1);
+
+                const al::gl::indirect_stats& stats = indirect.getStats();
+                std::cout << "[indirect] " << (multiDraw ? "multi-draw:  " : "base vertex: ") << frames << " frames/s, "
+                          << stats.mBuckets << " buckets, " << stats.mCalls << " draw calls (" << frames / byQueue << "x)\n";
+        }
+        glDisable(GL_DEPTH_TEST);
+        instancedProgram.halt();
+
+        // same program and instance data, only how the draws are issued differs
+        if (!pixels[2].empty() && pixels[1] != pixels[2])
+                throw al::exception("", "", "benchIndirect", "multi-draw and base vertex draws differ", al::etype::unexpected);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// a maze of walls in front of a field of boxes, everything on the CPU
+static void benchOcclusion()
+{
+        std::mt19937 rng(5);
+        std::uniform_real_distribution<float> spread(-100.0f, 100.0f);
+
+        // unit quads in the xy plane, scaled and placed as walls
+        std::vector<float> wallVertices { -1.0f, -1.0f, 0.0f,   1.0f, -1.0f, 0.0f,   1.0f, 1.0f, 0.0f,   -1.0f, 1.0f, 0.0f };
+        std::vector<unsigned> wallIndices { 0, 1, 2, 0, 2, 3 };
+        std::vector<glm::mat4> walls;
+        for (int i = 0; i < OCCLUSION_WALLS; ++i)
+                walls.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(i ? spread(rng) : 0.0f, 0.0f, -20.0f - (i % 8) * 10.0f)), glm::vec3(6.0f, 30.0f, 1.0f)));
+
+        al::cull_set boxes;
+        for (int i = 0; i < OCCLUSION_BOXES; ++i) {
+                al::bounds b;
+                b.mMin = glm::vec3(spread(rng), spread(rng) * 0.2f, -110.0f + spread(rng) * 0.4f);
+                b.mMax = b.mMin + glm::vec3(1.0f);
+                boxes.add(b, glm::mat4(1.0f));
+        }
+
+        glm::mat4 projectionView = glm::perspective(glm::radians(90.0f), (float)OCCLUSION_WIDTH / OCCLUSION_HEIGHT, 0.1f, 1000.0f) *
+                                   glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        al::frustum frustum(projectionView);
+
+        auto rasterize = [&](al::occlusion_buffer& buffer) {
+                auto start = bench_clock::now();
+                for (int f = 0; f < OCCLUSION_FRAMES; ++f) {
+                        buffer.begin(projectionView);
+                        for (const glm::mat4& wall : walls)
+                                buffer.addOccluder(wallVertices.data(), 3, 0, wallIndices.data(), wallIndices.size(), wall);
+                        buffer.rasterize();
+                }
+                return secondsSince(start) * 1e6 / OCCLUSION_FRAMES;
+        };
+
+        al::occlusion_buffer single(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+        double singleTime = rasterize(single);
+
+        al::worker_pool workers;
+        al::occlusion_buffer threaded(OCCLUSION_WIDTH, OCCLUSION_HEIGHT, &workers);
+        double threadedTime = rasterize(threaded);
+
+        if (single.getDepth() != threaded.getDepth())
+                throw al::exception("", "", "benchOcclusion", "threaded and single threaded depth differ", al::etype::unexpected);
+
+        // right behind the first wall, straight ahead of the camera, and right in front of it
+        glm::vec3 wall(walls.front()[3]);
+        if (threaded.isVisible(wall - glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(1.0f)) || !threaded.isVisible(wall + glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(1.0f)))
+                throw al::exception("", "", "benchOcclusion", "a box was misclassified", al::etype::unexpected);
+
+        std::vector<unsigned char> visible;
+        size_t inFrustum = boxes.cull(frustum, visible);
+        auto start = bench_clock::now();
+        size_t unoccluded = 0;
+        for (int f = 0; f < OCCLUSION_FRAMES; ++f) {
+                boxes.cull(frustum, visible);
+                unoccluded = threaded.test(boxes, visible);
+        }
+        double testTime = secondsSince(start) * 1e6 / OCCLUSION_FRAMES;
+
+        std::cout << "[occlusion] " << OCCLUSION_WIDTH << "x" << OCCLUSION_HEIGHT << ", " << threaded.getNumTriangles() << " occluder triangles\n";
+        std::cout << "  rasterize, 1 thread:  " << singleTime << " us/frame\n";
+        std::cout << "  rasterize, " << workers.size() + 1 << " threads: " << threadedTime << " us/frame\n";
+        std::cout << "  test " << OCCLUSION_BOXES << " boxes: " << testTime << " us/frame, " << inFrustum << " in the frustum, "
+                  << 100.0 * (inFrustum - unoccluded) / inFrustum << "% of them occluded\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// point lights scattered over a floor, every light per fragment vs the lights of the fragment's cluster
+static void benchClusters()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+        features.mClustered = true;
+        al::gl::program& clusteredProgram = *phongPrograms.get(features);
+
+        al::fpscamera camera(WINDOW_WIDTH, WINDOW_HEIGHT, {});
+        glm::mat4 floor = glm::scale(glm::mat4(1.0f), glm::vec3(CLUSTER_AREA, 0.1f, CLUSTER_AREA));
+        al::gl::mesh cube = al::gl::genCube();
+        al::gl::frame_blocks frameBlocks;
+
+        al::worker_pool workers;
+        al::gl::clustered_lights clusters(&workers);
+        al::light_grid singleGrid;
+
+        clusteredProgram.use();
+        clusters.attach(clusteredProgram);
+        glEnable(GL_DEPTH_TEST);
+
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> spread(-CLUSTER_AREA, CLUSTER_AREA);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (int count : { 16, 256, 4096 }) {
+                std::vector<al::point_light> pointLights(count);
+                for (al::point_light& l : pointLights) {
+                        l.mDiffuse = l.mSpecular = glm::vec3(unit(rng), unit(rng), unit(rng));
+                        l.mPosition = glm::vec3(spread(rng), 1.0f + 2.0f * unit(rng), spread(rng));
+                        l.mRange = CLUSTER_RANGE;
+                        l.mIntensity = 1.0f;
+                        l.recalculateTerms();
+                }
+
+                auto draw = [&](al::gl::program& p) {
+                        auto start = bench_clock::now();
+                        for (int f = 0; f < CLUSTER_FRAMES; ++f) {
+                                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                                p.use();
+                                p.uniform("uModel", floor);
+                                p.uniform("uNormal", glm::transpose(glm::inverse(floor)));
+                                if (&p == &clusteredProgram) {
+                                        clusters.update(camera, pointLights, {});
+                                        clusters.uniforms(p);
+                                        clusters.bind();
+                                }
+                                cube.draw();
+                        }
+                        glFinish();
+                        return CLUSTER_FRAMES / secondsSince(start);
+                };
+
+                // the blocks hold MAX_POINT_LIGHTS, past that every fragment can't loop over all of them
+                double byBlocks = 0.0;
+                frameBlocks.setCamera(camera.getProjection(), camera.getView(), camera.mPosition);
+                if (count <= al::MAX_POINT_LIGHTS) {
+                        frameBlocks.setLights({}, pointLights, {});
+                        frameBlocks.upload();
+                        byBlocks = draw(program);
+                }
+                frameBlocks.setLights({}, {}, {});
+                frameBlocks.upload();
+                double byClusters = draw(clusteredProgram);
+
+                singleGrid.setProjection(camera.mFov, camera.mScreenWidth / camera.mScreenHeight, camera.mNear, camera.mFar);
+                auto start = bench_clock::now();
+                for (int i = 0; i < CLUSTER_BUILDS; ++i)
+                        singleGrid.build(camera.getView(), pointLights, {});
+                double singleTime = secondsSince(start) * 1e6 / CLUSTER_BUILDS;
+                start = bench_clock::now();
+                for (int i = 0; i < CLUSTER_BUILDS; ++i)
+                        clusters.update(camera, pointLights, {});
+                double threadedTime = secondsSince(start) * 1e6 / CLUSTER_BUILDS;
+
+                const al::light_grid& grid = clusters.getGrid();
+                if (grid.getCells() != singleGrid.getCells() || grid.getIndices() != singleGrid.getIndices())
+                        throw al::exception("", "", "benchClusters", "threaded and single threaded clusters differ", al::etype::unexpected);
+
+                std::cout << "[clusters] " << count << " point lights, " << grid.getIndices().size() << " light references in " << grid.size() << " clusters\n";
+                if (byBlocks > 0.0)
+                        std::cout << "  all lights: " << byBlocks << " frames/s\n";
+                else
+                        std::cout << "  all lights: more than the blocks hold\n";
+                std::cout << "  clustered:  " << byClusters << " frames/s";
+                if (byBlocks > 0.0)
+                        std::cout << " (" << byClusters / byBlocks << "x)";
+                std::cout << "\n  binning, 1 thread:  " << singleTime << " us, binning and upload, " << workers.size() + 1 << " threads: " << threadedTime << " us\n";
+        }
+        glDisable(GL_DEPTH_TEST);
+        clusteredProgram.halt();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// layers of screen filling slabs drawn back to front under many lights, with and without a depth prepass
+static void benchPrepass()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+        features.mDepthOnly = true;
+        features.mVertexFormat = al::gl::VERTEX_POSITION;
+        al::gl::program& depthProgram = *phongPrograms.get(features);
+
+        glm::vec3 viewPos(0.0f, 0.0f, 10.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        std::vector<al::point_light> pointLights(PREPASS_LIGHTS);
+        for (int i = 0; i < PREPASS_LIGHTS; ++i) {
+                pointLights[i].mDiffuse = pointLights[i].mSpecular = glm::vec3(1.0f);
+                pointLights[i].mPosition = glm::vec3((i % 8) * 4.0f - 14.0f, (i / 8) * 4.0f - 6.0f, 5.0f);
+                pointLights[i].mRange = 20.0f;
+                pointLights[i].mIntensity = 0.1f;
+                pointLights[i].recalculateTerms();
+        }
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(projection, view, viewPos);
+        frameBlocks.setLights({}, pointLights, {});
+        frameBlocks.upload();
+
+        al::gl::mesh cube = al::gl::genCube();
+        std::vector<glm::mat4> models;
+        for (int i = 0; i < PREPASS_LAYERS; ++i)
+                models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f * (PREPASS_LAYERS - i))), glm::vec3(20.0f, 12.0f, 0.5f)));
+
+        al::gl::depth_prepass prepass(depthProgram);
+        prepass.add(cube);
+        prepass.upload();
+
+        // back to front, the worst order for the main pass alone
+        al::gl::render_queue queue;
+        queue.setSorting(false);
+        glEnable(GL_DEPTH_TEST);
+
+        std::vector<unsigned char> pixels[2];
+        auto run = [&](bool enabled) {
+                prepass.setEnabled(enabled);
+                auto start = bench_clock::now();
+                for (int f = 0; f < PREPASS_FRAMES; ++f) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        for (const glm::mat4& model : models) {
+                                queue.submit(cube, program, model);
+                                prepass.submit(cube, model);
+                        }
+                        prepass.begin(projection * view);
+                        queue.execute();
+                        prepass.end();
+                }
+                glFinish();
+                double frames = PREPASS_FRAMES / secondsSince(start);
+
+                // the result of the last frame, now that the GPU is idle
+                prepass.begin(projection * view);
+                prepass.end();
+
+                pixels[enabled].resize(WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+                glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels[enabled].data());
+
+                const al::gl::depth_prepass_stats& stats = prepass.getStats();
+                std::cout << "[prepass] " << (enabled ? "prepass:    " : "main only:  ") << frames << " frames/s, "
+                          << stats.mOverdraw << " shaded samples per pixel\n";
+                return frames;
+        };
+
+        double mainOnly = run(false);
+        double withPrepass = run(true);
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+
+        // GL_EQUAL only passes if both programs computed the very same depths
+        if (pixels[0] != pixels[1])
+                throw al::exception("", "", "benchPrepass", "the prepass changed the image", al::etype::unexpected);
+        std::cout << "[prepass] " << PREPASS_LAYERS << " layers, " << PREPASS_LIGHTS << " point lights: " << withPrepass / mainOnly << "x\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// a wall in front of a grid of detailed objects, everything drawn vs what GPU queries found visible
+static void benchQueries()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::program_permutations boundsPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/bounds.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(projection, view, glm::vec3(0.0f, 0.0f, 10.0f));
+        frameBlocks.setLights({ al::dir_light{} }, {}, {});
+        frameBlocks.upload();
+
+        // each hidden object is a block of small cubes, costly enough for a query to pay off
+        al::gl::mesh cube = al::gl::genCube();
+        const std::vector<float>& cubeVertices = cube.getVao().getVbo().getData();
+        const std::vector<unsigned>& cubeIndices = cube.getVao().getEbo().getData();
+        std::vector<float> detailVertices;
+        std::vector<unsigned> detailIndices;
+        for (int i = 0; i < QUERY_DETAIL * QUERY_DETAIL * QUERY_DETAIL; ++i) {
+                glm::vec3 offset(i % QUERY_DETAIL, (i / QUERY_DETAIL) % QUERY_DETAIL, i / (QUERY_DETAIL * QUERY_DETAIL));
+                offset = (offset + 0.5f) * (2.0f / QUERY_DETAIL) - 1.0f;
+                unsigned base = static_cast<unsigned>(detailVertices.size() / al::gl::POOL_VERTEX_FLOATS);
+                for (size_t v = 0; v < cubeVertices.size(); v += al::gl::POOL_VERTEX_FLOATS) {
+                        for (int c = 0; c < 3; ++c)
+                                detailVertices.push_back(offset[c] + cubeVertices[v + c] * 0.4f / QUERY_DETAIL);
+                        detailVertices.insert(detailVertices.end(), cubeVertices.begin() + v + 3, cubeVertices.begin() + v + al::gl::POOL_VERTEX_FLOATS);
+                }
+                for (unsigned index : cubeIndices)
+                        detailIndices.push_back(base + index);
+        }
+        al::gl::mesh detail(std::move(detailVertices), std::move(detailIndices), cube.getVao().getInfos());
+
+        // the wall fills the view, a few cubes stand between it and the camera
+        std::vector<const al::gl::mesh*> meshes;
+        std::vector<glm::mat4> models;
+        meshes.push_back(&cube);
+        models.push_back(glm::scale(glm::mat4(1.0f), glm::vec3(100.0f, 100.0f, 0.5f)));
+        for (int i = 0; i < QUERY_SHOWN; ++i) {
+                meshes.push_back(&cube);
+                models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3((i % 8) - 3.5f, (i / 8) - 3.5f, 4.0f)), glm::vec3(0.2f)));
+        }
+        for (int i = 0; i < QUERY_HIDDEN; ++i) {
+                meshes.push_back(&detail);
+                models.push_back(glm::translate(glm::mat4(1.0f), glm::vec3((i % 16) * 3.0f - 22.5f, (i / 16) * 3.0f - 22.5f, -10.0f)));
+        }
+
+        al::cull_set boxes;
+        for (size_t i = 0; i < models.size(); ++i)
+                boxes.add(meshes[i]->getBounds(), models[i]);
+        std::vector<unsigned char> visible;
+        boxes.cull(al::frustum(projection * view), visible);
+
+        al::gl::render_queue queue;
+        queue.setSorting(false);
+        al::gl::occlusion_queries queries(*boundsPrograms.get(al::gl::shader_features{}), models.size());
+        glEnable(GL_DEPTH_TEST);
+
+        auto run = [&](bool occlusion) {
+                size_t issued = 0, skipped = 0;
+                auto start = bench_clock::now();
+                for (int f = 0; f < QUERY_FRAMES; ++f) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        if (occlusion)
+                                queries.update();
+
+                        // the wall is submitted first and, unsorted, drawn first
+                        for (size_t i = 0; i < models.size(); ++i)
+                                if (visible[i] && (!occlusion || queries.isVisible(i)))
+                                        queue.submit(*meshes[i], program, models[i], 0.0f, -1, 0, GL_TRIANGLES, occlusion ? queries.getCondition(i) : 0);
+                        queue.execute();
+
+                        if (occlusion) {
+                                queries.issue(boxes, visible, projection * view);
+                                issued += queries.getStats().mQueriesIssued;
+                                skipped += queries.getStats().mObjectsSkipped;
+                        }
+                }
+                glFinish();
+                double frames = QUERY_FRAMES / secondsSince(start);
+                std::cout << "[queries] " << (occlusion ? "queries:   " : "all drawn: ") << frames << " frames/s, " << queue.getStats().mDraws << " draws";
+                if (occlusion)
+                        std::cout << ", " << issued / QUERY_FRAMES << " queries and " << skipped / QUERY_FRAMES << " skipped per frame, results after "
+                                  << queries.getStats().mLatency << " frames";
+                std::cout << '\n';
+                return frames;
+        };
+
+        double all = run(false);
+        double occluded = run(true);
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+
+        // by now the results of the first frames are back
+        for (size_t i = 0; i < models.size(); ++i) {
+                bool expected = i <= QUERY_SHOWN;
+                if (visible[i] && queries.isVisible(i) != expected)
+                        throw al::exception("", "", "benchQueries", "a cube was misclassified", al::etype::unexpected);
+        }
+        std::cout << "[queries] " << occluded / all << "x\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// the prepass' back to front slabs, shaded forward vs through a gbuffer as the lights grow
+static void benchDeferred()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+        features.mGBuffer = true;
+        al::gl::program& gbufferProgram = *phongPrograms.get(features);
+        features.mGBuffer = false;
+        features.mDeferredLighting = true;
+        al::gl::program& lightingProgram = *phongPrograms.get(features);
+
+        glm::vec3 viewPos(0.0f, 0.0f, 10.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(projection, view, viewPos);
+        al::dir_light sun = { glm::vec3(0.1f), glm::vec3(1.0f), glm::vec3(1.0f), glm::normalize(glm::vec3(0.3f, -0.5f, -1.0f)), 0.5f };
+
+        // a gray specular survives the gbuffer's packing unchanged
+        al::gl::phong_material material;
+        material.mDiffuse = glm::vec3(0.8f, 0.6f, 0.4f);
+        material.mSpecular = glm::vec3(0.5f);
+        material.mShininess = 32.0f;
+        for (al::gl::program* p : { &program, &gbufferProgram }) {
+                p->use();
+                p->uniform("uMaterial", material);
+        }
+
+        al::gl::mesh cube = al::gl::genCube();
+        std::vector<glm::mat4> models;
+        for (int i = 0; i < DEFERRED_LAYERS; ++i)
+                models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f * (DEFERRED_LAYERS - i))), glm::vec3(20.0f, 12.0f, 0.5f)));
+
+        al::gl::deferred_renderer deferred(lightingProgram, WINDOW_WIDTH, WINDOW_HEIGHT);
+        al::gl::render_queue queue;
+        queue.setSorting(false);
+        glEnable(GL_DEPTH_TEST);
+
+        std::vector<unsigned char> pixels[2];
+        auto run = [&](bool gbuffer) {
+                auto start = bench_clock::now();
+                for (int f = 0; f < DEFERRED_FRAMES; ++f) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        for (const glm::mat4& model : models)
+                                queue.submit(cube, gbuffer ? gbufferProgram : program, model);
+                        if (gbuffer) {
+                                deferred.beginGeometry();
+                                queue.execute();
+                                deferred.endGeometry();
+                                glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+                                deferred.light(projection * view);
+                        }
+                        else
+                                queue.execute();
+                }
+                glFinish();
+                double frames = DEFERRED_FRAMES / secondsSince(start);
+
+                pixels[gbuffer].resize(WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+                glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels[gbuffer].data());
+                return frames;
+        };
+
+        std::mt19937 rng(11);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        for (int count : { 16, 64, al::MAX_POINT_LIGHTS }) {
+                std::vector<al::point_light> pointLights(count);
+                for (al::point_light& l : pointLights) {
+                        l.mDiffuse = l.mSpecular = glm::vec3(unit(rng), unit(rng), unit(rng));
+                        l.mPosition = glm::vec3(32.0f * unit(rng) - 16.0f, 18.0f * unit(rng) - 9.0f, unit(rng) - 1.25f);
+                        l.mRange = 4.0f;
+                        l.mIntensity = 1.0f;
+                        l.recalculateTerms();
+                }
+                frameBlocks.setLights({ sun }, pointLights, {});
+                frameBlocks.upload();
+
+                double forward = run(false);
+                double byGBuffer = run(true);
+
+                // what the packed normals and shininess cost, in 8 bit steps
+                double error = 0.0;
+                for (size_t i = 0; i < pixels[0].size(); ++i)
+                        error += std::abs(pixels[0][i] - pixels[1][i]);
+                error /= pixels[0].size();
+
+                std::cout << "[deferred] " << count << " point lights, " << DEFERRED_LAYERS << " layers\n";
+                std::cout << "  forward:  " << forward << " frames/s\n";
+                std::cout << "  deferred: " << byGBuffer << " frames/s (" << byGBuffer / forward << "x), mean difference " << error << '\n';
+        }
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// a field of static pillars and a few moving cubes under the sun while the camera walks,
+// every cascade redrawn each frame vs only the ones whose contents changed
+static void benchShadows()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        features.mShadows = true;
+        al::gl::program& program = *phongPrograms.get(features);
+        al::gl::shader_features depthFeatures;
+        depthFeatures.mDepthOnly = true;
+        depthFeatures.mVertexFormat = al::gl::VERTEX_POSITION;
+        al::gl::program& depthProgram = *phongPrograms.get(depthFeatures);
+
+        al::gl::mesh cube = al::gl::genCube();
+        std::vector<glm::mat4> pillars;
+        pillars.push_back(glm::scale(glm::mat4(1.0f), glm::vec3(200.0f, 0.1f, 200.0f)));
+        for (int x = 0; x < SHADOW_GRID; ++x)
+                for (int z = 0; z < SHADOW_GRID; ++z)
+                        pillars.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(8.0f * x - 92.0f, 4.0f, 8.0f * z - 92.0f)), glm::vec3(1.0f, 4.0f, 1.0f)));
+
+        al::dir_light sun = { glm::vec3(0.2f), glm::vec3(1.0f), glm::vec3(1.0f), glm::normalize(glm::vec3(0.4f, -1.0f, 0.3f)), 0.8f };
+        al::gl::frame_blocks frameBlocks;
+        al::gl::render_queue queue;
+
+        al::gl::shadow_cascades cascades(depthProgram, SHADOW_SIZE);
+        cascades.setSplits(150.0f, 0.75f);
+        cascades.setCasterDistance(50.0f);
+        program.use();
+        cascades.attach(program);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        auto run = [&](bool cached) {
+                al::fpscamera camera(WINDOW_WIDTH, WINDOW_HEIGHT, {});
+                camera.mPosition = camera.mNewPos = glm::vec3(0.0f, 6.0f, 60.0f);
+                camera.mDirection = glm::normalize(glm::vec3(0.0f, -0.3f, -1.0f));
+                camera.mActive = true;
+                camera.mState.moveForward = true;
+                camera.mSpeed = 6.0f;
+                cascades.invalidate();
+
+                std::vector<size_t> draws(cascades.getNumCascades());
+                std::vector<int> kept(cascades.getNumCascades());
+                std::vector<double> times(cascades.getNumCascades());
+                auto start = bench_clock::now();
+                for (int f = 0; f < SHADOW_FRAMES; ++f) {
+                        camera.update(1.0f / 30.0f);
+                        if (!cached)
+                                cascades.invalidate();
+
+                        for (const glm::mat4& model : pillars)
+                                cascades.submit(cube, model);
+                        std::vector<glm::mat4> movers;
+                        for (int i = 0; i < SHADOW_DYNAMIC; ++i) {
+                                float angle = 0.1f * f + 6.2832f * i / SHADOW_DYNAMIC;
+                                glm::vec3 center = camera.mPosition + glm::vec3(0.0f, -4.0f, -12.0f);
+                                movers.push_back(glm::translate(glm::mat4(1.0f), center + 5.0f * glm::vec3(glm::cos(angle), 0.0f, glm::sin(angle))));
+                                cascades.submit(cube, movers.back(), true);
+                        }
+                        cascades.render(camera, sun);
+
+                        for (int i = 0; i < cascades.getNumCascades(); ++i) {
+                                draws[i] += cascades.getStats(i).mDraws;
+                                kept[i] += cascades.getStats(i).mCached;
+                                times[i] = cascades.getStats(i).mTime;
+                        }
+
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        frameBlocks.setCamera(camera.getProjection(), camera.getView(), camera.mPosition);
+                        frameBlocks.setLights({ sun }, {}, {});
+                        frameBlocks.upload();
+                        program.use();
+                        cascades.uniforms(program);
+                        cascades.bind();
+                        for (const glm::mat4& model : pillars)
+                                queue.submit(cube, program, model);
+                        for (const glm::mat4& model : movers)
+                                queue.submit(cube, program, model);
+                        queue.execute();
+                }
+                glFinish();
+                double frames = SHADOW_FRAMES / secondsSince(start);
+
+                std::cout << "[shadows] " << (cached ? "cached:      " : "every frame: ") << frames << " frames/s\n";
+                for (int i = 0; i < cascades.getNumCascades(); ++i)
+                        std::cout << "  cascade " << i << " to " << cascades.getStats(i).mSplit << ": " << static_cast<double>(draws[i]) / SHADOW_FRAMES
+                                  << " draws per frame, kept " << kept[i] << "/" << SHADOW_FRAMES << " frames, " << times[i] << " ms per render\n";
+                return frames;
+        };
+
+        double everyFrame = run(false);
+        double cached = run(true);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+        std::cout << "[shadows] " << pillars.size() << " static and " << SHADOW_DYNAMIC << " dynamic casters: " << cached / everyFrame << "x\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void benchAtlas()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        features.mClustered = true;
+        features.mLightShadows = true;
+        al::gl::program& program = *phongPrograms.get(features);
+        al::gl::shader_features depthFeatures;
+        depthFeatures.mDepthOnly = true;
+        depthFeatures.mVertexFormat = al::gl::VERTEX_POSITION;
+        al::gl::program& depthProgram = *phongPrograms.get(depthFeatures);
+
+        al::gl::mesh cube = al::gl::genCube();
+        std::vector<glm::mat4> pillars;
+        pillars.push_back(glm::scale(glm::mat4(1.0f), glm::vec3(40.0f, 0.1f, 40.0f)));
+        for (int x = 0; x < ATLAS_GRID; ++x)
+                for (int z = 0; z < ATLAS_GRID; ++z)
+                        pillars.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(4.0f * x - 30.0f, 2.0f, 4.0f * z - 30.0f)), glm::vec3(0.5f, 2.0f, 0.5f)));
+
+        std::mt19937 rng(13);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        std::vector<al::point_light> pointLights(ATLAS_LIGHTS);
+        for (size_t i = 0; i < pointLights.size(); ++i) {
+                al::point_light& l = pointLights[i];
+                l.mDiffuse = l.mSpecular = glm::vec3(0.5f + 0.5f * unit(rng), 0.5f + 0.5f * unit(rng), 0.5f + 0.5f * unit(rng));
+                l.mPosition = glm::vec3(4.0f * std::floor(15.0f * unit(rng)) - 28.0f, 1.0f + 2.0f * unit(rng), 4.0f * std::floor(15.0f * unit(rng)) - 28.0f);
+                l.mRange = 12.0f;
+                l.mIntensity = 60.0f;
+                l.recalculateTerms();
+                l.mShadow = static_cast<int>(i);
+        }
+
+        al::fpscamera camera(WINDOW_WIDTH, WINDOW_HEIGHT, {});
+        camera.mPosition = camera.mNewPos = glm::vec3(0.0f, 30.0f, 42.0f);
+        camera.mDirection = glm::normalize(glm::vec3(0.0f, -0.7f, -1.0f));
+        camera.mActive = true;
+        camera.update(0.0f);
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(camera.getProjection(), camera.getView(), camera.mPosition);
+        frameBlocks.setLights({}, {}, {});
+        frameBlocks.upload();
+
+        al::gl::render_queue queue;
+        al::gl::clustered_lights clusters;
+        al::gl::shadow_atlas atlas(depthProgram, pointLights.size());
+        al::gl::phong_material material;
+        material.mDiffuse = glm::vec3(0.8f);
+        material.mSpecular = glm::vec3(0.2f);
+        material.mShininess = 16.0f;
+        program.use();
+        program.uniform("uMaterial", material);
+        clusters.attach(program);
+        atlas.attach(program);
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+
+        std::vector<unsigned char> pixels[3];
+        auto run = [&](int mode) {
+                static const char* names[] = { "unshadowed:  ", "every frame: ", "cached:      " };
+                for (size_t i = 0; i < pointLights.size(); ++i)
+                        pointLights[i].mShadow = mode ? static_cast<int>(i) : -1;
+                atlas.invalidate();
+
+                size_t rendered = 0, faces = 0, draws = 0;
+                auto start = bench_clock::now();
+                for (int f = 0; f < ATLAS_FRAMES; ++f) {
+                        if (mode == 1)
+                                atlas.invalidate();
+
+                        for (const glm::mat4& model : pillars)
+                                atlas.submit(cube, model);
+                        std::vector<glm::mat4> movers;
+                        for (int i = 0; i < ATLAS_DYNAMIC; ++i) {
+                                float angle = 0.2f * f + 6.2832f * i / ATLAS_DYNAMIC;
+                                glm::vec3 center = glm::vec3(-24.0f + 3.0f * glm::cos(angle), 0.75f, -24.0f + 3.0f * glm::sin(angle));
+                                movers.push_back(glm::scale(glm::translate(glm::mat4(1.0f), center), glm::vec3(0.75f)));
+                                atlas.submit(cube, movers.back(), true);
+                        }
+                        atlas.render(camera, pointLights, {});
+                        if (f > 0) {
+                                rendered += atlas.getStats().mRendered;
+                                faces += atlas.getStats().mFaces;
+                                draws += atlas.getStats().mDraws;
+                        }
+
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        clusters.update(camera, pointLights, {});
+                        program.use();
+                        clusters.uniforms(program);
+                        clusters.bind();
+                        atlas.bind();
+                        for (const glm::mat4& model : pillars)
+                                queue.submit(cube, program, model);
+                        for (const glm::mat4& model : movers)
+                                queue.submit(cube, program, model);
+                        queue.execute();
+                }
+                glFinish();
+                double frames = ATLAS_FRAMES / secondsSince(start);
+
+                pixels[mode].resize(WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+                glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels[mode].data());
+
+                // the first frame draws every tile either way
+                const al::gl::shadow_atlas_stats& stats = atlas.getStats();
+                std::cout << "[atlas] " << names[mode] << frames << " frames/s";
+                if (mode)
+                        std::cout << ", after the first frame " << static_cast<double>(rendered) / (ATLAS_FRAMES - 1) << " lights, "
+                                  << static_cast<double>(faces) / (ATLAS_FRAMES - 1) << " faces and " << static_cast<double>(draws) / (ATLAS_FRAMES - 1)
+                                  << " draws per frame, " << stats.mTime << " ms per render";
+                std::cout << '\n';
+                return frames;
+        };
+
+        run(0);
+        double everyFrame = run(1);
+        double cached = run(2);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+
+        auto mean = [](const std::vector<unsigned char>& p) {
+                double sum = 0.0;
+                for (size_t i = 0; i < p.size(); i += 4)
+                        sum += p[i] + p[i + 1] + p[i + 2];
+                return sum / (3.0 * p.size() / 4);
+        };
+        double difference = 0.0;
+        for (size_t i = 0; i < pixels[1].size(); ++i)
+                difference += std::abs(pixels[1][i] - pixels[2][i]);
+        difference /= pixels[1].size();
+
+        const al::gl::shadow_atlas_stats& stats = atlas.getStats();
+        std::cout << "[atlas] " << stats.mLights << " shadowed lights, " << stats.mDropped << " dropped, " << 100.0f * stats.mUsage
+                  << "% of the atlas used: " << cached / everyFrame << "x\n";
+        std::cout << "  mean brightness " << mean(pixels[0]) << " unshadowed, " << mean(pixels[2]) << " shadowed, "
+                  << difference << " mean difference cached against every frame\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static void benchResolution()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+
+        glm::vec3 viewPos(0.0f, 0.0f, 10.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        std::vector<al::point_light> pointLights(RESOLUTION_LIGHTS);
+        for (int i = 0; i < RESOLUTION_LIGHTS; ++i) {
+                pointLights[i].mDiffuse = pointLights[i].mSpecular = glm::vec3(1.0f);
+                pointLights[i].mPosition = glm::vec3((i % 8) * 4.0f - 14.0f, (i / 8) * 4.0f - 6.0f, 5.0f);
+                pointLights[i].mRange = 20.0f;
+                pointLights[i].mIntensity = 0.1f;
+                pointLights[i].recalculateTerms();
+        }
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(projection, view, viewPos);
+        frameBlocks.setLights({}, pointLights, {});
+        frameBlocks.upload();
+
+        // back to front, so every layer is shaded over the whole screen
+        al::gl::mesh cube = al::gl::genCube();
+        al::gl::render_queue queue;
+        queue.setSorting(false);
+        auto draw = [&](int layers) {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                for (int i = 0; i < layers; ++i)
+                        queue.submit(cube, program, glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -2.0f * (layers - i))), glm::vec3(20.0f, 12.0f, 0.5f)));
+                queue.execute();
+        };
+        glEnable(GL_DEPTH_TEST);
+
+        // llvmpipe rasterizes at the flush, after the second timestamp, so there the frames
+        // are timed on the CPU to a glFinish instead
+        bool cpuTiming = std::string(reinterpret_cast<const char*>(glGetString(GL_RENDERER))).find("llvmpipe") != std::string::npos;
+        auto frame = [&](al::gl::dynamic_resolution& resolution, int layers) {
+                auto start = bench_clock::now();
+                resolution.begin();
+                draw(layers);
+                resolution.end();
+                if (cpuTiming) {
+                        glFinish();
+                        resolution.measure(1000.0 * secondsSince(start));
+                }
+                resolution.present();
+        };
+
+        // the budget is half of what the heavy phase takes at full resolution
+        al::gl::resolution_policy fixed;
+        fixed.mMinScale = 1.0f;
+        al::gl::dynamic_resolution resolution(WINDOW_WIDTH, WINDOW_HEIGHT, fixed);
+        for (int f = 0; f < RESOLUTION_FRAMES / 4; ++f)
+                frame(resolution, RESOLUTION_HEAVY);
+        glFinish();
+        frame(resolution, RESOLUTION_HEAVY);
+        double fullTime = resolution.getTime();
+
+        al::gl::resolution_policy policy;
+        policy.mBudget = static_cast<float>(0.5 * fullTime);
+        policy.mMinScale = 0.25f;
+        resolution.setPolicy(policy);
+
+        std::cout << "[resolution] heavy phase at full resolution: " << fullTime << " ms on the " << (cpuTiming ? "CPU" : "GPU")
+                  << ", budget " << policy.mBudget << " ms\n";
+        static const char* names[] = { "light: ", "heavy: ", "light: " };
+        for (int phase = 0; phase < 3; ++phase) {
+                double scales = 0.0, times = 0.0;
+                int over = 0;
+                auto start = bench_clock::now();
+                for (int f = 0; f < RESOLUTION_FRAMES; ++f) {
+                        frame(resolution, phase == 1 ? RESOLUTION_HEAVY : RESOLUTION_LIGHT);
+                        scales += resolution.getScale();
+                        times += resolution.getTime();
+                        over += resolution.getTime() > policy.mBudget;
+                }
+                glFinish();
+                std::cout << "  " << names[phase] << RESOLUTION_FRAMES / secondsSince(start) << " frames/s, mean scale " << scales / RESOLUTION_FRAMES
+                          << ", mean frame time " << times / RESOLUTION_FRAMES << " ms, " << over << " frames over budget\n";
+        }
+        glDisable(GL_DEPTH_TEST);
+
+        std::cout << "[resolution] scale history:";
+        for (const al::gl::resolution_change& change : resolution.getHistory())
+                std::cout << " frame " << change.mFrame << ": " << change.mScale << " (" << change.mTime << " ms)";
+        std::cout << '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// per-draw frame blocks: glBufferSubData into one buffer vs a stream_buffer, orphaned or persistent
+static void benchStream()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+
+        glm::vec3 viewPos(0.0f, 0.0f, 20.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+        // a grid of cubes, each lit by a light of its own just in front of it
+        std::vector<glm::mat4> models;
+        std::vector<al::point_light> lights(STREAM_DRAWS);
+        for (int i = 0; i < STREAM_DRAWS; ++i) {
+                glm::vec3 position((i % 16) * 1.5f - 11.25f, (i / 16) * 1.5f - 5.25f, 0.0f);
+                models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), position), glm::vec3(0.5f)));
+                al::point_light& l = lights[i];
+                l.mDiffuse = l.mSpecular = glm::vec3((i % 3) == 0, (i % 3) == 1, (i % 3) == 2) * 0.8f + 0.2f;
+                l.mPosition = position + glm::vec3(0.3f, 0.3f, 1.5f);
+                l.mRange = 3.0f;
+                l.mIntensity = 4.0f;
+                l.recalculateTerms();
+        }
+
+        al::gl::mesh cube = al::gl::genCube();
+        al::gl::render_queue queue;
+        al::gl::phong_material material;
+        material.mDiffuse = glm::vec3(0.8f);
+        material.mSpecular = glm::vec3(0.2f);
+        material.mShininess = 16.0f;
+        program.use();
+        program.uniform("uMaterial", material);
+        glEnable(GL_DEPTH_TEST);
+
+        std::vector<unsigned char> pixels[3];
+        auto run = [&](int mode) {
+                static const char* names[] = { "glBufferSubData: ", "orphaned:        ", "persistent:      " };
+                std::unique_ptr<al::gl::stream_buffer> stream;
+                std::unique_ptr<al::gl::frame_blocks> frameBlocks;
+                if (mode == 0)
+                        frameBlocks = std::make_unique<al::gl::frame_blocks>();
+                else {
+                        al::gl::frame_blocks sizing;
+                        stream = std::make_unique<al::gl::stream_buffer>(GL_UNIFORM_BUFFER, STREAM_DRAWS * (sizing.getSizeInBytes() + 256), mode == 2);
+                        frameBlocks = std::make_unique<al::gl::frame_blocks>(*stream);
+                        if (mode == 2 && !stream->isPersistent()) {
+                                std::cout << "[stream] " << names[mode] << "unsupported, skipped\n";
+                                return 0.0;
+                        }
+                }
+
+                auto start = bench_clock::now();
+                for (int f = 0; f < STREAM_FRAMES_RUN; ++f) {
+                        if (stream)
+                                stream->begin();
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        frameBlocks->setCamera(projection, view, viewPos);
+                        for (int i = 0; i < STREAM_DRAWS; ++i) {
+                                frameBlocks->setLights({}, { lights[i] }, {});
+                                frameBlocks->upload();
+                                queue.submit(cube, program, models[i]);
+                                queue.execute();
+                        }
+                        if (stream)
+                                stream->end();
+                }
+                glFinish();
+                double frames = STREAM_FRAMES_RUN / secondsSince(start);
+
+                pixels[mode].resize(WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+                glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels[mode].data());
+
+                std::cout << "[stream] " << names[mode] << frames << " frames/s";
+                if (stream) {
+                        const al::gl::stream_stats& stats = stream->getStats();
+                        std::cout << ", " << stats.mPeak / 1024 << " KiB per frame, " << stats.mWaits << " fence waits ("
+                                  << stats.mWaitTime << " ms)";
+                }
+                std::cout << '\n';
+                return frames;
+        };
+
+        double bySubData = run(0);
+        double byOrphaning = run(1);
+        double byPersistent = run(2);
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+
+        if (pixels[0] != pixels[1] || (byPersistent > 0.0 && pixels[0] != pixels[2]))
+                throw al::exception("", "", "benchStream", "streaming changed the image", al::etype::unexpected);
+        std::cout << "[stream] " << STREAM_DRAWS << " uploads per frame: orphaned " << byOrphaning / bySubData << "x";
+        if (byPersistent > 0.0)
+                std::cout << ", persistent " << byPersistent / bySubData << "x";
+        std::cout << '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// culling, matrices and uniform packing inline on the GL thread vs recorded into command lists by workers
+static void benchCommands()
+{
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl");
+        al::gl::shader_features features;
+        features.mUniformBlocks = true;
+        al::gl::program& program = *phongPrograms.get(features);
+
+        glm::vec3 viewPos(0.0f, 0.0f, 60.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), (float)WINDOW_WIDTH / WINDOW_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(viewPos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        al::frustum frustum(projection * view);
+
+        al::dir_light sun;
+        sun.mDirection = glm::normalize(glm::vec3(-0.3f, -0.5f, -1.0f));
+        al::gl::frame_blocks frameBlocks;
+        frameBlocks.setCamera(projection, view, viewPos);
+        frameBlocks.setLights({ sun }, {}, {});
+        frameBlocks.upload();
+
+        al::gl::mesh cube = al::gl::genCube();
+        al::gl::phong_material material;
+        material.mDiffuse = glm::vec3(0.8f);
+        material.mSpecular = glm::vec3(0.2f);
+        material.mShininess = 16.0f;
+        program.use();
+        program.uniform("uMaterial", material);
+        glEnable(GL_DEPTH_TEST);
+
+        std::vector<glm::vec3> positions(COMMAND_OBJECTS);
+        for (int i = 0; i < COMMAND_OBJECTS; ++i)
+                positions[i] = glm::vec3(static_cast<float>(i % 128) - 64.0f, static_cast<float>(i / 128) - 32.0f, 0.0f);
+        auto modelOf = [&](int f, size_t i) {
+                glm::mat4 model = glm::translate(glm::mat4(1.0f), positions[i]);
+                model = glm::rotate(model, 0.1f * f + 0.01f * i, glm::vec3(0.3f, 1.0f, 0.2f));
+                return glm::scale(model, glm::vec3(0.4f));
+        };
+
+        al::gl::command_handles handles = al::gl::findCommandHandles(program);
+        al::worker_pool workers;
+        std::vector<al::gl::command_list> lists(COMMAND_LISTS);
+
+        std::vector<unsigned char> pixels[3];
+        auto run = [&](int mode) {
+                static const char* names[] = { "inline:           ", "one list:         ", "lists on workers: " };
+                double record = 0.0, replay = 0.0;
+                size_t commands = 0;
+                auto start = bench_clock::now();
+                for (int f = 0; f < COMMAND_FRAMES; ++f) {
+                        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                        auto recordStart = bench_clock::now();
+                        if (mode == 0) {
+                                program.use();
+                                cube.getVao().bind();
+                                for (size_t i = 0; i < COMMAND_OBJECTS; ++i) {
+                                        if (!frustum.contains(positions[i], 0.7f))
+                                                continue;
+                                        glm::mat4 model = modelOf(f, i);
+                                        program.uniform(handles.mModel, model);
+                                        program.uniform(handles.mNormal, glm::transpose(glm::inverse(model)));
+                                        cube.getVao().draw();
+                                }
+                                record += secondsSince(recordStart);
+                                continue;
+                        }
+
+                        auto recordRange = [&](al::gl::command_list& list, size_t first, size_t last) {
+                                for (size_t i = first; i < last; ++i)
+                                        if (frustum.contains(positions[i], 0.7f))
+                                                list.drawMesh(cube, program, handles, modelOf(f, i));
+                        };
+                        std::vector<al::gl::command_list> one(mode == 1 ? 1 : 0);
+                        std::vector<al::gl::command_list>& used = mode == 1 ? one : lists;
+                        al::gl::recordCommands(mode == 2 ? &workers : nullptr, used, COMMAND_OBJECTS, recordRange);
+                        record += secondsSince(recordStart);
+
+                        auto replayStart = bench_clock::now();
+                        al::gl::executeCommands(used);
+                        replay += secondsSince(replayStart);
+                        for (const al::gl::command_list& list : used)
+                                commands += list.size();
+                }
+                glFinish();
+                double frames = COMMAND_FRAMES / secondsSince(start);
+
+                pixels[mode].resize(WINDOW_WIDTH * WINDOW_HEIGHT * 4);
+                glReadPixels(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels[mode].data());
+
+                std::cout << "[commands] " << names[mode] << frames << " frames/s, " << 1000.0 * record / COMMAND_FRAMES << " ms recording";
+                if (mode)
+                        std::cout << ", " << 1000.0 * replay / COMMAND_FRAMES << " ms replaying " << commands / COMMAND_FRAMES << " commands";
+                std::cout << " per frame\n";
+                return record;
+        };
+
+        run(0);
+        double oneList = run(1);
+        double onWorkers = run(2);
+        glDisable(GL_DEPTH_TEST);
+        program.halt();
+
+        if (pixels[0] != pixels[1] || pixels[0] != pixels[2])
+                throw al::exception("", "", "benchCommands", "the command lists changed the image", al::etype::unexpected);
+        std::cout << "[commands] " << COMMAND_OBJECTS << " objects, " << workers.size() + 1 << " threads: recording on workers "
+                  << oneList / onWorkers << "x one list\n";
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+        std::string scenario = argc > 1 ? argv[1] : "all";
+
+        // CPU only, they run without a window so machines without a GPU can use them
+        if (scenario == "culling" || scenario == "scene" || scenario == "occlusion") {
+                try {
+                        if (scenario == "culling")
+                                benchCulling();
+                        else if (scenario == "scene")
+                                benchScene();
+                        else
+                                benchOcclusion();
+                }
+                catch (const std::exception& e) {
+                        al::log(std::cerr, __FILE__, __LINE__, e.what());
+                        return EXCEPT_ERR;
+                }
+                return SUCCESS;
+        }
+
+        if (!glfwInit()) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLFW] Error: failed to initialized");
+                return INIT_ERR;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_TITLE, nullptr, nullptr);
+        if (!window) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLFW] Error: couldn't create a window");
+                glfwTerminate();
+                return WINDOW_ERR;
+        }
+
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLAD] Error: couldn't initialize GLAD");
+                glfwTerminate();
+                return GLAD_ERR;
+        }
+        glfwSwapInterval(0);
+
+        std::cout << "[bench] Renderer: " << glGetString(GL_RENDERER) << '\n';
+
+        try {
+                if (scenario == "all" || scenario == "uniforms")
+                        benchUniforms();
+                if (scenario == "all" || scenario == "blocks")
+                        benchBlocks();
+                if (scenario == "all" || scenario == "redundant")
+                        benchRedundant();
+                if (scenario == "all" || scenario == "materials")
+                        benchMaterials();
+                if (scenario == "all" || scenario == "queue")
+                        benchQueue();
+                if (scenario == "all" || scenario == "state")
+                        benchState();
+                if (scenario == "all" || scenario == "culling")
+                        benchCulling();
+                if (scenario == "all" || scenario == "scene")
+                        benchScene();
+                if (scenario == "all" || scenario == "instancing")
+                        benchInstancing();
+                if (scenario == "all" || scenario == "indirect")
+                        benchIndirect();
+                if (scenario == "all" || scenario == "clusters")
+                        benchClusters();
+                if (scenario == "all" || scenario == "prepass")
+                        benchPrepass();
+                if (scenario == "all" || scenario == "queries")
+                        benchQueries();
+                if (scenario == "all" || scenario == "deferred")
+                        benchDeferred();
+                if (scenario == "all" || scenario == "shadows")
+                        benchShadows();
+                if (scenario == "all" || scenario == "atlas")
+                        benchAtlas();
+                if (scenario == "all" || scenario == "resolution")
+                        benchResolution();
+                if (scenario == "all" || scenario == "stream")
+                        benchStream();
+                if (scenario == "all" || scenario == "commands")
+                        benchCommands();
+                if (scenario == "all")
+                        benchOcclusion();
+        }
+        catch (const std::exception& e) {
+                al::log(std::cerr, __FILE__, __LINE__, e.what());
+                glfwTerminate();
+                return EXCEPT_ERR;
+        }
+
+        glfwTerminate();
+        return SUCCESS;
+}
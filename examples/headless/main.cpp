@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////////////////
+#include "config.h"
+#include "culling.h"
+#include "error.h"
+#include "io.h"
+#include "log.h"
+#include "glframebuffer.h"
+#include "glheadless_context.h"
+#include "glmaterial.h"
+#include "glmaterial_table.h"
+#include "glmodel.h"
+#include "glprogram.h"
+#include "glprogram_cache.h"
+#include "glprogram_permutations.h"
+#include "glrender_queue.h"
+#include "glshader_loader.h"
+#include "gltexture_loader.h"
+#include "gluniform_blocks.h"
+
+////////////////////////////////////////////////////////////////////////////////
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+////////////////////////////////////////////////////////////////////////////////
+#include <iostream>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+
+////////////////////////////////////////////////////////////////////////////////
+#define WINDOW_TITLE    "Lovelace Engine Headless"
+
+////////////////////////////////////////////////////////////////////////////////
+#define DEFAULT_FRAMES  60
+#define DEFAULT_WIDTH   1280
+#define DEFAULT_HEIGHT  720
+#define DEFAULT_IMAGE   "sponza.ppm"
+#define DEFAULT_TIMINGS "sponza_timings.csv"
+
+////////////////////////////////////////////////////////////////////////////////
+#define SUCCESS         0x0     // program finished successfully
+#define WINDOW_ERR      0x1     // window initialization failed
+#define GLAD_ERR        0x2     // could't initialize GLAD
+#define INIT_ERR        0x3     // GLFW initialization failed
+#define EXCEPT_ERR      0x4     // an exception has occurred
+#define USAGE_ERR       0x5     // unknown or malformed arguments
+
+////////////////////////////////////////////////////////////////////////////////
+struct options
+{
+        std::string backend             = al::gl::headless_context::isSupported() ? "egl" : "glfw";
+        int frames                      = DEFAULT_FRAMES;
+        int width                       = DEFAULT_WIDTH;
+        int height                      = DEFAULT_HEIGHT;
+        std::string image               = DEFAULT_IMAGE;
+        std::string timings             = DEFAULT_TIMINGS;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static bool parseOptions(int argc, char** argv, options& o)
+{
+        // std::stoi throws on a value that isn't a number, that is a usage error too
+        try {
+                for (int i = 1; i < argc; ++i) {
+                        std::string arg = argv[i];
+                        if (i + 1 >= argc)
+                                return false;
+                        std::string value = argv[++i];
+
+                        if (arg == "--backend" && (value == "egl" || value == "glfw"))
+                                o.backend = value;
+                        else if (arg == "--frames")
+                                o.frames = std::stoi(value);
+                        else if (arg == "--size") {
+                                if (std::sscanf(value.c_str(), "%dx%d", &o.width, &o.height) != 2)
+                                        return false;
+                        }
+                        else if (arg == "--image")
+                                o.image = value;
+                        else if (arg == "--timings")
+                                o.timings = value;
+                        else
+                                return false;
+                }
+        }
+        catch (const std::exception&) {
+                return false;
+        }
+        return o.frames > 0 && o.width > 0 && o.height > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// sponza lit by the sun, the camera turning once around the atrium over the frames;
+// every frame is finished before the next starts, so its time is the whole frame's
+static void renderSponza(const options& o, al::gl::framebuffer& target)
+{
+        std::cout << "[headless] " << o.backend << ": " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << '\n';
+
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+
+        al::gl::texture_loader textureLoader;
+        al::gl::shader_loader shaderLoader;
+        al::gl::program_cache programCache(LOVELACE_ROOT_DIR ".cache/programs/");
+        al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl", &programCache);
+
+        auto loadStart = std::chrono::steady_clock::now();
+        al::gl::model sponza(LOVELACE_ROOT_DIR "models/sponza/Sponza.gltf", textureLoader);
+
+        al::dir_light sun = {
+                glm::vec3(0.2f, 0.2f, 0.2f),            // ambient
+                glm::vec3(1.0f, 1.0f, 1.0f),            // diffuse
+                glm::vec3(1.0f, 1.0f, 1.0f),            // specular
+                glm::vec3(glm::cos(glm::radians(-60.0f)), glm::sin(glm::radians(-60.0f)), 0.0f),      // direction
+                0.5f                                    // intensity
+        };
+
+        al::gl::phong_material sponzaMat;
+        sponzaMat.mEnableAmbientTexture = true;
+        sponzaMat.mEnableDiffuseTexture = true;
+        sponzaMat.mEnableSpecularTexture = true;
+        al::gl::material_table materials;
+        int sponzaMatIndex = materials.add(sponzaMat);
+        materials.upload();
+
+        al::gl::shader_features phongFeatures;
+        phongFeatures.mNumDirLights = 1;
+        phongFeatures.mNumPointLights = 0;
+        phongFeatures.mNumSpotLights = 0;
+        phongFeatures.mUniformBlocks = true;
+        phongFeatures.mMaterialTable = true;
+        al::gl::program& program = *phongPrograms.get(al::gl::specialize(phongFeatures, sponzaMat));
+        program.use();
+        materials.attach(program);
+        program.uniform("uTexMultiplier", glm::vec2(1.0f, 1.0f));
+        double loadTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+
+        glm::mat4 sponzaModel = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
+        al::cull_set sponzaBounds;
+        sponzaBounds.reserve(sponza.getNumMeshes());
+        for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                sponzaBounds.add(sponza.getMeshes()[i].getBounds(), sponzaModel * sponza.getMeshTransform(i));
+        glm::vec3 sponzaMin(1e30f), sponzaMax(-1e30f);
+        for (size_t i = 0; i < sponzaBounds.size(); ++i) {
+                sponzaMin = glm::min(sponzaMin, sponzaBounds.getCenter(i) - sponzaBounds.getExtents(i));
+                sponzaMax = glm::max(sponzaMax, sponzaBounds.getCenter(i) + sponzaBounds.getExtents(i));
+        }
+        glm::vec3 eye = glm::mix(sponzaMin, sponzaMax, glm::vec3(0.5f, 0.2f, 0.5f));
+        glm::mat4 projection = glm::perspective(glm::radians(75.0f), static_cast<float>(o.width) / o.height, 0.1f, 1000.0f);
+
+        al::gl::frame_blocks frameBlocks;
+        al::gl::render_queue renderQueue(&materials);
+        std::vector<unsigned char> visible;
+
+        std::vector<double> cpuTimes, frameTimes;
+        for (int f = 0; f < o.frames; ++f) {
+                auto frameStart = std::chrono::steady_clock::now();
+
+                float yaw = glm::radians(360.0f) * f / o.frames;
+                glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(glm::cos(yaw), -0.1f, glm::sin(yaw)), glm::vec3(0.0f, 1.0f, 0.0f));
+
+                target.bind();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                frameBlocks.setCamera(projection, view, eye);
+                frameBlocks.setLights({ sun }, {}, {});
+                frameBlocks.upload();
+
+                program.use();
+                materials.bind();
+                sponzaBounds.cull(al::frustum(projection * view), visible);
+                sponza.submit(renderQueue, program, sponzaModel, visible, 0.0f, sponzaMatIndex);
+                renderQueue.execute();
+                cpuTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+
+                glFinish();
+                frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        }
+        program.halt();
+
+        std::vector<unsigned char> pixels;
+        target.readPixels(pixels);
+        al::writePPM(o.image, target.getWidth(), target.getHeight(), pixels.data());
+
+        std::ofstream timings(o.timings, std::ios::trunc);
+        timings << "frame,cpu_ms,frame_ms\n";
+        for (int f = 0; f < o.frames; ++f)
+                timings << f << ',' << cpuTimes[f] << ',' << frameTimes[f] << '\n';
+        if (!timings)
+                throw al::exception("", "", "renderSponza", "error writing file " + o.timings, al::etype::unexpected);
+
+        std::vector<double> sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+        std::cout << "[headless] loaded in " << loadTime << " ms, " << o.frames << " frames at " << o.width << 'x' << o.height << ": "
+                  << mean << " ms mean, " << sorted[sorted.size() / 2] << " ms median, " << sorted[sorted.size() * 95 / 100] << " ms 95th percentile, "
+                  << 1000.0 / mean << " frames/s\n";
+        std::cout << "[headless] wrote " << o.image << " and " << o.timings << '\n';
+}
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv)
+{
+        options o;
+        if (!parseOptions(argc, argv, o)) {
+                std::cerr << "usage: " << argv[0] << " [--backend egl|glfw] [--frames n] [--size WxH] [--image out.ppm] [--timings out.csv]\n";
+                return USAGE_ERR;
+        }
+
+        // no window at all, the display server isn't needed
+        if (o.backend == "egl") {
+                try {
+                        al::gl::headless_context context(o.width, o.height);
+                        renderSponza(o, context.getTarget());
+                }
+                catch (const std::exception& e) {
+                        al::log(std::cerr, __FILE__, __LINE__, e.what());
+                        return EXCEPT_ERR;
+                }
+                return SUCCESS;
+        }
+
+        // a hidden window only provides the context, drawing goes to the same kind of target
+        if (!glfwInit()) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLFW] Error: failed to initialized");
+                return INIT_ERR;
+        }
+
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+        GLFWwindow* window = glfwCreateWindow(o.width, o.height, WINDOW_TITLE, nullptr, nullptr);
+        if (!window) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLFW] Error: couldn't create a window");
+                glfwTerminate();
+                return WINDOW_ERR;
+        }
+
+        glfwMakeContextCurrent(window);
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+                al::log(std::cerr, __FILE__, __LINE__, "[GLAD] Error: couldn't initialize GLAD");
+                glfwTerminate();
+                return GLAD_ERR;
+        }
+        glfwSwapInterval(0);
+
+        try {
+                al::gl::framebuffer target(o.width, o.height, { GL_RGBA8 });
+                renderSponza(o, target);
+        }
+        catch (const std::exception& e) {
+                al::log(std::cerr, __FILE__, __LINE__, e.what());
+                glfwTerminate();
+                return EXCEPT_ERR;
+        }
+
+        glfwTerminate();
+        return SUCCESS;
+}
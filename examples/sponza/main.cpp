@@ -1,15 +1,31 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "config.h"
+#include "culling.h"
 #include "error.h"
+#include "file_watcher.h"
 #include "io.h"
 #include "log.h"
+#include "occlusion.h"
 #include "fpscamera.h"
 #include "glmesh.h"
 #include "glmaterial.h"
+#include "glmaterial_table.h"
 #include "gltexture_loader.h"
 #include "glshader_loader.h"
+#include "glclustered_lights.h"
+#include "gldeferred_renderer.h"
+#include "gldepth_prepass.h"
+#include "gldynamic_resolution.h"
 #include "glmodel.h"
+#include "glocclusion_queries.h"
 #include "glprogram.h"
+#include "glprogram_cache.h"
+#include "glprogram_permutations.h"
+#include "glrender_queue.h"
+#include "glshadow_atlas.h"
+#include "glshadow_cascades.h"
+#include "glstream_buffer.h"
+#include "gluniform_blocks.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 #ifdef DEBUG
@@ -30,6 +46,8 @@
 #include <vector>
 #include <cmath>
 #include <string>
+#include <chrono>
+#include <random>
 
 ////////////////////////////////////////////////////////////////////////////////
 #ifdef DEBUG
@@ -44,6 +62,22 @@
 #define CAMERA_MIN_FOV  30.0f
 #define CAMERA_MAX_FOV  120.0f
 
+////////////////////////////////////////////////////////////////////////////////
+#define OCCLUSION_WIDTH         320
+#define OCCLUSION_HEIGHT        180
+#define OCCLUDER_TRIANGLES      20000   // budget of the largest meshes rasterized as occluders
+
+////////////////////////////////////////////////////////////////////////////////
+#define POINT_LIGHTS            1024    // scattered over the atrium, binned into clusters
+#define POINT_LIGHT_RANGE       8.0f
+#define SHADOWED_POINT_LIGHTS   32      // the first of them cast shadows from the atlas
+
+////////////////////////////////////////////////////////////////////////////////
+#define SHADOW_MAP_SIZE         2048    // per cascade, the sun's shadows end at the far side of the atrium
+
+////////////////////////////////////////////////////////////////////////////////
+#define FRAME_STREAM_SIZE       (256 * 1024)    // bytes streamed per frame, the frame blocks and room to spare
+
 ////////////////////////////////////////////////////////////////////////////////
 #define SUCCESS         0x0     // program finished successfully
 #define WINDOW_ERR      0x1     // window initialization failed
@@ -55,6 +89,10 @@
 int fwidth = WINDOW_WIDTH;
 int fheight = WINDOW_HEIGHT;
 bool cursorCaptured;
+bool hardwareOcclusion;         // GPU queries instead of the CPU occlusion buffer
+bool prepassEnabled = true;     // depth prepass, sponza's atrium overdraws a lot
+bool pointLightsEnabled;
+bool deferredEnabled;           // gbuffer and one lighting pass instead of forward shading
 
 ////////////////////////////////////////////////////////////////////////////////
 al::fpscamera camera((float)fwidth, (float)fheight, {
@@ -97,6 +135,18 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
         if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
 
+        if (key == GLFW_KEY_O && action == GLFW_PRESS)
+                hardwareOcclusion = !hardwareOcclusion;
+
+        if (key == GLFW_KEY_P && action == GLFW_PRESS)
+                prepassEnabled = !prepassEnabled;
+
+        if (key == GLFW_KEY_L && action == GLFW_PRESS)
+                pointLightsEnabled = !pointLightsEnabled;
+
+        if (key == GLFW_KEY_G && action == GLFW_PRESS)
+                deferredEnabled = !deferredEnabled;
+
         camera.updateState(key, action);
 }
 
@@ -216,8 +266,10 @@ int main(void)
 
                 al::gl::texture_loader textureLoader;
                 al::gl::shader_loader shaderLoader;
-                al::gl::program program{shaderLoader.load(GL_VERTEX_SHADER, LOVELACE_ROOT_DIR "shaders/phong.glsl"),
-                                        shaderLoader.load(GL_FRAGMENT_SHADER, LOVELACE_ROOT_DIR "shaders/phong.glsl")};
+                al::gl::program_cache programCache(LOVELACE_ROOT_DIR ".cache/programs/");
+
+                al::gl::program_permutations phongPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/phong.glsl", &programCache);
+                al::gl::program_permutations boundsPrograms(shaderLoader, LOVELACE_ROOT_DIR "shaders/bounds.glsl", &programCache);
 
                 // meshes
                 al::gl::model sponza(LOVELACE_ROOT_DIR "models/sponza/Sponza.gltf", textureLoader);
@@ -239,6 +291,156 @@ int main(void)
                 sponzaMat.mEnableDiffuseTexture = true;
                 sponzaMat.mEnableSpecularTexture = true;
 
+                al::gl::material_table materials;
+                int sponzaMatIndex = materials.add(sponzaMat);
+                materials.upload();
+
+                // branch-free phong specialized for sponza's material, camera and lights come from blocks
+                al::gl::shader_features phongFeatures;
+                phongFeatures.mNumDirLights = static_cast<int>(dirLights.size());
+                phongFeatures.mNumPointLights = 0;
+                phongFeatures.mNumSpotLights = 0;
+                phongFeatures.mUniformBlocks = true;
+                phongFeatures.mMaterialTable = true;
+                phongFeatures.mClustered = true;
+                phongFeatures.mShadows = true;
+                phongFeatures.mLightShadows = true;
+
+                al::gl::stream_buffer frameStream(GL_UNIFORM_BUFFER, FRAME_STREAM_SIZE);
+                al::gl::frame_blocks frameBlocks(frameStream);
+
+                // cold start compiles phong.glsl, warm start loads the cached binary
+                auto programStart = std::chrono::steady_clock::now();
+                al::gl::program& program = *phongPrograms.get(al::gl::specialize(phongFeatures, sponzaMat));
+                std::chrono::duration<double, std::milli> programTime = std::chrono::steady_clock::now() - programStart;
+                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Program ready in ", programTime.count(), " ms");
+
+                // resolved once, per-frame updates don't touch strings
+                auto uTexMultiplier     = program.handle<glm::vec2>("uTexMultiplier");
+
+                // draws are sorted by program, textures and vao before they execute
+                al::gl::render_queue renderQueue(&materials);
+                bool loggedStats = false;
+
+                program.use();
+                materials.attach(program);
+                program.halt();
+
+                // position-only copy of sponza drawn by a depth-only permutation of the same program
+                al::gl::shader_features depthFeatures = phongFeatures;
+                depthFeatures.mDepthOnly = true;
+                depthFeatures.mShadows = false;
+                depthFeatures.mLightShadows = false;
+                depthFeatures.mMaterialTable = false;
+                depthFeatures.mVertexFormat = al::gl::VERTEX_POSITION;
+                al::gl::depth_prepass depthPrepass(*phongPrograms.get(depthFeatures));
+                for (const al::gl::mesh& m : sponza.getMeshes())
+                        depthPrepass.add(m);
+                depthPrepass.upload();
+
+                // sponza doesn't move, its world space boxes are computed once
+                glm::mat4 sponzaModel = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
+                al::cull_set sponzaBounds;
+                sponzaBounds.reserve(sponza.getNumMeshes());
+                for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                        sponzaBounds.add(sponza.getMeshes()[i].getBounds(), sponzaModel * sponza.getMeshTransform(i));
+                std::vector<unsigned char> sponzaVisible;
+
+                // walls, floors and pillars hide most of the atrium from inside it
+                std::vector<al::bounds> meshBounds;
+                std::vector<size_t> meshTriangles;
+                for (const al::gl::mesh& m : sponza.getMeshes()) {
+                        meshBounds.push_back(m.getBounds());
+                        meshTriangles.push_back(m.getVao().getEbo().getSize() / 3);
+                }
+                std::vector<size_t> occluders = al::selectOccluders(meshBounds, meshTriangles, OCCLUDER_TRIANGLES);
+
+                al::worker_pool workers;
+                al::occlusion_buffer occlusion(OCCLUSION_WIDTH, OCCLUSION_HEIGHT, &workers);
+
+                // small colored lights over the lower half of the atrium, L switches them on
+                glm::vec3 sponzaMin(1e30f), sponzaMax(-1e30f);
+                for (size_t i = 0; i < sponzaBounds.size(); ++i) {
+                        sponzaMin = glm::min(sponzaMin, sponzaBounds.getCenter(i) - sponzaBounds.getExtents(i));
+                        sponzaMax = glm::max(sponzaMax, sponzaBounds.getCenter(i) + sponzaBounds.getExtents(i));
+                }
+                std::mt19937 rng(1);
+                std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+                std::vector<al::point_light> pointLights(POINT_LIGHTS);
+                for (al::point_light& l : pointLights) {
+                        l.mDiffuse = l.mSpecular = glm::vec3(unit(rng), unit(rng), unit(rng));
+                        l.mPosition = glm::mix(sponzaMin, sponzaMax, glm::vec3(unit(rng), 0.5f * unit(rng), unit(rng)));
+                        l.mRange = POINT_LIGHT_RANGE;
+                        l.mIntensity = 1.0f;
+                        l.recalculateTerms();
+                }
+                for (int i = 0; i < SHADOWED_POINT_LIGHTS; ++i)
+                        pointLights[i].mShadow = i;
+                const std::vector<al::point_light> noPointLights;
+
+                // every fragment only evaluates the lights of its cluster
+                al::gl::clustered_lights clusters(&workers);
+                program.use();
+                clusters.attach(program);
+                program.halt();
+
+                // or sponza is drawn into a gbuffer once and the clusters light it in one pass, G switches
+                al::gl::shader_features gbufferFeatures = phongFeatures;
+                gbufferFeatures.mGBuffer = true;
+                gbufferFeatures.mClustered = false;
+                gbufferFeatures.mShadows = false;
+                gbufferFeatures.mLightShadows = false;
+                al::gl::program& gbufferProgram = *phongPrograms.get(al::gl::specialize(gbufferFeatures, sponzaMat));
+                auto uGBufferTexMultiplier = gbufferProgram.handle<glm::vec2>("uTexMultiplier");
+                gbufferProgram.use();
+                materials.attach(gbufferProgram);
+
+                al::gl::shader_features lightingFeatures = phongFeatures;
+                lightingFeatures.mMaterialTable = false;
+                lightingFeatures.mDeferredLighting = true;
+                al::gl::program& lightingProgram = *phongPrograms.get(lightingFeatures);
+                lightingProgram.use();
+                clusters.attach(lightingProgram);
+                lightingProgram.halt();
+                al::gl::deferred_renderer deferred(lightingProgram, fwidth, fheight);
+
+                // the sun's shadows, sponza is static so the far cascades are drawn once
+                al::gl::shader_features shadowFeatures = depthFeatures;
+                shadowFeatures.mUniformBlocks = false;
+                shadowFeatures.mClustered = false;
+                al::gl::shadow_cascades shadows(*phongPrograms.get(shadowFeatures), SHADOW_MAP_SIZE);
+                shadows.setSplits(glm::length(sponzaMax - sponzaMin), 0.75f);
+                shadows.setCasterDistance(glm::length(sponzaMax - sponzaMin));
+                program.use();
+                shadows.attach(program);
+                lightingProgram.use();
+                shadows.attach(lightingProgram);
+                lightingProgram.halt();
+
+                // and the point lights', a tile is only redrawn when its light changes
+                al::gl::shadow_atlas lightShadows(*phongPrograms.get(shadowFeatures), SHADOWED_POINT_LIGHTS);
+                program.use();
+                lightShadows.attach(program);
+                lightingProgram.use();
+                lightShadows.attach(lightingProgram);
+                lightingProgram.halt();
+
+                // or the GPU tests every mesh's box against the frame's depth, O switches
+                al::gl::occlusion_queries queries(*boundsPrograms.get(al::gl::shader_features{}), sponza.getNumMeshes());
+                size_t queriesIssued = 0, queriesSkipped = 0, queriesConditional = 0;
+                double queriesLatency = 0.0;
+
+                size_t cullFrames = 0, cullTested = 0, cullVisible = 0, cullUnoccluded = 0;
+                double cullTime = 0.0, occlusionTime = 0.0, cullReport = glfwGetTime();
+
+                // the scene is drawn at whatever fraction of the window keeps the GPU within 60 fps
+                al::gl::dynamic_resolution resolution(fwidth, fheight);
+                size_t resolutionLogged = 0;
+
+                // edits to phong.glsl are recompiled in the background and swapped in when linked
+                al::file_watcher shaderWatcher;
+                shaderWatcher.watch(phongPrograms.getUrl());
+
                 // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
                 while (!glfwWindowShouldClose(window)) {
                         float dt = []() {
@@ -256,29 +458,188 @@ int main(void)
                                 return deltaTime;
                         }();
 
+                        for (const std::string& path : shaderWatcher.poll())
+                                if (path == phongPrograms.getUrl())
+                                        phongPrograms.reload();
+                        phongPrograms.update();
+
+                        // the gbuffer is allocated like the target, at the largest scale, and
+                        // drawn in the scaled viewport, so scaling never reallocates it either
+                        resolution.resize(fwidth, fheight);
+                        deferred.resize(resolution.getTarget().getWidth(), resolution.getTarget().getHeight());
+                        resolution.begin();
                         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
                         camera.update(dt);
 
+                        // the clusters index the pixels of the scaled target, not the window's
+                        al::fpscamera renderCamera = camera;
+                        renderCamera.mScreenWidth = static_cast<float>(resolution.getWidth());
+                        renderCamera.mScreenHeight = static_cast<float>(resolution.getHeight());
+
                         glm::mat4 projection = camera.getProjection();
                         glm::mat4 view = camera.getView();
 
-                        glm::mat4 sponzaModel = glm::scale(glm::mat4(1.0f), glm::vec3(0.1f));
-                        glm::mat4 sponzaNormal = glm::transpose(glm::inverse(sponzaModel));
-                        glm::mat4 sponzaPVM = projection * view * sponzaModel;
-
-                        program.use();
-                        program.uniform("uModel", sponzaModel);
-                        program.uniform("uNormal", sponzaNormal);
-                        program.uniform("uPVM", sponzaPVM);
-                        program.uniform("uViewPos", camera.mPosition);
-                        program.uniform("uTexMultiplier", glm::vec2(1.0f, 1.0f));
-
-                        program.uniform("uMaterial", sponzaMat);
-                        program.uniform("uDirLights", dirLights);
-
-                        // draw sponza
-                        sponza.draw();
+                        // one upload per frame, shared by every program bound to the blocks
+                        frameStream.begin();
+                        frameBlocks.setCamera(projection, view, camera.mPosition);
+                        frameBlocks.setLights(dirLights, {}, {});
+                        frameBlocks.upload();
+                        clusters.update(renderCamera, pointLightsEnabled ? pointLights : noPointLights, {});
+
+                        // every mesh is submitted, each cascade culls them against its own slice
+                        for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                                shadows.submit(sponza.getMeshes()[i], sponzaModel * sponza.getMeshTransform(i));
+                        shadows.render(camera, sun);
+                        if (pointLightsEnabled) {
+                                for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                                        lightShadows.submit(sponza.getMeshes()[i], sponzaModel * sponza.getMeshTransform(i));
+                                lightShadows.render(camera, pointLights, {});
+                        }
+
+                        // the deferred path only needs the clusters when it lights the gbuffer
+                        al::gl::program& sceneProgram = deferredEnabled ? gbufferProgram : program;
+                        sceneProgram.use();
+                        if (deferredEnabled)
+                                gbufferProgram.uniform(uGBufferTexMultiplier, glm::vec2(1.0f, 1.0f));
+                        else {
+                                program.uniform(uTexMultiplier, glm::vec2(1.0f, 1.0f));
+                                clusters.uniforms(program);
+                                clusters.bind();
+                                shadows.uniforms(program);
+                                shadows.bind();
+                                lightShadows.bind();
+                        }
+                        materials.bind();
+
+                        // draw the sponza meshes inside the view frustum
+                        auto cullStart = std::chrono::steady_clock::now();
+                        cullVisible += sponzaBounds.cull(al::frustum(projection * view), sponzaVisible);
+                        cullTime += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - cullStart).count();
+                        cullTested += sponzaBounds.size();
+                        ++cullFrames;
+
+                        // then whatever hides behind the occluders in view; with a prepass every mesh it
+                        // lays depth for has to shade under GL_EQUAL, and a pending query may answer
+                        // between the two passes, so the color pass isn't conditional then
+                        if (hardwareOcclusion) {
+                                queries.update();
+                                for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                                        if (sponzaVisible[i] && queries.isVisible(i))
+                                                renderQueue.submit(sponza.getMeshes()[i], sceneProgram, sponzaModel * sponza.getMeshTransform(i), 0.0f,
+                                                                   sponzaMatIndex, 0, GL_TRIANGLES, prepassEnabled ? 0 : queries.getCondition(i));
+                        }
+                        else {
+                                auto occlusionStart = std::chrono::steady_clock::now();
+                                occlusion.begin(projection * view);
+                                for (size_t i : occluders) {
+                                        if (!sponzaVisible[i])
+                                                continue;
+                                        const auto& vao = sponza.getMeshes()[i].getVao();
+                                        size_t stride = vao.getInfos().front().stride / sizeof(float);
+                                        occlusion.addOccluder(vao.getVbo().getData().data(), stride, 0, vao.getEbo().getData().data(), vao.getEbo().getSize(),
+                                                              sponzaModel * sponza.getMeshTransform(i));
+                                }
+                                occlusion.rasterize();
+                                cullUnoccluded += occlusion.test(sponzaBounds, sponzaVisible);
+                                occlusionTime += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - occlusionStart).count();
+
+                                sponza.submit(renderQueue, sceneProgram, sponzaModel, sponzaVisible, 0.0f, sponzaMatIndex);
+                        }
+
+                        // the same meshes lay down depth first, so phong runs once per pixel
+                        depthPrepass.setEnabled(prepassEnabled);
+                        if (prepassEnabled)
+                                for (size_t i = 0; i < sponza.getNumMeshes(); ++i)
+                                        if (sponzaVisible[i] && (!hardwareOcclusion || queries.isVisible(i)))
+                                                depthPrepass.submit(sponza.getMeshes()[i], sponzaModel * sponza.getMeshTransform(i));
+                        if (deferredEnabled)
+                                deferred.beginGeometry();
+                        depthPrepass.begin(projection * view);
+                        renderQueue.execute();
+                        depthPrepass.end();
+
+                        if (hardwareOcclusion) {
+                                // tested against this frame's depth, read back in a later frame
+                                queries.issue(sponzaBounds, sponzaVisible, projection * view);
+
+                                const al::gl::occlusion_stats& stats = queries.getStats();
+                                queriesIssued += stats.mQueriesIssued;
+                                queriesSkipped += stats.mObjectsSkipped;
+                                queriesConditional += stats.mConditionalDraws;
+                                queriesLatency += stats.mLatency;
+                        }
+
+                        if (deferredEnabled) {
+                                deferred.endGeometry();
+                                lightingProgram.use();
+                                clusters.uniforms(lightingProgram);
+                                clusters.bind();
+                                shadows.uniforms(lightingProgram);
+                                shadows.bind();
+                                lightShadows.bind();
+                                deferred.light(projection * view);
+                        }
                         program.halt();
+                        resolution.end();
+                        resolution.present();
+                        frameStream.end();
+
+                        for (const al::gl::resolution_change& change : resolution.getHistory()) {
+                                if (change.mFrame < resolutionLogged)
+                                        continue;
+                                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Resolution scale ", change.mScale, " from frame ", change.mFrame,
+                                                                       " after ", change.mTime, " ms on the GPU");
+                                resolutionLogged = change.mFrame + 1;
+                        }
+
+                        // switches the sorted queue actually issued in the first frame
+                        if (!loggedStats) {
+                                const al::gl::render_stats& stats = renderQueue.getStats();
+                                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Render queue: ", stats.mDraws, " draws, ", stats.mProgramSwitches, " programs, ",
+                                                                       stats.mTextureSwitches, " texture and ", stats.mVaoSwitches, " vao switches");
+                                loggedStats = true;
+                        }
+
+                        if (glfwGetTime() - cullReport >= 1.0) {
+                                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Culled ", 100.0 * (cullTested - cullVisible) / cullTested,
+                                                                       "% of meshes in ", cullTime / cullFrames, " us per frame");
+                                if (hardwareOcclusion)
+                                        al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Queries: ", queriesIssued / cullFrames, " issued, ",
+                                                                               queriesSkipped / cullFrames, " skipped, ", queriesConditional / cullFrames,
+                                                                               " conditional per frame, results after ", queriesLatency / cullFrames, " frames");
+                                else
+                                        al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Occluded ", 100.0 * (cullVisible - cullUnoccluded) / cullTested,
+                                                                               "% of meshes in ", occlusionTime / cullFrames, " us per frame (",
+                                                                               occluders.size(), " occluders, ", workers.size() + 1, " threads)");
+                                const al::gl::depth_prepass_stats& prepassStats = depthPrepass.getStats();
+                                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Depth prepass ", depthPrepass.isEnabled() ? "on: " : "off: ",
+                                                                       prepassStats.mDraws, " draws, ", prepassStats.mOverdraw, " shaded samples per pixel");
+                                if (pointLightsEnabled) {
+                                        al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Clusters: ", pointLights.size(), " point lights, ",
+                                                                               clusters.getGrid().getIndices().size(), " light references in ", clusters.getGrid().size(), " clusters");
+                                        const al::gl::shadow_atlas_stats& atlasStats = lightShadows.getStats();
+                                        al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Shadow atlas: ", atlasStats.mLights, " lights, ",
+                                                                               atlasStats.mDropped, " dropped, ", 100.0f * atlasStats.mUsage, "% used, ",
+                                                                               atlasStats.mFaces, " faces redrawn, ", atlasStats.mTime, " ms");
+                                }
+                                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Resolution ", resolution.getWidth(), 'x', resolution.getHeight(),
+                                                                       " at scale ", resolution.getScale(), ", ", resolution.getTime(), " of ",
+                                                                       resolution.getPolicy().mBudget, " ms on the GPU");
+                                const al::gl::stream_stats& streamStats = frameStream.getStats();
+                                al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Frame stream ", frameStream.isPersistent() ? "persistent: " : "orphaned: ",
+                                                                       streamStats.mUsed, " bytes, ", streamStats.mWaits, " fence waits in ", streamStats.mWaitTime, " ms");
+                                for (int i = 0; i < shadows.getNumCascades(); ++i) {
+                                        const al::gl::shadow_cascade_stats& shadowStats = shadows.getStats(i);
+                                        al::log(std::cout, __FILE__, __LINE__, "[LovelaceEngine] Shadow cascade ", i, " to ", shadowStats.mSplit, ": ",
+                                                                               shadowStats.mCached ? "cached, " : "drawn, ", shadowStats.mDraws, " draws, ",
+                                                                               shadowStats.mTime, " ms");
+                                }
+                                cullFrames = cullTested = cullVisible = cullUnoccluded = 0;
+                                queriesIssued = queriesSkipped = queriesConditional = 0;
+                                queriesLatency = 0.0;
+                                cullTime = occlusionTime = 0.0;
+                                cullReport = glfwGetTime();
+                        }
 
                         glfwSwapBuffers(window);
                         glfwPollEvents();
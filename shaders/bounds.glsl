@@ -0,0 +1,27 @@
+#ifdef VERTEX_SHADER
+
+////////////////////////////////////////////////////////////////////////////////
+layout (location = 0) in vec3 aPos;
+
+////////////////////////////////////////////////////////////////////////////////
+uniform mat4 uPVM;
+
+////////////////////////////////////////////////////////////////////////////////
+void main()
+{
+        gl_Position = uPVM * vec4(aPos, 1.0f);
+}
+
+#elif defined(FRAGMENT_SHADER)
+
+////////////////////////////////////////////////////////////////////////////////
+out vec4 color;
+
+////////////////////////////////////////////////////////////////////////////////
+// color and depth writes are masked while boxes are queried, only samples count
+void main()
+{
+        color = vec4(1.0f);
+}
+
+#endif
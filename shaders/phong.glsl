@@ -1,12 +1,51 @@
+////////////////////////////////////////////////////////////////////////////////
+// camera shared by every draw of the frame, see al::gl::frame_blocks
+#ifdef UNIFORM_BLOCKS
+layout (std140) uniform frame_block
+{
+        mat4 uProjection;
+        mat4 uView;
+        mat4 uProjectionView;
+        vec3 uViewPos;
+        ivec4 uLightCounts;
+};
+#endif
+
 #ifdef VERTEX_SHADER
 
+#ifdef DEFERRED_LIGHTING
+////////////////////////////////////////////////////////////////////////////////
+// one triangle covering the viewport, drawn from gl_VertexID without attributes
+void main()
+{
+        vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(2.0f * corner - 1.0f, 0.0f, 1.0f);
+}
+#else
 ////////////////////////////////////////////////////////////////////////////////
 layout (location = 0) in vec3 aPos;
+#ifdef HAS_NORMAL
 layout (location = 1) in vec3 aNorm;
+#endif
+#ifdef HAS_TEXCOORD
 layout (location = 2) in vec2 aTexCoord;
+#endif
+#ifdef INSTANCED
+layout (location = 3) in mat4 aModel;
+layout (location = 7) in int aMaterialIndex;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// a depth prepass and the GL_EQUAL main pass must agree on every depth
+invariant gl_Position;
 
 ////////////////////////////////////////////////////////////////////////////////
+#ifndef UNIFORM_BLOCKS
 uniform mat4 uPVM;
+#ifdef INSTANCED
+uniform mat4 uProjectionView;
+#endif
+#endif
 uniform mat4 uModel;
 uniform mat4 uNormal;
 uniform vec2 uTexMultiplier;
@@ -15,15 +54,41 @@ uniform vec2 uTexMultiplier;
 out vec3 vNorm;
 out vec2 vTexCoord;
 out vec3 vFragPos;
+#ifdef INSTANCED
+flat out int vMaterialIndex;
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 void main()
 {
+#ifdef INSTANCED
+        // uModel places the mesh within its model, the instance places the model
+        mat4 model = aModel * uModel;
+        mat4 normalMatrix = mat4(transpose(inverse(mat3(model))));
+        gl_Position = uProjectionView * model * vec4(aPos, 1.0f);
+        vMaterialIndex = aMaterialIndex;
+#else
+        mat4 model = uModel;
+        mat4 normalMatrix = uNormal;
+#ifdef UNIFORM_BLOCKS
+        gl_Position = uProjectionView * uModel * vec4(aPos, 1.0f);
+#else
         gl_Position = uPVM * vec4(aPos, 1.0f);
-        vNorm = vec3(uNormal * vec4(aNorm, 0.0f));
-        vFragPos = vec3(uModel * vec4(aPos, 1.0f));
+#endif
+#endif
+#ifdef HAS_NORMAL
+        vNorm = vec3(normalMatrix * vec4(aNorm, 0.0f));
+#else
+        vNorm = vec3(0.0f, 1.0f, 0.0f);
+#endif
+        vFragPos = vec3(model * vec4(aPos, 1.0f));
+#ifdef HAS_TEXCOORD
         vTexCoord = uTexMultiplier * aTexCoord;
+#else
+        vTexCoord = vec2(0.0f);
+#endif
 }
+#endif
 
 #elif defined(FRAGMENT_SHADER)
 
@@ -96,25 +161,113 @@ struct spotLight_t
 };
 
 ////////////////////////////////////////////////////////////////////////////////
+// defaults, shader_loader injects the counts of each permutation
+#ifndef NUM_DIR_LIGHTS
 #define NUM_DIR_LIGHTS          2
+#endif
+#ifndef NUM_POINT_LIGHTS
 #define NUM_POINT_LIGHTS        4
+#endif
+#ifndef NUM_SPOT_LIGHTS
 #define NUM_SPOT_LIGHTS         2
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
+// with uniform blocks the counts are read at runtime, up to the block capacities
+#ifdef UNIFORM_BLOCKS
+#define DIR_LIGHT_COUNT         uLightCounts.x
+#define POINT_LIGHT_COUNT       uLightCounts.y
+#define SPOT_LIGHT_COUNT        uLightCounts.z
+#else
+#define DIR_LIGHT_COUNT         NUM_DIR_LIGHTS
+#define POINT_LIGHT_COUNT       NUM_POINT_LIGHTS
+#define SPOT_LIGHT_COUNT        NUM_SPOT_LIGHTS
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// static materials resolve texture presence at compile time, so no branching
+#ifdef STATIC_MATERIAL
+#define ENABLE_AMBIENT_TEXTURE(material)        HAS_AMBIENT_TEXTURE
+#define ENABLE_DIFFUSE_TEXTURE(material)        HAS_DIFFUSE_TEXTURE
+#define ENABLE_SPECULAR_TEXTURE(material)       HAS_SPECULAR_TEXTURE
+#else
+#define ENABLE_AMBIENT_TEXTURE(material)        material.enableAmbientTexture
+#define ENABLE_DIFFUSE_TEXTURE(material)        material.enableDiffuseTexture
+#define ENABLE_SPECULAR_TEXTURE(material)       material.enableSpecularTexture
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+#ifdef DEFERRED_LIGHTING
+// rebuilt from the G-buffer depth by main(), the light functions read it like the varying
+vec3 vFragPos;
+#else
 in vec3 vNorm;
 in vec3 vFragPos;
 in vec2 vTexCoord;
+#ifdef INSTANCED
+flat in int vMaterialIndex;
+#endif
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
+#ifdef UNIFORM_BLOCKS
+layout (std140) uniform dir_light_block         { dirLight_t    uDirLights      [MAX_DIR_LIGHTS];       };
+layout (std140) uniform point_light_block       { pointLight_t  uPointLights    [MAX_POINT_LIGHTS];     };
+layout (std140) uniform spot_light_block        { spotLight_t   uSpotLights     [MAX_SPOT_LIGHTS];      };
+#else
+#if NUM_DIR_LIGHTS > 0
 uniform dirLight_t      uDirLights      [NUM_DIR_LIGHTS];
+#endif
+#if NUM_POINT_LIGHTS > 0
 uniform pointLight_t    uPointLights    [NUM_POINT_LIGHTS];
+#endif
+#if NUM_SPOT_LIGHTS > 0
 uniform spotLight_t     uSpotLights     [NUM_SPOT_LIGHTS];
+#endif
+uniform vec3 uViewPos;
+#endif
 
+#ifdef CLUSTERED
+uniform samplerBuffer uClusterLights;
+uniform usamplerBuffer uClusterCells;
+uniform usamplerBuffer uClusterIndices;
+uniform ivec4 uClusterDims;             // clusters along x, y and z, first spot light texel
+uniform vec4 uClusterScale;             // clusters per pixel along x and y, log depth scale and bias
+uniform vec2 uClusterPlanes;            // near, far
+#endif
+
+#ifdef SHADOWS
+uniform sampler2DArrayShadow uShadowMap;
+uniform mat4 uShadowMatrices[MAX_SHADOW_CASCADES];      // world to map coordinates and depth
+uniform vec4 uShadowSplits;             // far end of each cascade along the view direction
+uniform vec4 uShadowTexels;             // world size of a texel in each cascade
+uniform vec4 uShadowDepthPlane;         // distance along the view direction of a position
+uniform int uShadowCascades;
+#endif
+
+#ifdef LIGHT_SHADOWS
+uniform sampler2DShadow uShadowAtlas;
+uniform samplerBuffer uShadowAtlasData;        // SHADOW_ATLAS_TEXELS per slot, see al::gl::shadow_atlas
+#endif
+
+#ifdef DEFERRED_LIGHTING
+uniform sampler2D uGBufferAlbedo;       // diffuse rgb, specular gray
+uniform sampler2D uGBufferNormal;       // octahedral normal xy, encoded shininess
+uniform sampler2D uGBufferDepth;
+uniform mat4 uInverseProjectionView;
+uniform vec4 uViewport;                 // x, y, width, height, the G-buffer may be larger
+#elif defined(MATERIAL_TABLE)
+uniform samplerBuffer uMaterials;
+uniform int uMaterialIndex;
+uniform sampler2D uAmbientTexture;
+uniform sampler2D uDiffuseTexture;
+uniform sampler2D uSpecularTexture;
+#else
 uniform material_t uMaterial;
-uniform vec3 uViewPos;
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
-vec3 computeDirLight(material_cached_t material, dirLight_t light, vec3 normal, vec3 viewDir)
+vec3 computeDirLight(material_cached_t material, dirLight_t light, vec3 normal, vec3 viewDir, float shadow)
 {
         // ambient light
         vec3 ambient = light.ambient * material.diffuse;
@@ -128,7 +281,7 @@ vec3 computeDirLight(material_cached_t material, dirLight_t light, vec3 normal,
         float spec = pow(max(dot(viewDir, reflectDir), 0.0f), material.shininess);
         vec3 specular = spec * light.specular * material.specular;
 
-        vec3 result = ambient + light.intensity * (diffuse + specular);
+        vec3 result = ambient + shadow * light.intensity * (diffuse + specular);
         return max(result, vec3(0.0f));
 }
 
@@ -179,22 +332,194 @@ vec3 computeSpotLight(material_cached_t material, spotLight_t light, vec3 normal
         return max(result, vec3(0.0f));
 }
 
+#ifdef SHADOWS
+////////////////////////////////////////////////////////////////////////////////
+// 1 where the first directional light reaches vFragPos, filtered over 2x2 hardware comparisons
+float computeShadow(vec3 normal)
+{
+        float depth = dot(vec4(vFragPos, 1.0f), uShadowDepthPlane);
+        if (depth > uShadowSplits[uShadowCascades - 1])
+                return 1.0f;
+
+        int cascade = 0;
+        while (cascade < uShadowCascades - 1 && depth > uShadowSplits[cascade])
+                ++cascade;
+
+        // pushed off the surface by a texel and a half against acne on slopes
+        vec3 position = vFragPos + 1.5f * uShadowTexels[cascade] * normal;
+        vec4 coord = uShadowMatrices[cascade] * vec4(position, 1.0f);
+        vec2 texel = 1.0f / vec2(textureSize(uShadowMap, 0).xy);
+
+        float lit = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+                vec2 offset = vec2((i & 1) != 0 ? 0.5f : -0.5f, (i & 2) != 0 ? 0.5f : -0.5f);
+                lit += texture(uShadowMap, vec4(coord.xy + offset * texel, float(cascade), coord.z));
+        }
+        return 0.25f * lit;
+}
+#endif
+
+#ifdef LIGHT_SHADOWS
+////////////////////////////////////////////////////////////////////////////////
+// 1 where the light of the slot at lightPosition reaches vFragPos, a point light picks
+// the cube face of its major axis; the slot's header holds the face count, 0 without a
+// tile this frame, and the world size of a texel one unit from the light
+float computeLightShadow(int slot, vec3 lightPosition, vec3 normal)
+{
+        if (slot < 0)
+                return 1.0f;
+        int base = SHADOW_ATLAS_TEXELS * slot;
+        vec4 header = texelFetch(uShadowAtlasData, base);
+        if (header.x == 0.0f)
+                return 1.0f;
+
+        // pushed off the surface by a texel and a half, texels grow with the distance
+        vec3 position = vFragPos + 1.5f * header.y * length(vFragPos - lightPosition) * normal;
+        vec3 d = position - lightPosition;
+        vec3 a = abs(d);
+        int face = 0;
+        if (header.x > 1.0f)
+                face = a.x >= a.y && a.x >= a.z ? (d.x > 0.0f ? 0 : 1) : a.y >= a.z ? (d.y > 0.0f ? 2 : 3) : (d.z > 0.0f ? 4 : 5);
+
+        int m = base + 1 + 4 * face;
+        mat4 matrix = mat4(texelFetch(uShadowAtlasData, m + 0), texelFetch(uShadowAtlasData, m + 1),
+                           texelFetch(uShadowAtlasData, m + 2), texelFetch(uShadowAtlasData, m + 3));
+        vec4 coord = matrix * vec4(position, 1.0f);
+        coord.xyz /= coord.w;
+        vec2 texel = 1.0f / vec2(textureSize(uShadowAtlas, 0));
+
+        float lit = 0.0f;
+        for (int i = 0; i < 4; ++i) {
+                vec2 offset = vec2((i & 1) != 0 ? 0.5f : -0.5f, (i & 2) != 0 ? 0.5f : -0.5f);
+                lit += texture(uShadowAtlas, vec3(coord.xy + offset * texel, coord.z));
+        }
+        return 0.25f * lit;
+}
+#endif
+
+#ifdef CLUSTERED
+////////////////////////////////////////////////////////////////////////////////
+// the cluster of the fragment, depth is linearized from the window depth, see al::light_grid
+int findCluster(float windowDepth)
+{
+        float ndcDepth = 2.0f * windowDepth - 1.0f;
+        float depth = 2.0f * uClusterPlanes.x * uClusterPlanes.y
+                    / (uClusterPlanes.y + uClusterPlanes.x - ndcDepth * (uClusterPlanes.y - uClusterPlanes.x));
+
+        ivec3 cell = ivec3(ivec2(gl_FragCoord.xy * uClusterScale.xy), int(floor(log(depth) * uClusterScale.z + uClusterScale.w)));
+        cell = clamp(cell, ivec3(0), uClusterDims.xyz - 1);
+        return (cell.z * uClusterDims.y + cell.y) * uClusterDims.x + cell.x;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// four texels per point light, see al::gl::clustered_lights
+pointLight_t fetchPointLight(int index)
+{
+        vec4 t0 = texelFetch(uClusterLights, 4 * index + 0);
+        vec4 t1 = texelFetch(uClusterLights, 4 * index + 1);
+        vec4 t2 = texelFetch(uClusterLights, 4 * index + 2);
+        vec4 t3 = texelFetch(uClusterLights, 4 * index + 3);
+        return pointLight_t(t1.rgb, t2.rgb, t0.xyz, t0.w, t1.w, t2.w, t3.x, t3.y);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// five texels per spot light, after the point lights
+spotLight_t fetchSpotLight(int index)
+{
+        int base = uClusterDims.w + 5 * index;
+        vec4 t0 = texelFetch(uClusterLights, base + 0);
+        vec4 t1 = texelFetch(uClusterLights, base + 1);
+        vec4 t2 = texelFetch(uClusterLights, base + 2);
+        vec4 t3 = texelFetch(uClusterLights, base + 3);
+        vec4 t4 = texelFetch(uClusterLights, base + 4);
+        return spotLight_t(t1.rgb, t2.rgb, t0.xyz, t4.xyz, t0.w, t1.w, t3.z, t3.w, t2.w, t3.x, t3.y);
+}
+
+#ifdef LIGHT_SHADOWS
+////////////////////////////////////////////////////////////////////////////////
+// shadow_atlas slots, -1 casts no shadow
+int fetchPointShadow(int index)
+{
+        return int(texelFetch(uClusterLights, 4 * index + 3).z);
+}
+
+int fetchSpotShadow(int index)
+{
+        return int(texelFetch(uClusterLights, uClusterDims.w + 5 * index + 4).w);
+}
+#endif
+#endif
+
+#ifdef DEFERRED_LIGHTING
+////////////////////////////////////////////////////////////////////////////////
+// a unit vector folded onto the octahedron, two components in [0, 1]
+vec3 decodeNormal(vec2 e)
+{
+        e = 2.0f * e - 1.0f;
+        vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+        if (n.z < 0.0f)
+                n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        return normalize(n);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// the material as the geometry pass packed it, specular color is reduced to gray; there
+// is no ambient color in the gbuffer, computeDirLight() lights ambient with the diffuse
+// color in the forward path as well, so the two paths agree without it
+material_cached_t fetchGBufferMaterial(ivec2 pixel)
+{
+        vec4 albedo = texelFetch(uGBufferAlbedo, pixel, 0);
+        material_cached_t cachedMaterial;
+        cachedMaterial.ambient = albedo.rgb;
+        cachedMaterial.diffuse = albedo.rgb;
+        cachedMaterial.specular = vec3(albedo.a);
+        cachedMaterial.shininess = exp2(10.0f * texelFetch(uGBufferNormal, pixel, 0).z);
+        return cachedMaterial;
+}
+#elif defined(MATERIAL_TABLE)
+////////////////////////////////////////////////////////////////////////////////
+// four texels per material, the w components are the texture enables, see al::gl::material_table
+material_cached_t fetchMaterial(int index)
+{
+        vec4 ambient = texelFetch(uMaterials, 4 * index + 0);
+        vec4 diffuse = texelFetch(uMaterials, 4 * index + 1);
+        vec4 specular = texelFetch(uMaterials, 4 * index + 2);
+        vec4 params = texelFetch(uMaterials, 4 * index + 3);
+
+#ifdef STATIC_MATERIAL
+        bool enableAmbient = HAS_AMBIENT_TEXTURE;
+        bool enableDiffuse = HAS_DIFFUSE_TEXTURE;
+        bool enableSpecular = HAS_SPECULAR_TEXTURE;
+#else
+        bool enableAmbient = ambient.w > 0.5f;
+        bool enableDiffuse = diffuse.w > 0.5f;
+        bool enableSpecular = specular.w > 0.5f;
+#endif
+
+        material_cached_t cachedMaterial;
+        cachedMaterial.ambient = (enableAmbient ? texture(uAmbientTexture, vTexCoord).rgb * ambient.rgb : ambient.rgb);
+        cachedMaterial.diffuse = (enableDiffuse ? texture(uDiffuseTexture, vTexCoord).rgb * diffuse.rgb : diffuse.rgb);
+        cachedMaterial.specular = (enableSpecular ? texture(uSpecularTexture, vTexCoord).rgb * specular.rgb : specular.rgb);
+        cachedMaterial.shininess = params.x;
+        return cachedMaterial;
+}
+#else
 ////////////////////////////////////////////////////////////////////////////////
 material_cached_t cacheMaterial(material_t material)
 {
         material_cached_t cachedMaterial;
 
-        cachedMaterial.ambient = (material.enableAmbientTexture
+        cachedMaterial.ambient = (ENABLE_AMBIENT_TEXTURE(material)
                                ? texture(material.ambientTexture, vTexCoord).rgb
                                * material.ambientColor
                                : material.ambientColor);
 
-        cachedMaterial.diffuse = (material.enableDiffuseTexture
+        cachedMaterial.diffuse = (ENABLE_DIFFUSE_TEXTURE(material)
                                ? texture(material.diffuseTexture, vTexCoord).rgb
                                * material.diffuseColor
                                : material.diffuseColor);
 
-        cachedMaterial.specular = (material.enableSpecularTexture
+        cachedMaterial.specular = (ENABLE_SPECULAR_TEXTURE(material)
                                 ? texture(material.specularTexture, vTexCoord).rgb
                                 * material.specularColor
                                 : material.specularColor);
@@ -202,24 +527,123 @@ material_cached_t cacheMaterial(material_t material)
         cachedMaterial.shininess = material.shininess;
         return cachedMaterial;
 }
+#endif
+
+#ifndef DEFERRED_LIGHTING
+////////////////////////////////////////////////////////////////////////////////
+material_cached_t fragmentMaterial()
+{
+#if defined(MATERIAL_TABLE) && defined(INSTANCED)
+        return fetchMaterial(vMaterialIndex >= 0 ? vMaterialIndex : uMaterialIndex);
+#elif defined(MATERIAL_TABLE)
+        return fetchMaterial(uMaterialIndex);
+#else
+        return cacheMaterial(uMaterial);
+#endif
+}
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
+// every light reaching vFragPos, windowDepth picks the cluster
+vec3 computeLighting(material_cached_t material, vec3 normal, vec3 viewDir, float windowDepth)
+{
+        vec3 resultColor = vec3(0.0f);
+#if defined(UNIFORM_BLOCKS) || NUM_DIR_LIGHTS > 0
+#ifdef SHADOWS
+        float shadow = DIR_LIGHT_COUNT > 0 ? computeShadow(normal) : 1.0f;
+#else
+        float shadow = 1.0f;
+#endif
+        for (int i = 0; i < DIR_LIGHT_COUNT; ++i)
+                resultColor += computeDirLight(material, uDirLights[i], normal, viewDir, i == 0 ? shadow : 1.0f);
+#endif
+#ifdef CLUSTERED
+        // only the lights whose range reaches the fragment's cluster
+        uvec2 cell = texelFetch(uClusterCells, findCluster(windowDepth)).rg;
+        int first = int(cell.x);
+        int points = int(cell.y & 0xffffu);
+        int spots = int(cell.y >> 16);
+        for (int i = 0; i < points; ++i) {
+                int index = int(texelFetch(uClusterIndices, first + i).r);
+                pointLight_t light = fetchPointLight(index);
+#ifdef LIGHT_SHADOWS
+                resultColor += computeLightShadow(fetchPointShadow(index), light.position, normal) * computePointLight(material, light, normal, viewDir);
+#else
+                resultColor += computePointLight(material, light, normal, viewDir);
+#endif
+        }
+        for (int i = 0; i < spots; ++i) {
+                int index = int(texelFetch(uClusterIndices, first + points + i).r);
+                spotLight_t light = fetchSpotLight(index);
+#ifdef LIGHT_SHADOWS
+                resultColor += computeLightShadow(fetchSpotShadow(index), light.position, normal) * computeSpotLight(material, light, normal, viewDir);
+#else
+                resultColor += computeSpotLight(material, light, normal, viewDir);
+#endif
+        }
+#else
+#if defined(UNIFORM_BLOCKS) || NUM_POINT_LIGHTS > 0
+        for (int i = 0; i < POINT_LIGHT_COUNT; ++i)
+                resultColor += computePointLight(material, uPointLights[i], normal, viewDir);
+#endif
+#if defined(UNIFORM_BLOCKS) || NUM_SPOT_LIGHTS > 0
+        for (int i = 0; i < SPOT_LIGHT_COUNT; ++i)
+                resultColor += computeSpotLight(material, uSpotLights[i], normal, viewDir);
+#endif
+#endif
+        return resultColor;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+#if defined(DEPTH_ONLY)
+void main()
+{
+}
+#elif defined(GBUFFER)
+////////////////////////////////////////////////////////////////////////////////
+// a unit vector folded onto the octahedron, see decodeNormal()
+vec2 encodeNormal(vec3 n)
+{
+        n /= abs(n.x) + abs(n.y) + abs(n.z);
+        vec2 e = n.z >= 0.0f ? n.xy : (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+        return 0.5f * e + 0.5f;
+}
+
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+void main()
+{
+        // shininess is stored as log2 over [1, 1024], the 10 bits of an RGB10_A2 channel
+        material_cached_t cached_material = fragmentMaterial();
+        gAlbedo = vec4(cached_material.diffuse, dot(cached_material.specular, vec3(0.2126f, 0.7152f, 0.0722f)));
+        gNormal = vec4(encodeNormal(normalize(vNorm)), clamp(log2(max(cached_material.shininess, 1.0f)) / 10.0f, 0.0f, 1.0f), 0.0f);
+}
+#elif defined(DEFERRED_LIGHTING)
+out vec4 color;
+void main()
+{
+        // the lighting pass covers the G-buffer pixel for pixel, empty pixels keep the clear color
+        ivec2 pixel = ivec2(gl_FragCoord.xy);
+        float depth = texelFetch(uGBufferDepth, pixel, 0).r;
+        if (depth >= 1.0f)
+                discard;
+
+        vec2 ndc = 2.0f * (gl_FragCoord.xy - uViewport.xy) / uViewport.zw - 1.0f;
+        vec4 position = uInverseProjectionView * vec4(ndc, 2.0f * depth - 1.0f, 1.0f);
+        vFragPos = position.xyz / position.w;
+
+        vec3 normal = decodeNormal(texelFetch(uGBufferNormal, pixel, 0).xy);
+        vec3 viewDir = normalize(uViewPos - vFragPos);
+        color = vec4(computeLighting(fetchGBufferMaterial(pixel), normal, viewDir, depth), 1.0f);
+}
+#else
 out vec4 color;
 void main()
 {
         vec3 normal = normalize(vNorm);
         vec3 viewDir = normalize(uViewPos - vFragPos);
-        vec3 resultColor = vec3(0.0f);
-        material_cached_t cached_material = cacheMaterial(uMaterial);
- 
-        for (int i = 0; i < NUM_DIR_LIGHTS; ++i)
-                resultColor += computeDirLight(cached_material, uDirLights[i], normal, viewDir);
-        for (int i = 0; i < NUM_POINT_LIGHTS; ++i)
-                resultColor += computePointLight(cached_material, uPointLights[i], normal, viewDir);
-        for (int i = 0; i < NUM_SPOT_LIGHTS; ++i)
-                resultColor += computeSpotLight(cached_material, uSpotLights[i], normal, viewDir);
-
-        color = vec4(resultColor, 1.0f);
+        color = vec4(computeLighting(fragmentMaterial(), normal, viewDir, gl_FragCoord.z), 1.0f);
 }
+#endif
 
 #endif
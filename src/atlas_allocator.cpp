@@ -0,0 +1,98 @@
+#include "atlas_allocator.h"
+#include "error.h"
+
+#include <algorithm>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        atlas_allocator::atlas_allocator(int size, int minSize)
+                : mSize{size}, mMinSize{minSize}
+        {
+                auto powerOfTwo = [](int n) { return n > 0 && (n & (n - 1)) == 0; };
+                if (!powerOfTwo(size) || !powerOfTwo(minSize) || minSize > size)
+                        throw exception("al", "atlas_allocator", "atlas_allocator", "sizes must be powers of two, minSize at most size", etype::unexpected);
+
+                mLevels = 1;
+                while ((mSize >> (mLevels - 1)) > mMinSize)
+                        ++mLevels;
+                mFree.resize(mLevels);
+                clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int atlas_allocator::level(int size) const
+        {
+                if (size > mSize)
+                        return -1;
+
+                int l = 0;
+                while (l + 1 < mLevels && (mSize >> (l + 1)) >= size)
+                        ++l;
+                return l;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool atlas_allocator::allocate(int size, atlas_tile& tile)
+        {
+                int target = level(size);
+                if (target < 0)
+                        return false;
+
+                // the smallest free tile at least as large
+                int l = target;
+                while (l >= 0 && mFree[l].empty())
+                        --l;
+                if (l < 0)
+                        return false;
+
+                // split it down, the first quadrant moves on and the other three stay free
+                atlas_tile t = mFree[l].back();
+                mFree[l].pop_back();
+                for (; l < target; ++l) {
+                        int half = t.mSize / 2;
+                        mFree[l + 1].push_back({ t.mX + half, t.mY + half, half });
+                        mFree[l + 1].push_back({ t.mX, t.mY + half, half });
+                        mFree[l + 1].push_back({ t.mX + half, t.mY, half });
+                        t.mSize = half;
+                }
+
+                mUsed += static_cast<size_t>(t.mSize) * t.mSize;
+                tile = t;
+                return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void atlas_allocator::release(const atlas_tile& tile)
+        {
+                mUsed -= static_cast<size_t>(tile.mSize) * tile.mSize;
+
+                atlas_tile t = tile;
+                for (int l = level(t.mSize); l > 0; --l) {
+                        // the siblings share the parent's corner, all three have to be free
+                        int parentSize = 2 * t.mSize;
+                        int px = t.mX & ~(parentSize - 1);
+                        int py = t.mY & ~(parentSize - 1);
+
+                        std::vector<atlas_tile>& free = mFree[l];
+                        auto sibling = [&](const atlas_tile& s) {
+                                return (s.mX & ~(parentSize - 1)) == px && (s.mY & ~(parentSize - 1)) == py;
+                        };
+                        if (std::count_if(free.begin(), free.end(), sibling) < 3)
+                                break;
+
+                        free.erase(std::remove_if(free.begin(), free.end(), sibling), free.end());
+                        t = { px, py, parentSize };
+                }
+                mFree[level(t.mSize)].push_back(t);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void atlas_allocator::clear()
+        {
+                for (std::vector<atlas_tile>& free : mFree)
+                        free.clear();
+                mFree[0].push_back({ 0, 0, mSize });
+                mUsed = 0;
+        }
+}
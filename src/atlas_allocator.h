@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // square region of an atlas, in texels from its lower left corner
+        struct atlas_tile
+        {
+                int mX = 0, mY = 0;
+                int mSize = 0;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // quadtree buddy allocator of a square atlas: tiles are the atlas size halved a
+        // number of times, a request splits the smallest free tile that holds it and a
+        // released tile merges with its three siblings when they are free too
+        class atlas_allocator
+        {
+                int mSize, mMinSize;
+                int mLevels;
+                size_t mUsed = 0;
+
+                // free tiles per level, level 0 is the whole atlas
+                std::vector<std::vector<atlas_tile>> mFree;
+
+                int level(int size) const;
+        public:
+                // both powers of two, minSize at most size
+                atlas_allocator(int size, int minSize);
+
+                // false when no tile of the size is left, sizes are rounded up to a power of two
+                bool allocate(int size, atlas_tile& tile);
+
+                // a tile returned by allocate() and not released since
+                void release(const atlas_tile& tile);
+
+                // frees every tile
+                void clear();
+
+                int getSize() const                             { return mSize; }
+                int getMinSize() const                          { return mMinSize; }
+                size_t getUsed() const                          { return mUsed; }
+        };
+}
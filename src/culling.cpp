@@ -0,0 +1,208 @@
+#include "culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE__
+#include <immintrin.h>
+#endif
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        bounds computeBounds(const float* vertices, size_t count, size_t stride, size_t offset)
+        {
+                bounds b;
+                if (count == 0)
+                        return b;
+
+                const float* p = vertices + offset;
+                b.mMin = b.mMax = glm::vec3(p[0], p[1], p[2]);
+                for (size_t i = 1; i < count; ++i) {
+                        p = vertices + i * stride + offset;
+                        b.mMin = glm::vec3(std::min(b.mMin.x, p[0]), std::min(b.mMin.y, p[1]), std::min(b.mMin.z, p[2]));
+                        b.mMax = glm::vec3(std::max(b.mMax.x, p[0]), std::max(b.mMax.y, p[1]), std::max(b.mMax.z, p[2]));
+                }
+
+                // centered on the box, the radius is the farthest vertex rather than the box corner
+                b.mCenter = (b.mMin + b.mMax) * 0.5f;
+                float radius2 = 0.0f;
+                for (size_t i = 0; i < count; ++i) {
+                        p = vertices + i * stride + offset;
+                        float dx = p[0] - b.mCenter.x, dy = p[1] - b.mCenter.y, dz = p[2] - b.mCenter.z;
+                        radius2 = std::max(radius2, dx * dx + dy * dy + dz * dz);
+                }
+                b.mRadius = std::sqrt(radius2);
+                return b;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        frustum::frustum(const glm::mat4& m)
+        {
+                // Gribb-Hartmann: each plane is the last row of the matrix plus or minus another row
+                auto row = [&m](int r) { return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+
+                mPlanes[0] = row(3) + row(0);
+                mPlanes[1] = row(3) - row(0);
+                mPlanes[2] = row(3) + row(1);
+                mPlanes[3] = row(3) - row(1);
+                mPlanes[4] = row(3) + row(2);
+                mPlanes[5] = row(3) - row(2);
+
+                for (glm::vec4& p : mPlanes) {
+                        float length = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+                        p = p * (1.0f / length);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool frustum::contains(const glm::vec3& c, const glm::vec3& e) const
+        {
+                for (const glm::vec4& p : mPlanes) {
+                        float distance = p.x * c.x + p.y * c.y + p.z * c.z + p.w;
+                        float radius = std::abs(p.x) * e.x + std::abs(p.y) * e.y + std::abs(p.z) * e.z;
+                        if (distance + radius < 0.0f)
+                                return false;
+                }
+                return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool frustum::contains(const glm::vec3& c, float radius) const
+        {
+                for (const glm::vec4& p : mPlanes)
+                        if (p.x * c.x + p.y * c.y + p.z * c.z + p.w < -radius)
+                                return false;
+                return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t cull_set::add(const bounds& b, const glm::mat4& transform)
+        {
+                size_t index = size();
+                mCenterX.push_back(0.0f);
+                mCenterY.push_back(0.0f);
+                mCenterZ.push_back(0.0f);
+                mExtentX.push_back(0.0f);
+                mExtentY.push_back(0.0f);
+                mExtentZ.push_back(0.0f);
+                set(index, b, transform);
+                return index;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void cull_set::set(size_t index, const bounds& b, const glm::mat4& m)
+        {
+                glm::vec3 c = (b.mMin + b.mMax) * 0.5f;
+                glm::vec3 e = (b.mMax - b.mMin) * 0.5f;
+
+                // Arvo: the new extents are the old ones through the absolute linear part
+                mCenterX[index] = m[0][0] * c.x + m[1][0] * c.y + m[2][0] * c.z + m[3][0];
+                mCenterY[index] = m[0][1] * c.x + m[1][1] * c.y + m[2][1] * c.z + m[3][1];
+                mCenterZ[index] = m[0][2] * c.x + m[1][2] * c.y + m[2][2] * c.z + m[3][2];
+                mExtentX[index] = std::abs(m[0][0]) * e.x + std::abs(m[1][0]) * e.y + std::abs(m[2][0]) * e.z;
+                mExtentY[index] = std::abs(m[0][1]) * e.x + std::abs(m[1][1]) * e.y + std::abs(m[2][1]) * e.z;
+                mExtentZ[index] = std::abs(m[0][2]) * e.x + std::abs(m[1][2]) * e.y + std::abs(m[2][2]) * e.z;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void cull_set::clear()
+        {
+                mCenterX.clear();
+                mCenterY.clear();
+                mCenterZ.clear();
+                mExtentX.clear();
+                mExtentY.clear();
+                mExtentZ.clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void cull_set::reserve(size_t count)
+        {
+                mCenterX.reserve(count);
+                mCenterY.reserve(count);
+                mCenterZ.reserve(count);
+                mExtentX.reserve(count);
+                mExtentY.reserve(count);
+                mExtentZ.reserve(count);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t cull_set::cullRange(const frustum& f, size_t first, size_t last, unsigned char* visible) const
+        {
+                size_t count = 0;
+                for (size_t i = first; i < last; ++i) {
+                        bool inside = f.contains(glm::vec3(mCenterX[i], mCenterY[i], mCenterZ[i]),
+                                                 glm::vec3(mExtentX[i], mExtentY[i], mExtentZ[i]));
+                        visible[i] = inside;
+                        count += inside;
+                }
+                return count;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t cull_set::cull(const frustum& f, std::vector<unsigned char>& visible) const
+        {
+                visible.resize(size());
+                return cull(f, visible.data());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t cull_set::cull(const frustum& f, unsigned char* visible) const
+        {
+                size_t n = size();
+                size_t i = 0;
+                size_t count = 0;
+
+#ifdef __SSE__
+                // planes are splatted once, every iteration then tests 4 boxes against all 6
+                __m128 px[frustum::PLANES], py[frustum::PLANES], pz[frustum::PLANES], pw[frustum::PLANES];
+                __m128 ax[frustum::PLANES], ay[frustum::PLANES], az[frustum::PLANES];
+                for (int p = 0; p < frustum::PLANES; ++p) {
+                        const glm::vec4& plane = f.mPlanes[p];
+                        px[p] = _mm_set1_ps(plane.x);
+                        py[p] = _mm_set1_ps(plane.y);
+                        pz[p] = _mm_set1_ps(plane.z);
+                        pw[p] = _mm_set1_ps(plane.w);
+                        ax[p] = _mm_set1_ps(std::abs(plane.x));
+                        ay[p] = _mm_set1_ps(std::abs(plane.y));
+                        az[p] = _mm_set1_ps(std::abs(plane.z));
+                }
+
+                const __m128 zero = _mm_setzero_ps();
+                for (; i + 4 <= n; i += 4) {
+                        __m128 cx = _mm_loadu_ps(mCenterX.data() + i);
+                        __m128 cy = _mm_loadu_ps(mCenterY.data() + i);
+                        __m128 cz = _mm_loadu_ps(mCenterZ.data() + i);
+                        __m128 ex = _mm_loadu_ps(mExtentX.data() + i);
+                        __m128 ey = _mm_loadu_ps(mExtentY.data() + i);
+                        __m128 ez = _mm_loadu_ps(mExtentZ.data() + i);
+
+                        __m128 inside = _mm_cmpeq_ps(zero, zero);
+                        for (int p = 0; p < frustum::PLANES; ++p) {
+                                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)),
+                                                             _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+                                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)),
+                                                           _mm_mul_ps(az[p], ez));
+                                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+                        }
+
+                        int mask = _mm_movemask_ps(inside);
+                        visible[i + 0] = (mask >> 0) & 1;
+                        visible[i + 1] = (mask >> 1) & 1;
+                        visible[i + 2] = (mask >> 2) & 1;
+                        visible[i + 3] = (mask >> 3) & 1;
+                        count += __builtin_popcount(mask);
+                }
+#endif
+
+                return count + cullRange(f, i, n, visible);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t cull_set::cullScalar(const frustum& f, std::vector<unsigned char>& visible) const
+        {
+                visible.resize(size());
+                return cullRange(f, 0, size(), visible.data());
+        }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // axis aligned box and the sphere around its center, in the space of the vertices
+        struct bounds
+        {
+                glm::vec3 mMin                  = glm::vec3(0.0f);
+                glm::vec3 mMax                  = glm::vec3(0.0f);
+                glm::vec3 mCenter               = glm::vec3(0.0f);
+                float mRadius                   = 0.0f;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // stride and offset are counted in floats, the position is the 3 floats at offset
+        bounds computeBounds(const float* vertices, size_t count, size_t stride, size_t offset = 0);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // left, right, bottom, top, near, far; normalized and pointing inwards
+        struct frustum
+        {
+                static constexpr int PLANES = 6;
+
+                glm::vec4 mPlanes[PLANES];
+
+                frustum() = default;
+                explicit frustum(const glm::mat4& projectionView);
+
+                bool contains(const glm::vec3& center, const glm::vec3& extents) const;
+                bool contains(const glm::vec3& center, float radius) const;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // world space boxes stored one array per component, so the kernel tests
+        // several of them per instruction and only streams the floats it needs
+        class cull_set
+        {
+                std::vector<float> mCenterX, mCenterY, mCenterZ;
+                std::vector<float> mExtentX, mExtentY, mExtentZ;
+
+                size_t cullRange(const frustum& f, size_t first, size_t last, unsigned char* visible) const;
+        public:
+                // the box is transformed and enlarged to stay axis aligned
+                size_t add(const bounds& b, const glm::mat4& transform);
+                void set(size_t index, const bounds& b, const glm::mat4& transform);
+
+                void clear();
+                void reserve(size_t count);
+                size_t size() const                     { return mCenterX.size(); }
+
+                glm::vec3 getCenter(size_t i) const     { return glm::vec3(mCenterX[i], mCenterY[i], mCenterZ[i]); }
+                glm::vec3 getExtents(size_t i) const    { return glm::vec3(mExtentX[i], mExtentY[i], mExtentZ[i]); }
+
+                // writes 1 to visible[i] when box i intersects the frustum, returns the visible count
+                size_t cull(const frustum& f, std::vector<unsigned char>& visible) const;
+                size_t cull(const frustum& f, unsigned char* visible) const;
+
+                // reference path, same result without SIMD
+                size_t cullScalar(const frustum& f, std::vector<unsigned char>& visible) const;
+        };
+}
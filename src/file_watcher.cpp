@@ -0,0 +1,100 @@
+#include "file_watcher.h"
+#include "error.h"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // the prefix joined with an event's name gives back the watched path
+        static std::string prefixOf(const std::string& path)
+        {
+                auto pos = path.find_last_of('/');
+                return pos == std::string::npos ? std::string() : path.substr(0, pos + 1);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        file_watcher::file_watcher()
+                : mFd{inotify_init1(IN_NONBLOCK | IN_CLOEXEC)}
+        {
+                if (mFd == -1)
+                        throw exception("al", "file_watcher", "file_watcher", std::string("inotify_init1 failed: ") + std::strerror(errno), etype::unexpected);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        file_watcher::~file_watcher()
+        {
+                if (mFd != -1)
+                        close(mFd);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        file_watcher::file_watcher(file_watcher&& other)
+                : mFd{other.mFd}, mDirs{std::move(other.mDirs)}, mFiles{std::move(other.mFiles)}
+        {
+                other.mFd = -1;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        file_watcher& file_watcher::operator=(file_watcher&& other)
+        {
+                if (this != &other) {
+                        if (mFd != -1)
+                                close(mFd);
+
+                        mFd             = other.mFd;
+                        mDirs           = std::move(other.mDirs);
+                        mFiles          = std::move(other.mFiles);
+
+                        other.mFd       = -1;
+                }
+                return *this;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void file_watcher::watch(const std::string& path)
+        {
+                std::string prefix = prefixOf(path);
+                std::string dir = prefix.empty() ? std::string(".") : prefix;
+
+                // watching the same directory twice returns the same descriptor
+                int wd = inotify_add_watch(mFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd == -1)
+                        throw exception("al", "file_watcher", "watch", "couldn't watch " + dir + ": " + std::strerror(errno), etype::unexpected);
+
+                mDirs[wd] = prefix;
+                mFiles.insert(path);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std::vector<std::string> file_watcher::poll()
+        {
+                std::unordered_set<std::string> changed;
+
+                alignas(inotify_event) char events[4096];
+                for (;;) {
+                        ssize_t length = read(mFd, events, sizeof(events));
+                        if (length <= 0)
+                                break;
+
+                        for (char* p = events; p < events + length; ) {
+                                inotify_event event;
+                                std::memcpy(&event, p, sizeof(inotify_event));
+
+                                auto dir = mDirs.find(event.wd);
+                                if (dir != mDirs.end() && event.len > 0) {
+                                        std::string path = dir->second + (p + sizeof(inotify_event));
+                                        if (mFiles.count(path))
+                                                changed.insert(path);
+                                }
+                                p += sizeof(inotify_event) + event.len;
+                        }
+                }
+
+                return std::vector<std::string>(changed.begin(), changed.end());
+        }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // inotify on the parent directories, so editors that save by renaming are seen
+        class file_watcher
+        {
+                int mFd;
+                std::unordered_map<int, std::string> mDirs;
+                std::unordered_set<std::string> mFiles;
+        public:
+                file_watcher();
+
+                ~file_watcher();
+
+                file_watcher(const file_watcher&) = delete;
+                file_watcher& operator=(const file_watcher&) = delete;
+
+                file_watcher(file_watcher&&);
+                file_watcher& operator=(file_watcher&&);
+
+                void watch(const std::string& path);
+
+                // never blocks, returns each changed path once
+                std::vector<std::string> poll();
+        };
+}
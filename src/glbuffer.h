@@ -1,7 +1,10 @@
 #pragma once
 
+#include "glstate.h"
+
 #include <glad/glad.h>
 
+#include <cstddef>
 #include <vector>
 
 namespace al::gl
@@ -19,7 +22,7 @@ namespace al::gl
         public:
                 buffer(int mode, std::vector<T>&& data, int usage);
 
-                ~buffer()                               { glDeleteBuffers(1, &mId); }
+                ~buffer()                               { glstate().forgetBuffer(mId); glDeleteBuffers(1, &mId); }
 
                 buffer(const buffer&);
                 buffer& operator=(const buffer&);
@@ -33,19 +36,46 @@ namespace al::gl
                 size_t getSizeInBytes() const           { return mData.size() * sizeof(T); }
                 int getUsage() const                    { return mUsage; }
 
-                void bind() const                       { glBindBuffer(mMode, mId); }
-                void unbind() const                     { glBindBuffer(mMode, 0); }
+                void bind() const                       { glstate().bindBuffer(mMode, mId); }
+                void unbind() const                     { glstate().bindBuffer(mMode, 0); }
+
+                // write through getData(), then send the dirty range with upload()
+                std::vector<T>& getData()               { return mData; }
+                const std::vector<T>& getData() const   { return mData; }
+                void upload(size_t first, size_t count) const;
+
+                void bindRange(int index, size_t first, size_t count) const
+                {
+                        glstate().bindBufferRange(mMode, index, mId, first * sizeof(T), count * sizeof(T));
+                }
         };
 
+        ////////////////////////////////////////////////////////////////////////////////
+        template <typename T>
+        void buffer<T>::upload(size_t first, size_t count) const
+        {
+                // an index buffer binding belongs to the bound vao, draws leave theirs bound
+                if (mMode == GL_ELEMENT_ARRAY_BUFFER)
+                        glstate().bindVertexArray(0);
+
+                // left bound, the next upload of this buffer skips the bind
+                glstate().bindBuffer(mMode, mId);
+                glBufferSubData(mMode, first * sizeof(T), count * sizeof(T), mData.data() + first);
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         template <typename T>
         void buffer<T>::load()
         {
+                // as in upload(), or the last drawn vao would get this index buffer and then none
+                if (mMode == GL_ELEMENT_ARRAY_BUFFER)
+                        glstate().bindVertexArray(0);
+
                 glGenBuffers(1, &mId);
-                glBindBuffer(mMode, mId);
+                glstate().bindBuffer(mMode, mId);
                         size_t bytes = mData.size() * sizeof(T);
                         glBufferData(mMode, bytes, mData.data(), mUsage);
-                glBindBuffer(mMode, 0);
+                glstate().bindBuffer(mMode, 0);
         }
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -69,6 +99,7 @@ namespace al::gl
         buffer<T>& buffer<T>::operator=(const buffer<T>& other)
         {
                 if (this != &other) {
+                        glstate().forgetBuffer(mId);
                         glDeleteBuffers(1, &mId);
 
                         mMode   = other.mMode;
@@ -93,6 +124,7 @@ namespace al::gl
         buffer<T>& buffer<T>::operator=(buffer<T>&& other)
         {
                 if (this != &other) {
+                        glstate().forgetBuffer(mId);
                         glDeleteBuffers(1, &mId);
 
                         mId     = other.mId;
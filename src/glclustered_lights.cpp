@@ -0,0 +1,115 @@
+#include "glclustered_lights.h"
+#include "error.h"
+
+#include <algorithm>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // grows the store by doubling and re-points the texture at it, then sends count elements
+        template <typename T>
+        static void stream(buffer<T>& b, unsigned texture, int format, const T* data, size_t count)
+        {
+                if (count > b.getSize()) {
+                        int maxTexels = 0;
+                        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+                        if (count > static_cast<size_t>(maxTexels))
+                                throw exception("al::gl", "clustered_lights", "update", "too many texels for a buffer texture", etype::unexpected);
+
+                        size_t capacity = std::min(std::max(count, 2 * b.getSize()), static_cast<size_t>(maxTexels));
+                        b = buffer<T>(GL_TEXTURE_BUFFER, std::vector<T>(capacity), GL_DYNAMIC_DRAW);
+                        glstate().bindTexture(GL_TEXTURE_BUFFER, texture);
+                                glTexBuffer(GL_TEXTURE_BUFFER, format, b.getId());
+                        glstate().bindTexture(GL_TEXTURE_BUFFER, 0);
+                }
+
+                if (count) {
+                        std::copy(data, data + count, b.getData().begin());
+                        b.upload(0, count);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        clustered_lights::clustered_lights(worker_pool* workers, int x, int y, int z)
+                : mGrid(x, y, z, workers),
+                  mLights(GL_TEXTURE_BUFFER, std::vector<glm::vec4>(1), GL_DYNAMIC_DRAW),
+                  mCells(GL_TEXTURE_BUFFER, std::vector<std::uint32_t>(2), GL_DYNAMIC_DRAW),
+                  mIndices(GL_TEXTURE_BUFFER, std::vector<std::uint32_t>(1), GL_DYNAMIC_DRAW)
+        {
+                glGenTextures(3, mTextures);
+
+                const unsigned ids[3] = { mLights.getId(), mCells.getId(), mIndices.getId() };
+                const int formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+                for (int i = 0; i < 3; ++i) {
+                        glstate().bindTexture(GL_TEXTURE_BUFFER, mTextures[i]);
+                                glTexBuffer(GL_TEXTURE_BUFFER, formats[i], ids[i]);
+                        glstate().bindTexture(GL_TEXTURE_BUFFER, 0);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        clustered_lights::~clustered_lights()
+        {
+                for (unsigned texture : mTextures)
+                        glstate().forgetTexture(texture);
+                glDeleteTextures(3, mTextures);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void clustered_lights::update(const fpscamera& camera, const std::vector<point_light>& pointLights, const std::vector<spot_light>& spotLights)
+        {
+                mWidth = static_cast<int>(camera.mScreenWidth);
+                mHeight = static_cast<int>(camera.mScreenHeight);
+                mNear = camera.mNear;
+                mFar = camera.mFar;
+                mNumPoints = pointLights.size();
+
+                mGrid.setProjection(camera.mFov, camera.mScreenWidth / camera.mScreenHeight, camera.mNear, camera.mFar);
+                mGrid.build(camera.getView(), pointLights, spotLights);
+
+                // the layout fetchPointLight() and fetchSpotLight() in phong.glsl read
+                mTexels.clear();
+                for (const point_light& l : pointLights) {
+                        mTexels.emplace_back(l.mPosition, l.mRange);
+                        mTexels.emplace_back(l.mDiffuse, l.mIntensity);
+                        mTexels.emplace_back(l.mSpecular, l.mConstant);
+                        mTexels.emplace_back(l.mLinear, l.mQuadratic, static_cast<float>(l.mShadow), 0.0f);
+                }
+                for (const spot_light& l : spotLights) {
+                        mTexels.emplace_back(l.mPosition, l.mRange);
+                        mTexels.emplace_back(l.mDiffuse, l.mIntensity);
+                        mTexels.emplace_back(l.mSpecular, l.mConstant);
+                        mTexels.emplace_back(l.mLinear, l.mQuadratic, l.mCutoff, l.mOuterCutoff);
+                        mTexels.emplace_back(l.mDirection, static_cast<float>(l.mShadow));
+                }
+
+                stream(mLights, mTextures[0], GL_RGBA32F, mTexels.data(), mTexels.size());
+                stream(mCells, mTextures[1], GL_RG32UI, mGrid.getCells().data(), mGrid.getCells().size());
+                stream(mIndices, mTextures[2], GL_R32UI, mGrid.getIndices().data(), mGrid.getIndices().size());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void clustered_lights::attach(program& p) const
+        {
+                p.uniform("uClusterLights", CLUSTER_LIGHTS_UNIT);
+                p.uniform("uClusterCells", CLUSTER_CELLS_UNIT);
+                p.uniform("uClusterIndices", CLUSTER_INDICES_UNIT);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void clustered_lights::uniforms(program& p) const
+        {
+                p.uniform("uClusterDims", mGrid.getX(), mGrid.getY(), mGrid.getZ(), static_cast<int>(mNumPoints) * POINT_LIGHT_TEXELS);
+                p.uniform("uClusterScale", static_cast<float>(mGrid.getX()) / mWidth, static_cast<float>(mGrid.getY()) / mHeight,
+                                           mGrid.getDepthScale(), mGrid.getDepthBias());
+                p.uniform("uClusterPlanes", mNear, mFar);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void clustered_lights::bind() const
+        {
+                glstate().bindTexture(CLUSTER_LIGHTS_UNIT, GL_TEXTURE_BUFFER, mTextures[0]);
+                glstate().bindTexture(CLUSTER_CELLS_UNIT, GL_TEXTURE_BUFFER, mTextures[1]);
+                glstate().bindTexture(CLUSTER_INDICES_UNIT, GL_TEXTURE_BUFFER, mTextures[2]);
+        }
+}
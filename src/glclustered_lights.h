@@ -0,0 +1,66 @@
+#pragma once
+
+#include "fpscamera.h"
+#include "glbuffer.h"
+#include "glprogram.h"
+#include "light_grid.h"
+#include "lights.h"
+#include "worker_pool.h"
+
+#include <glad/glad.h>
+#include <glm/vec4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // texture units of the light data, the cluster cells and the light indices,
+        // after the material table's
+        constexpr int CLUSTER_LIGHTS_UNIT               = 4;
+        constexpr int CLUSTER_CELLS_UNIT                = 5;
+        constexpr int CLUSTER_INDICES_UNIT              = 6;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // texels of one light in the light data, spot lights follow the point lights
+        constexpr int POINT_LIGHT_TEXELS                = 4;
+        constexpr int SPOT_LIGHT_TEXELS                 = 5;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // point and spot lights binned per frame into a light_grid over the camera frustum,
+        // streamed to buffer textures read by phong.glsl with shader_features::mClustered
+        class clustered_lights
+        {
+                light_grid mGrid;
+                int mWidth = 0, mHeight = 0;
+                float mNear = 0.0f, mFar = 0.0f;
+                size_t mNumPoints = 0;
+
+                std::vector<glm::vec4> mTexels;
+
+                buffer<glm::vec4> mLights;
+                buffer<std::uint32_t> mCells;
+                buffer<std::uint32_t> mIndices;
+                unsigned mTextures[3];
+        public:
+                explicit clustered_lights(worker_pool* workers = nullptr, int x = LIGHT_GRID_X, int y = LIGHT_GRID_Y, int z = LIGHT_GRID_Z);
+                ~clustered_lights();
+
+                clustered_lights(const clustered_lights&) = delete;
+                clustered_lights& operator=(const clustered_lights&) = delete;
+
+                // bins the lights into the camera's clusters and uploads the result
+                void update(const fpscamera& camera, const std::vector<point_light>& pointLights, const std::vector<spot_light>& spotLights);
+
+                // the program must be in use, points its samplers at the cluster units
+                void attach(program& p) const;
+
+                // the grid layout of the last update, per program and frame
+                void uniforms(program& p) const;
+
+                void bind() const;
+
+                const light_grid& getGrid() const               { return mGrid; }
+        };
+}
@@ -0,0 +1,187 @@
+#include "glcommand_list.h"
+
+#include <glm/glm.hpp>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        command_handles findCommandHandles(program& p)
+        {
+                command_handles handles;
+                if (p.hasUniform("uModel"))
+                        handles.mModel = p.handle<glm::mat4>("uModel");
+                if (p.hasUniform("uNormal"))
+                        handles.mNormal = p.handle<glm::mat4>("uNormal");
+                if (p.hasUniform("uMaterialIndex"))
+                        handles.mMaterial = p.handle<int>("uMaterialIndex");
+                return handles;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::useProgram(program& p)
+        {
+                if (mProgram == &p)
+                        return;
+                mProgram = &p;
+
+                command c;
+                c.mOp = command_op::use_program;
+                c.mProgram = &p;
+                mCommands.push_back(c);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::bindTextures(const mesh& m, int material)
+        {
+                if (!mMaterials)
+                        material = -1;
+                if (mTextures == &m && mTexturesMaterial == material)
+                        return;
+                mTextures = &m;
+                mTexturesMaterial = material;
+
+                command c;
+                c.mOp = command_op::bind_textures;
+                c.mMesh = &m;
+                c.mValue = material;
+                mCommands.push_back(c);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::bindVao(const mesh& m)
+        {
+                if (mVao == &m)
+                        return;
+                mVao = &m;
+
+                command c;
+                c.mOp = command_op::bind_vao;
+                c.mMesh = &m;
+                mCommands.push_back(c);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::uniform(uniform_handle<glm::mat4> h, const glm::mat4& m)
+        {
+                if (!h.isValid() || !mProgram)
+                        return;
+
+                command c;
+                c.mOp = command_op::uniform_mat4;
+                c.mProgram = mProgram;
+                c.mMat4 = h;
+                c.mMatrix = static_cast<std::uint32_t>(mMatrices.size());
+                mMatrices.push_back(m);
+                mCommands.push_back(c);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::uniform(uniform_handle<int> h, int x)
+        {
+                if (!h.isValid() || !mProgram)
+                        return;
+
+                command c;
+                c.mOp = command_op::uniform_int;
+                c.mProgram = mProgram;
+                c.mInt = h;
+                c.mValue = x;
+                mCommands.push_back(c);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::draw(const mesh& m, int mode, unsigned condition)
+        {
+                command c;
+                c.mOp = command_op::draw;
+                c.mMesh = &m;
+                c.mValue = mode;
+                c.mCondition = condition;
+                mCommands.push_back(c);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::drawMesh(const mesh& m, program& p, const command_handles& handles, const glm::mat4& model,
+                                    int material, int mode, unsigned condition)
+        {
+                useProgram(p);
+                bindTextures(m, material);
+                bindVao(m);
+                uniform(handles.mModel, model);
+                if (handles.mNormal.isValid())
+                        uniform(handles.mNormal, glm::transpose(glm::inverse(model)));
+                if (material >= 0)
+                        uniform(handles.mMaterial, material);
+                draw(m, mode, condition);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::clear()
+        {
+                mCommands.clear();
+                mMatrices.clear();
+                mProgram = nullptr;
+                mTextures = nullptr;
+                mTexturesMaterial = -1;
+                mVao = nullptr;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void command_list::execute() const
+        {
+                for (const command& c : mCommands) {
+                        switch (c.mOp) {
+                                case command_op::use_program:
+                                        c.mProgram->use();
+                                        break;
+                                case command_op::bind_textures:
+                                        c.mMesh->bindTextures();
+                                        if (c.mValue >= 0)
+                                                mMaterials->bindTextures(c.mValue);
+                                        break;
+                                case command_op::bind_vao:
+                                        c.mMesh->getVao().bind();
+                                        break;
+                                case command_op::uniform_mat4:
+                                        c.mProgram->uniform(c.mMat4, mMatrices[c.mMatrix]);
+                                        break;
+                                case command_op::uniform_int:
+                                        c.mProgram->uniform(c.mInt, c.mValue);
+                                        break;
+                                case command_op::draw:
+                                        if (c.mCondition) {
+                                                glBeginConditionalRender(c.mCondition, GL_QUERY_NO_WAIT);
+                                                c.mMesh->getVao().draw(c.mValue);
+                                                glEndConditionalRender();
+                                        }
+                                        else
+                                                c.mMesh->getVao().draw(c.mValue);
+                                        break;
+                        }
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void recordCommands(worker_pool* workers, std::vector<command_list>& lists, size_t count,
+                            const std::function<void(command_list&, size_t first, size_t last)>& record)
+        {
+                size_t parts = lists.size();
+                auto task = [&](size_t i) {
+                        lists[i].clear();
+                        record(lists[i], count * i / parts, count * (i + 1) / parts);
+                };
+
+                if (workers)
+                        workers->run(parts, task);
+                else
+                        for (size_t i = 0; i < parts; ++i)
+                                task(i);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void executeCommands(const std::vector<command_list>& lists)
+        {
+                for (const command_list& list : lists)
+                        list.execute();
+        }
+}
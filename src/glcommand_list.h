@@ -0,0 +1,109 @@
+#pragma once
+
+#include "glmesh.h"
+#include "glprogram.h"
+#include "glmaterial_table.h"
+#include "worker_pool.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        enum class command_op : std::uint8_t
+        {
+                use_program,
+                bind_textures,
+                bind_vao,
+                uniform_mat4,
+                uniform_int,
+                draw
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // plain data, what a command doesn't use is left at its default
+        struct command
+        {
+                command_op mOp                  = command_op::draw;
+                int mValue                      = 0;            // draw mode, int uniform or material index
+                unsigned mCondition             = 0;            // occlusion query gating a draw
+                std::uint32_t mMatrix           = 0;            // into the list's matrices
+                program* mProgram               = nullptr;
+                const mesh* mMesh               = nullptr;
+                uniform_handle<glm::mat4> mMat4;
+                uniform_handle<int> mInt;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // what drawMesh() writes, looked up on the GL thread before recording
+        struct command_handles
+        {
+                uniform_handle<glm::mat4> mModel;
+                uniform_handle<glm::mat4> mNormal;
+                uniform_handle<int> mMaterial;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // permutations may compile any of them out, those stay invalid and are skipped
+        command_handles findCommandHandles(program& p);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // draws, binds and uniform writes recorded without touching GL, so any thread can
+        // record a list as long as no other thread records the same one; execute() replays
+        // them on the thread owning the context. A list drops a bind or program change
+        // equal to the one it recorded last, redundancy across lists is left to glstate()
+        class command_list
+        {
+                const material_table* mMaterials;
+
+                std::vector<command> mCommands;
+                std::vector<glm::mat4> mMatrices;
+
+                program* mProgram = nullptr;
+                const mesh* mTextures = nullptr;
+                int mTexturesMaterial = -1;
+                const mesh* mVao = nullptr;
+        public:
+                explicit command_list(const material_table* materials = nullptr)
+                        : mMaterials{materials} {}
+
+                // uniforms recorded after it go to this program
+                void useProgram(program& p);
+
+                // the mesh's textures, then those of the material if there is a table
+                void bindTextures(const mesh& m, int material = -1);
+                void bindVao(const mesh& m);
+
+                void uniform(uniform_handle<glm::mat4> h, const glm::mat4& m);
+                void uniform(uniform_handle<int> h, int x);
+
+                // of the bound vao, a condition query skips it on the GPU when it found no samples
+                void draw(const mesh& m, int mode = GL_TRIANGLES, unsigned condition = 0);
+
+                // everything render_queue does for a packet, the normal matrix computed here
+                void drawMesh(const mesh& m, program& p, const command_handles& handles, const glm::mat4& model,
+                              int material = -1, int mode = GL_TRIANGLES, unsigned condition = 0);
+
+                void clear();
+                void execute() const;
+
+                size_t size() const                                     { return mCommands.size(); }
+                const std::vector<command>& getCommands() const         { return mCommands; }
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // clears the lists, splits [0, count) into one contiguous range per list and calls
+        // record on each from the workers; executing the lists in order then draws as if
+        // the ranges had been recorded one after the other on a single thread
+        void recordCommands(worker_pool* workers, std::vector<command_list>& lists, size_t count,
+                            const std::function<void(command_list&, size_t first, size_t last)>& record);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void executeCommands(const std::vector<command_list>& lists);
+}
@@ -0,0 +1,70 @@
+#include "gldeferred_renderer.h"
+#include "glstate.h"
+
+#include <glm/glm.hpp>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        deferred_renderer::deferred_renderer(program& lightingProgram, int width, int height)
+                : mGBuffer(width, height, { GBUFFER_ALBEDO_FORMAT, GBUFFER_NORMAL_FORMAT }, GBUFFER_DEPTH_FORMAT),
+                  mProgram{lightingProgram}
+        {
+                mInverseProjectionView = mProgram.handle<glm::mat4>("uInverseProjectionView");
+                mViewport = mProgram.handle<glm::vec4>("uViewport");
+
+                mProgram.use();
+                mProgram.uniform("uGBufferAlbedo", GBUFFER_ALBEDO_UNIT);
+                mProgram.uniform("uGBufferNormal", GBUFFER_NORMAL_UNIT);
+                mProgram.uniform("uGBufferDepth", GBUFFER_DEPTH_UNIT);
+                mProgram.halt();
+
+                // the fullscreen triangle has no attributes, but core profile draws need a vao
+                glGenVertexArrays(1, &mVao);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        deferred_renderer::~deferred_renderer()
+        {
+                glstate().forgetVertexArray(mVao);
+                glDeleteVertexArrays(1, &mVao);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void deferred_renderer::beginGeometry()
+        {
+                // bind() covers the whole gbuffer, the scene may be drawn at a smaller scale
+                int viewport[4];
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                mGBuffer.bind();
+                glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void deferred_renderer::endGeometry()
+        {
+                mGBuffer.unbind();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void deferred_renderer::light(const glm::mat4& projectionView)
+        {
+                int viewport[4];
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                mProgram.use();
+                mProgram.uniform(mInverseProjectionView, glm::inverse(projectionView));
+                mProgram.uniform(mViewport, glm::vec4(viewport[0], viewport[1], viewport[2], viewport[3]));
+                glstate().bindTexture(GBUFFER_ALBEDO_UNIT, GL_TEXTURE_2D, mGBuffer.getColor(0));
+                glstate().bindTexture(GBUFFER_NORMAL_UNIT, GL_TEXTURE_2D, mGBuffer.getColor(1));
+                glstate().bindTexture(GBUFFER_DEPTH_UNIT, GL_TEXTURE_2D, mGBuffer.getDepth());
+                glstate().bindVertexArray(mVao);
+
+                // pixels without geometry are discarded by the shader, the rest lit once each
+                GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+                glDisable(GL_DEPTH_TEST);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                if (depthTest)
+                        glEnable(GL_DEPTH_TEST);
+        }
+}
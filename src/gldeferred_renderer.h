@@ -0,0 +1,62 @@
+#pragma once
+
+#include "glframebuffer.h"
+#include "glprogram.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // texture units of the gbuffer attachments, after the clustered lights'
+        constexpr int GBUFFER_ALBEDO_UNIT               = 7;
+        constexpr int GBUFFER_NORMAL_UNIT               = 8;
+        constexpr int GBUFFER_DEPTH_UNIT                = 9;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // 12 bytes per pixel: diffuse and gray specular in RGBA8, an octahedral normal and
+        // log2 shininess in RGB10_A2, and depth, from which the lighting pass rebuilds positions
+        constexpr int GBUFFER_ALBEDO_FORMAT             = GL_RGBA8;
+        constexpr int GBUFFER_NORMAL_FORMAT             = GL_RGB10_A2;
+        constexpr int GBUFFER_DEPTH_FORMAT              = GL_DEPTH24_STENCIL8;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // the geometry pass draws the scene once with shader_features::mGBuffer programs,
+        // then one fullscreen shader_features::mDeferredLighting pass shades every covered
+        // pixel, so the cost of the lights no longer grows with the overdraw
+        class deferred_renderer
+        {
+                framebuffer mGBuffer;
+                program& mProgram;
+                uniform_handle<glm::mat4> mInverseProjectionView;
+                uniform_handle<glm::vec4> mViewport;
+                unsigned mVao;
+        public:
+                // the gbuffer covers at least the viewport the passes draw into, it may be
+                // allocated once for the largest viewport and used at smaller ones
+                deferred_renderer(program& lightingProgram, int width, int height);
+                ~deferred_renderer();
+
+                deferred_renderer(const deferred_renderer&) = delete;
+                deferred_renderer& operator=(const deferred_renderer&) = delete;
+
+                void resize(int width, int height)              { mGBuffer.resize(width, height); }
+
+                // binds and clears the gbuffer and keeps the viewport, depth tests of the
+                // geometry pass work as usual
+                void beginGeometry();
+
+                // back to the framebuffer bound before
+                void endGeometry();
+
+                // shades the gbuffer's pixels in the viewport into the same pixels of the bound
+                // framebuffer without touching its depth, the depth test is left as it was; the
+                // lighting program's other uniforms, e.g. the clusters', are set by the caller
+                void light(const glm::mat4& projectionView);
+
+                // for forward passes after the lighting one, blit() its depth to their target
+                const framebuffer& getGBuffer() const           { return mGBuffer; }
+                program& getProgram()                           { return mProgram; }
+        };
+}
@@ -0,0 +1,161 @@
+#include "gldepth_prepass.h"
+#include "error.h"
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        depth_prepass::depth_prepass(program& depthProgram)
+                : mProgram{depthProgram}
+        {
+                // block programs take the camera from frame_blocks, the others get uPVM
+                if (mProgram.hasUniform("uModel"))
+                        mModel = mProgram.handle<glm::mat4>("uModel");
+                if (mProgram.hasUniform("uPVM"))
+                        mPVM = mProgram.handle<glm::mat4>("uPVM");
+
+                glGenQueries(DEPTH_PREPASS_QUERIES, mQueries);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        depth_prepass::~depth_prepass()
+        {
+                glDeleteQueries(DEPTH_PREPASS_QUERIES, mQueries);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int depth_prepass::add(const mesh& m)
+        {
+                auto id = mMeshIds.find(&m);
+                if (id != mMeshIds.end())
+                        return id->second;
+
+                const auto& infos = m.getVao().getInfos();
+                if (infos.empty() || infos.front().index != 0 || infos.front().type != GL_FLOAT)
+                        throw exception("al::gl", "depth_prepass", "add", "the mesh has no float positions at location 0", etype::unexpected);
+
+                const std::vector<float>& vertices = m.getVao().getVbo().getData();
+                const std::vector<unsigned>& indices = m.getVao().getEbo().getData();
+                size_t stride = infos.front().stride / sizeof(float);
+                size_t offset = reinterpret_cast<size_t>(infos.front().offset) / sizeof(float);
+
+                pool_range range;
+                range.mFirstIndex = static_cast<unsigned>(mIndices.size());
+                range.mIndexCount = static_cast<unsigned>(indices.size());
+                range.mBaseVertex = static_cast<int>(mPositions.size() / 3);
+
+                for (size_t v = offset; v + 3 <= vertices.size(); v += stride)
+                        mPositions.insert(mPositions.end(), vertices.begin() + v, vertices.begin() + v + 3);
+                mIndices.insert(mIndices.end(), indices.begin(), indices.end());
+                mRanges.push_back(range);
+                return mMeshIds.emplace(&m, static_cast<int>(mRanges.size()) - 1).first->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void depth_prepass::upload()
+        {
+                std::vector<vao_info> infos {
+                        { 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0 }
+                };
+
+                mVao.reset();
+                mVao.emplace(buffer<float>(GL_ARRAY_BUFFER, std::vector<float>(mPositions), GL_STATIC_DRAW),
+                             buffer<unsigned>(GL_ELEMENT_ARRAY_BUFFER, std::vector<unsigned>(mIndices), GL_STATIC_DRAW),
+                             infos);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void depth_prepass::submit(const mesh& m, const glm::mat4& model)
+        {
+                auto id = mMeshIds.find(&m);
+                if (id == mMeshIds.end())
+                        throw exception("al::gl", "depth_prepass", "submit", "the mesh wasn't added to the prepass", etype::unexpected);
+                mPackets.push_back({id->second, model});
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void depth_prepass::collect()
+        {
+                for (int i = 0; i < DEPTH_PREPASS_QUERIES; ++i) {
+                        int q = (mNextQuery + i) % DEPTH_PREPASS_QUERIES;
+                        if (!mInFlight[q])
+                                continue;
+
+                        int available = 0;
+                        glGetQueryObjectiv(mQueries[q], GL_QUERY_RESULT_AVAILABLE, &available);
+                        if (!available)
+                                continue;
+
+                        // oldest first, the newest result available is the one kept
+                        GLuint64 samples = 0;
+                        glGetQueryObjectui64v(mQueries[q], GL_QUERY_RESULT, &samples);
+                        mStats.mShadedSamples = samples;
+                        mStats.mPixels = mQueryPixels[q];
+                        mStats.mOverdraw = mQueryPixels[q] ? static_cast<double>(samples) / mQueryPixels[q] : 0.0;
+                        mInFlight[q] = false;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void depth_prepass::begin(const glm::mat4& projectionView)
+        {
+                mStats.mDraws = 0;
+                if (mEnabled && !mPackets.empty()) {
+                        if (!mVao)
+                                throw exception("al::gl", "depth_prepass", "begin", "the prepass wasn't uploaded", etype::unexpected);
+
+                        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                        mProgram.use();
+                        mVao->bind();
+                        for (const packet& p : mPackets) {
+                                if (mModel.isValid())
+                                        mProgram.uniform(mModel, p.model);
+                                if (mPVM.isValid())
+                                        mProgram.uniform(mPVM, projectionView * p.model);
+
+                                const pool_range& range = mRanges[p.range];
+                                glDrawElementsBaseVertex(GL_TRIANGLES, range.mIndexCount, GL_UNSIGNED_INT,
+                                                         (void*)(range.mFirstIndex * sizeof(unsigned)), range.mBaseVertex);
+                                ++mStats.mDraws;
+                        }
+                        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+                        glGetIntegerv(GL_DEPTH_FUNC, &mDepthFunc);
+                        glGetBooleanv(GL_DEPTH_WRITEMASK, &mDepthMask);
+                        mRestore = true;
+
+                        glDepthFunc(GL_EQUAL);
+                        glDepthMask(GL_FALSE);
+                }
+                mPackets.clear();
+
+                // a frame whose query slot is still in flight goes unmeasured rather than wait
+                mActiveQuery = -1;
+                if (!mInFlight[mNextQuery]) {
+                        int viewport[4];
+                        glGetIntegerv(GL_VIEWPORT, viewport);
+
+                        mActiveQuery = mNextQuery;
+                        mQueryPixels[mActiveQuery] = static_cast<std::uint64_t>(viewport[2]) * viewport[3];
+                        glBeginQuery(GL_SAMPLES_PASSED, mQueries[mActiveQuery]);
+                        mNextQuery = (mNextQuery + 1) % DEPTH_PREPASS_QUERIES;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void depth_prepass::end()
+        {
+                if (mActiveQuery >= 0) {
+                        glEndQuery(GL_SAMPLES_PASSED);
+                        mInFlight[mActiveQuery] = true;
+                        mActiveQuery = -1;
+                }
+
+                if (mRestore) {
+                        glDepthFunc(mDepthFunc);
+                        glDepthMask(mDepthMask);
+                        mRestore = false;
+                }
+
+                collect();
+        }
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "glgeometry_pool.h"
+#include "glmesh.h"
+#include "glprogram.h"
+#include "glvao.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // frames of main pass sample counts in flight before a frame goes unmeasured
+        constexpr int DEPTH_PREPASS_QUERIES = 4;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct depth_prepass_stats
+        {
+                size_t mDraws                   = 0;    // depth-only draws this frame
+                std::uint64_t mShadedSamples    = 0;    // main pass samples that passed depth, latest result
+                std::uint64_t mPixels           = 0;    // viewport of the same frame
+                double mOverdraw                = 0.0;  // shaded samples per pixel, 1 is none
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // lays down depth from a position-only copy of the meshes, so the main pass runs
+        // with GL_EQUAL and shades each pixel once; the depth program has to compute
+        // gl_Position as the main one does, e.g. phong.glsl with shader_features::mDepthOnly
+        class depth_prepass
+        {
+                struct packet
+                {
+                        int range;
+                        glm::mat4 model;
+                };
+
+                program& mProgram;
+                uniform_handle<glm::mat4> mModel;
+                uniform_handle<glm::mat4> mPVM;
+                bool mEnabled = true;
+
+                std::vector<float> mPositions;
+                std::vector<unsigned> mIndices;
+                std::vector<pool_range> mRanges;
+                std::unordered_map<const mesh*, int> mMeshIds;
+                std::optional<vao<float, unsigned>> mVao;
+
+                std::vector<packet> mPackets;
+
+                unsigned mQueries[DEPTH_PREPASS_QUERIES];
+                std::uint64_t mQueryPixels[DEPTH_PREPASS_QUERIES] = {};
+                bool mInFlight[DEPTH_PREPASS_QUERIES] = {};
+                int mNextQuery = 0;
+                int mActiveQuery = -1;
+
+                // depth state begin() replaced, put back by end()
+                bool mRestore = false;
+                int mDepthFunc = GL_LESS;
+                GLboolean mDepthMask = GL_TRUE;
+
+                depth_prepass_stats mStats;
+
+                void collect();
+        public:
+                explicit depth_prepass(program& depthProgram);
+                ~depth_prepass();
+
+                depth_prepass(const depth_prepass&) = delete;
+                depth_prepass& operator=(const depth_prepass&) = delete;
+
+                // copies the positions (attribute 0) and indices of the mesh, once
+                int add(const mesh& m);
+
+                // (re)creates the GL buffers, call after the last add()
+                void upload();
+
+                // m must have been added; model has to match the main pass' exactly
+                void submit(const mesh& m, const glm::mat4& model);
+
+                // draws the submitted meshes into depth only, then leaves depth at GL_EQUAL
+                // with writes off for the main pass; disabled, only the main pass is measured
+                void begin(const glm::mat4& projectionView);
+
+                // after the main pass, restores the depth function and writes begin() found
+                void end();
+
+                // per scene, a prepass pays off where the overdraw is high
+                void setEnabled(bool enabled)                   { mEnabled = enabled; }
+                bool isEnabled() const                          { return mEnabled; }
+
+                const depth_prepass_stats& getStats() const     { return mStats; }
+        };
+}
@@ -0,0 +1,176 @@
+#include "gldynamic_resolution.h"
+#include "error.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        static int scaled(int size, float scale)
+        {
+                return std::max(1, static_cast<int>(std::lround(size * scale)));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        static void validate(const resolution_policy& policy)
+        {
+                if (policy.mStep <= 0.0f || policy.mMinScale < policy.mStep || policy.mMaxScale < policy.mMinScale || policy.mBudget <= 0.0f || policy.mFrames < 1)
+                        throw exception("al::gl", "dynamic_resolution", "setPolicy", "invalid resolution policy", etype::unexpected);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        dynamic_resolution::dynamic_resolution(int windowWidth, int windowHeight, const resolution_policy& policy)
+                : mPolicy{policy}, mWindowWidth{windowWidth}, mWindowHeight{windowHeight},
+                  mTarget(scaled(windowWidth, policy.mMaxScale), scaled(windowHeight, policy.mMaxScale), { GL_RGBA8 })
+        {
+                validate(mPolicy);
+                glGenQueries(2 * RESOLUTION_QUERY_FRAMES, &mQueries[0][0]);
+                apply(maxSteps());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        dynamic_resolution::~dynamic_resolution()
+        {
+                glDeleteQueries(2 * RESOLUTION_QUERY_FRAMES, &mQueries[0][0]);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int dynamic_resolution::minSteps() const
+        {
+                return static_cast<int>(std::ceil(mPolicy.mMinScale / mPolicy.mStep - 1e-3f));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int dynamic_resolution::maxSteps() const
+        {
+                return std::max(minSteps(), static_cast<int>(std::floor(mPolicy.mMaxScale / mPolicy.mStep + 1e-3f)));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::apply(int steps)
+        {
+                mSteps = steps;
+                mWidth = std::min(scaled(mWindowWidth, getScale()), mTarget.getWidth());
+                mHeight = std::min(scaled(mWindowHeight, getScale()), mTarget.getHeight());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::resize(int windowWidth, int windowHeight)
+        {
+                mWindowWidth = windowWidth;
+                mWindowHeight = windowHeight;
+                mTarget.resize(scaled(windowWidth, mPolicy.mMaxScale), scaled(windowHeight, mPolicy.mMaxScale));
+                apply(mSteps);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::setPolicy(const resolution_policy& policy)
+        {
+                validate(policy);
+                int steps = static_cast<int>(std::lround(getScale() / policy.mStep));
+                mPolicy = policy;
+                resize(mWindowWidth, mWindowHeight);
+                apply(std::clamp(steps, minSteps(), maxSteps()));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::collect()
+        {
+                for (int k = 0; k < RESOLUTION_QUERY_FRAMES; ++k) {
+                        int q = (mNextQuery + k) % RESOLUTION_QUERY_FRAMES;
+                        if (!mInFlight[q])
+                                continue;
+
+                        int available = 0;
+                        glGetQueryObjectiv(mQueries[q][1], GL_QUERY_RESULT_AVAILABLE, &available);
+                        if (!available)
+                                continue;
+
+                        // oldest first, only frames drawn at the current scale say anything about it
+                        GLuint64 begin = 0, end = 0;
+                        glGetQueryObjectui64v(mQueries[q][0], GL_QUERY_RESULT, &begin);
+                        glGetQueryObjectui64v(mQueries[q][1], GL_QUERY_RESULT, &end);
+                        mTime = (end - begin) * 1e-6;
+                        if (mQuerySteps[q] == mSteps) {
+                                mSum += mTime;
+                                ++mSamples;
+                        }
+                        mInFlight[q] = false;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::decide()
+        {
+                if (mSamples < mPolicy.mFrames)
+                        return;
+                double time = mSum / mSamples;
+                mSum = 0.0;
+                mSamples = 0;
+
+                float budget = mPolicy.mBudget;
+                if (time <= 0.0 || (time <= budget && time >= budget * (1.0f - mPolicy.mHysteresis)))
+                        return;
+
+                // aimed at the middle of the band, a frame's cost grows with the square of the scale
+                double aim = budget * (1.0f - 0.5f * mPolicy.mHysteresis);
+                double wanted = getScale() * std::sqrt(aim / time);
+                int steps = std::clamp(static_cast<int>(std::lround(wanted / mPolicy.mStep)), minSteps(), maxSteps());
+                if (steps == mSteps)
+                        return;
+
+                apply(steps);
+                mHistory.push_back({ mFrame, getScale(), time });
+                if (mHistory.size() > RESOLUTION_HISTORY)
+                        mHistory.erase(mHistory.begin());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::begin()
+        {
+                if (!mExternal)
+                        collect();
+                decide();
+
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &mPrevious);
+                glBindFramebuffer(GL_FRAMEBUFFER, mTarget.getId());
+                glViewport(0, 0, mWidth, mHeight);
+
+                int q = mNextQuery;
+                if (!mExternal && !mInFlight[q])
+                        glQueryCounter(mQueries[q][0], GL_TIMESTAMP);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::end()
+        {
+                int q = mNextQuery;
+                if (!mExternal && !mInFlight[q]) {
+                        glQueryCounter(mQueries[q][1], GL_TIMESTAMP);
+                        mQuerySteps[q] = mSteps;
+                        mInFlight[q] = true;
+                        mNextQuery = (q + 1) % RESOLUTION_QUERY_FRAMES;
+                }
+                glBindFramebuffer(GL_FRAMEBUFFER, mPrevious);
+                ++mFrame;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::measure(double milliseconds)
+        {
+                mExternal = true;
+                mTime = milliseconds;
+                mSum += milliseconds;
+                ++mSamples;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void dynamic_resolution::present() const
+        {
+                int target = 0;
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &target);
+                mTarget.blit(static_cast<unsigned>(target), mWidth, mHeight, mWindowWidth, mWindowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                glViewport(0, 0, mWindowWidth, mWindowHeight);
+        }
+}
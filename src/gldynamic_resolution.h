@@ -0,0 +1,109 @@
+#pragma once
+
+#include "glframebuffer.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // frames of GPU timestamps in flight before a frame goes unmeasured
+        constexpr int RESOLUTION_QUERY_FRAMES           = 4;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // scale changes kept by dynamic_resolution, the oldest are dropped first
+        constexpr size_t RESOLUTION_HISTORY             = 256;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct resolution_policy
+        {
+                float mBudget                   = 1000.0f / 60.0f;      // GPU milliseconds per frame
+                float mMinScale                 = 0.5f;                 // of the window, per axis
+                float mMaxScale                 = 1.0f;
+                float mHysteresis               = 0.15f;        // fraction of the budget a frame has to come in under before scaling up
+                float mStep                     = 0.05f;        // scales are multiples of it, so they repeat exactly
+                int mFrames                     = 4;            // measured frames averaged before each decision
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct resolution_change
+        {
+                size_t mFrame                   = 0;
+                float mScale                    = 0.0f;         // from this frame on
+                double mTime                    = 0.0;          // mean GPU milliseconds of the frames that caused it
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // offscreen scene target drawn at a scale of the window picked from the GPU time of
+        // earlier frames: over the budget the scale drops, under the hysteresis band below
+        // it the scale grows, in between it stays; the cost is taken as proportional to the
+        // pixels. The target is allocated at the largest scale and drawn into its lower left
+        // corner, so scaling never reallocates; present() stretches that corner to the window
+        class dynamic_resolution
+        {
+                resolution_policy mPolicy;
+                int mWindowWidth, mWindowHeight;
+                framebuffer mTarget;
+                int mPrevious = 0;
+
+                int mSteps;                     // the scale in policy steps
+                int mWidth = 0, mHeight = 0;
+                size_t mFrame = 0;
+
+                unsigned mQueries[RESOLUTION_QUERY_FRAMES][2];
+                int mQuerySteps[RESOLUTION_QUERY_FRAMES] = {};
+                bool mInFlight[RESOLUTION_QUERY_FRAMES] = {};
+                int mNextQuery = 0;
+                bool mExternal = false;
+                double mTime = 0.0;
+                double mSum = 0.0;              // of the frames measured at the current scale
+                int mSamples = 0;
+
+                std::vector<resolution_change> mHistory;
+
+                int minSteps() const;
+                int maxSteps() const;
+                void collect();
+                void apply(int steps);
+                void decide();
+        public:
+                // starts at the largest scale
+                dynamic_resolution(int windowWidth, int windowHeight, const resolution_policy& policy = resolution_policy{});
+                ~dynamic_resolution();
+
+                dynamic_resolution(const dynamic_resolution&) = delete;
+                dynamic_resolution& operator=(const dynamic_resolution&) = delete;
+
+                // reallocates the target for the largest scale of the new window
+                void resize(int windowWidth, int windowHeight);
+
+                // the scale is clamped into the new range
+                void setPolicy(const resolution_policy& policy);
+
+                // picks the frame's scale, then binds the target with the viewport at that
+                // scale and starts timing; everything drawn until end() is measured
+                void begin();
+
+                // stops timing and restores the framebuffer bound before begin()
+                void end();
+
+                // stretches the frame over the window of the framebuffer now bound, linearly filtered
+                void present() const;
+
+                // the time of the frame since begin() as the caller measured it, for drivers whose
+                // timer queries miss the work, such as llvmpipe rasterizing at the flush; once
+                // called, the queries are left out and every frame has to be measured this way
+                void measure(double milliseconds);
+
+                const resolution_policy& getPolicy() const                      { return mPolicy; }
+                float getScale() const                                          { return mSteps * mPolicy.mStep; }
+                int getWidth() const                                            { return mWidth; }
+                int getHeight() const                                           { return mHeight; }
+                double getTime() const                                          { return mTime; }
+                const framebuffer& getTarget() const                            { return mTarget; }
+                const std::vector<resolution_change>& getHistory() const        { return mHistory; }
+        };
+}
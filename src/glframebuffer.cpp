@@ -0,0 +1,171 @@
+#include "glframebuffer.h"
+#include "glstate.h"
+#include "error.h"
+
+#include <string>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // a pixel format and type glTexImage2D accepts along with the internal format
+        static void findTransfer(int internalFormat, int& format, int& type)
+        {
+                switch (internalFormat) {
+                        case GL_DEPTH_COMPONENT16:
+                        case GL_DEPTH_COMPONENT24:
+                        case GL_DEPTH_COMPONENT32F:
+                                format = GL_DEPTH_COMPONENT;
+                                type = GL_FLOAT;
+                                break;
+                        case GL_DEPTH24_STENCIL8:
+                                format = GL_DEPTH_STENCIL;
+                                type = GL_UNSIGNED_INT_24_8;
+                                break;
+                        case GL_R8UI:
+                        case GL_R32UI:
+                        case GL_RG32UI:
+                                format = internalFormat == GL_RG32UI ? GL_RG_INTEGER : GL_RED_INTEGER;
+                                type = GL_UNSIGNED_INT;
+                                break;
+                        default:
+                                // float data converts to any normalized or float color format
+                                format = GL_RGBA;
+                                type = GL_FLOAT;
+                                break;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        framebuffer::framebuffer(int width, int height, const std::vector<int>& colorFormats, int depthFormat)
+                : mWidth{width}, mHeight{height}, mColorFormats{colorFormats}, mDepthFormat{depthFormat}
+        {
+                create();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        framebuffer::~framebuffer()
+        {
+                destroy();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::create()
+        {
+                int previous = 0;
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+                glGenFramebuffers(1, &mId);
+                glBindFramebuffer(GL_FRAMEBUFFER, mId);
+
+                auto attach = [&](int internalFormat, int attachment) {
+                        unsigned texture;
+                        int format, type;
+                        findTransfer(internalFormat, format, type);
+
+                        glGenTextures(1, &texture);
+                        glstate().bindTexture(GL_TEXTURE_2D, texture);
+                                glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, mWidth, mHeight, 0, format, type, nullptr);
+                                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+                        glstate().bindTexture(GL_TEXTURE_2D, 0);
+                        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+                        return texture;
+                };
+
+                std::vector<unsigned> drawBuffers;
+                for (size_t i = 0; i < mColorFormats.size(); ++i) {
+                        mColors.push_back(attach(mColorFormats[i], GL_COLOR_ATTACHMENT0 + static_cast<int>(i)));
+                        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + static_cast<unsigned>(i));
+                }
+                if (mDepthFormat)
+                        mDepth = attach(mDepthFormat, mDepthFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT);
+
+                if (drawBuffers.empty())
+                        glDrawBuffer(GL_NONE);
+                else
+                        glDrawBuffers(static_cast<int>(drawBuffers.size()), drawBuffers.data());
+
+                int status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+                glBindFramebuffer(GL_FRAMEBUFFER, previous);
+                if (status != GL_FRAMEBUFFER_COMPLETE) {
+                        destroy();
+                        throw exception("al::gl", "framebuffer", "create", "incomplete framebuffer, status " + std::to_string(status), etype::unexpected);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::destroy()
+        {
+                for (unsigned texture : mColors)
+                        glstate().forgetTexture(texture);
+                if (!mColors.empty())
+                        glDeleteTextures(static_cast<int>(mColors.size()), mColors.data());
+                mColors.clear();
+
+                if (mDepth) {
+                        glstate().forgetTexture(mDepth);
+                        glDeleteTextures(1, &mDepth);
+                        mDepth = 0;
+                }
+
+                glDeleteFramebuffers(1, &mId);
+                mId = 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::resize(int width, int height)
+        {
+                if (width == mWidth && height == mHeight)
+                        return;
+
+                destroy();
+                mWidth = width;
+                mHeight = height;
+                create();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::bind() const
+        {
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &mPrevious);
+                glBindFramebuffer(GL_FRAMEBUFFER, mId);
+                glViewport(0, 0, mWidth, mHeight);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::unbind() const
+        {
+                glBindFramebuffer(GL_FRAMEBUFFER, mPrevious);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::blit(unsigned target, int width, int height, int mask, int filter) const
+        {
+                blit(target, mWidth, mHeight, width, height, mask, filter);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::blit(unsigned target, int srcWidth, int srcHeight, int width, int height, int mask, int filter) const
+        {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, mId);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target);
+                glBlitFramebuffer(0, 0, srcWidth, srcHeight, 0, 0, width, height, mask, filter);
+                glBindFramebuffer(GL_FRAMEBUFFER, target);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void framebuffer::readPixels(std::vector<unsigned char>& pixels, size_t color) const
+        {
+                pixels.resize(static_cast<size_t>(mWidth) * mHeight * 4);
+
+                int previous = 0;
+                glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, mId);
+                glReadBuffer(GL_COLOR_ATTACHMENT0 + static_cast<int>(color));
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glReadPixels(0, 0, mWidth, mHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+        }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // offscreen render target of color textures and an optional depth texture, all
+        // sampled with texelFetch, so they have no mipmaps and filter with GL_NEAREST
+        class framebuffer
+        {
+                unsigned mId = 0;
+                mutable int mPrevious = 0;
+                int mWidth = 0, mHeight = 0;
+
+                std::vector<int> mColorFormats;
+                int mDepthFormat;
+
+                std::vector<unsigned> mColors;
+                unsigned mDepth = 0;
+
+                void create();
+                void destroy();
+        public:
+                // internal formats such as GL_RGBA8, a depth format of 0 leaves depth out
+                framebuffer(int width, int height, const std::vector<int>& colorFormats, int depthFormat = GL_DEPTH24_STENCIL8);
+                ~framebuffer();
+
+                framebuffer(const framebuffer&) = delete;
+                framebuffer& operator=(const framebuffer&) = delete;
+
+                // reallocates the attachments, their contents are lost
+                void resize(int width, int height);
+
+                // draws into every color attachment and sets the viewport to the whole target
+                void bind() const;
+
+                // back to the framebuffer bound before bind(), the caller restores its viewport
+                void unbind() const;
+
+                // copies the region of this target to the whole of another, 0 is the default
+                // framebuffer; depth and stencil need matching formats and GL_NEAREST
+                void blit(unsigned target, int width, int height, int mask, int filter = GL_NEAREST) const;
+
+                // the same from the lower left srcWidth x srcHeight texels only, for targets
+                // allocated larger than what is drawn into them
+                void blit(unsigned target, int srcWidth, int srcHeight, int width, int height, int mask, int filter) const;
+
+                // RGBA8 of a color attachment, bottom row first like GL; waits for the GPU
+                void readPixels(std::vector<unsigned char>& pixels, size_t color = 0) const;
+
+                unsigned getId() const                          { return mId; }
+                int getWidth() const                            { return mWidth; }
+                int getHeight() const                           { return mHeight; }
+                size_t getNumColors() const                     { return mColors.size(); }
+                unsigned getColor(size_t i) const               { return mColors[i]; }
+                unsigned getDepth() const                       { return mDepth; }
+        };
+}
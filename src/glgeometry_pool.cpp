@@ -0,0 +1,61 @@
+#include "glgeometry_pool.h"
+#include "error.h"
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        int geometry_pool::add(const mesh& m)
+        {
+                auto id = mMeshIds.find(&m);
+                if (id != mMeshIds.end())
+                        return id->second;
+
+                const auto& infos = m.getVao().getInfos();
+                if (infos.empty() || infos.front().stride != POOL_VERTEX_FLOATS * sizeof(float))
+                        throw exception("al::gl", "geometry_pool", "add", "the mesh's vertex layout differs from the pool's", etype::unexpected);
+
+                const std::vector<float>& vertices = m.getVao().getVbo().getData();
+                const std::vector<unsigned>& indices = m.getVao().getEbo().getData();
+
+                // indices stay relative to the mesh, the base vertex offsets them at draw time
+                pool_range range;
+                range.mFirstIndex = static_cast<unsigned>(mIndices.size());
+                range.mIndexCount = static_cast<unsigned>(indices.size());
+                range.mBaseVertex = static_cast<int>(mVertices.size() / POOL_VERTEX_FLOATS);
+
+                mVertices.insert(mVertices.end(), vertices.begin(), vertices.end());
+                mIndices.insert(mIndices.end(), indices.begin(), indices.end());
+                mRanges.push_back(range);
+                return mMeshIds.emplace(&m, static_cast<int>(mRanges.size()) - 1).first->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void geometry_pool::upload()
+        {
+                std::vector<vao_info> infos {
+                        { 0, 3, GL_FLOAT, GL_FALSE, POOL_VERTEX_FLOATS * sizeof(float), (void*)0 },
+                        { 1, 3, GL_FLOAT, GL_FALSE, POOL_VERTEX_FLOATS * sizeof(float), (void*)(3 * sizeof(float)) },
+                        { 2, 2, GL_FLOAT, GL_FALSE, POOL_VERTEX_FLOATS * sizeof(float), (void*)(6 * sizeof(float)) }
+                };
+
+                mVao.reset();
+                mVao.emplace(buffer<float>(GL_ARRAY_BUFFER, std::vector<float>(mVertices), GL_STATIC_DRAW),
+                             buffer<unsigned>(GL_ELEMENT_ARRAY_BUFFER, std::vector<unsigned>(mIndices), GL_STATIC_DRAW),
+                             infos);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int geometry_pool::find(const mesh& m) const
+        {
+                auto id = mMeshIds.find(&m);
+                return id != mMeshIds.end() ? id->second : -1;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        const vao<float, unsigned>& geometry_pool::getVao() const
+        {
+                if (!mVao)
+                        throw exception("al::gl", "geometry_pool", "getVao", "the pool wasn't uploaded", etype::unexpected);
+                return *mVao;
+        }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "glmesh.h"
+#include "glvao.h"
+
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // position, normal and texture coordinates, the layout of model and genCube meshes
+        constexpr int POOL_VERTEX_FLOATS = 8;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // where a mesh lives in the pool, the fields of a draw command
+        struct pool_range
+        {
+                unsigned mFirstIndex;
+                unsigned mIndexCount;
+                int mBaseVertex;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // vertices and indices of many meshes in one vbo, ebo and vao, so a single
+        // multi-draw can reach all of them
+        class geometry_pool
+        {
+                std::vector<float> mVertices;
+                std::vector<unsigned> mIndices;
+                std::vector<pool_range> mRanges;
+                std::unordered_map<const mesh*, int> mMeshIds;
+
+                std::optional<vao<float, unsigned>> mVao;
+        public:
+                // copies the mesh's geometry, adding a mesh twice returns the same range
+                int add(const mesh& m);
+
+                // (re)creates the GL buffers, call after the last add()
+                void upload();
+
+                // -1 when the mesh was never added
+                int find(const mesh& m) const;
+
+                size_t size() const                                     { return mRanges.size(); }
+                const pool_range& operator[](int index) const           { return mRanges[index]; }
+
+                bool isUploaded() const                                 { return mVao.has_value(); }
+                const vao<float, unsigned>& getVao() const;
+        };
+}
@@ -0,0 +1,159 @@
+#include "glheadless_context.h"
+#include "glstate.h"
+#include "config.h"
+#include "error.h"
+
+#include <glad/glad.h>
+
+#ifdef LOVELACE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <cstring>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        bool headless_context::isSupported()
+        {
+#ifdef LOVELACE_EGL
+                return true;
+#else
+                return false;
+#endif
+        }
+
+#ifdef LOVELACE_EGL
+        ////////////////////////////////////////////////////////////////////////////////
+        static bool hasExtension(const char* extensions, const char* name)
+        {
+                // whole words only, some names are prefixes of others
+                size_t length = std::strlen(name);
+                for (const char* p = extensions; p && (p = std::strstr(p, name)); p += length)
+                        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0'))
+                                return true;
+                return false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        static EGLDisplay openDisplay()
+        {
+                // client extensions, queried without a display
+                const char* client = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+                if (hasExtension(client, "EGL_MESA_platform_surfaceless") && hasExtension(client, "EGL_EXT_platform_base")) {
+                        auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+                        if (getPlatformDisplay) {
+                                EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+                                if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr))
+                                        return display;
+                        }
+                }
+
+                EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+                if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+                        throw exception("al::gl", "headless_context", "headless_context", "couldn't initialize an EGL display", etype::unexpected);
+                return display;
+        }
+#endif
+
+        ////////////////////////////////////////////////////////////////////////////////
+        headless_context::headless_context(int width, int height, bool debug)
+        {
+#ifdef LOVELACE_EGL
+                EGLDisplay display = openDisplay();
+                mDisplay = display;
+                try {
+                        if (!eglBindAPI(EGL_OPENGL_API))
+                                throw exception("al::gl", "headless_context", "headless_context", "the EGL display has no desktop OpenGL", etype::unexpected);
+
+                        bool surfaceless = hasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+                        const EGLint configAttributes[] = {
+                                EGL_SURFACE_TYPE,       EGL_PBUFFER_BIT,
+                                EGL_RENDERABLE_TYPE,    EGL_OPENGL_BIT,
+                                EGL_NONE
+                        };
+                        EGLConfig config = nullptr;
+                        EGLint configs = 0;
+                        if (!eglChooseConfig(display, configAttributes, &config, 1, &configs) || configs == 0) {
+                                // surfaceless displays may have no pbuffer configs at all
+                                if (!surfaceless)
+                                        throw exception("al::gl", "headless_context", "headless_context", "no EGL config for a pbuffer", etype::unexpected);
+                                config = nullptr;
+                        }
+
+                        // the same context the windowed examples ask GLFW for
+                        const EGLint contextAttributes[] = {
+                                EGL_CONTEXT_MAJOR_VERSION,              4,
+                                EGL_CONTEXT_MINOR_VERSION,              0,
+                                EGL_CONTEXT_OPENGL_PROFILE_MASK,        EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                EGL_CONTEXT_OPENGL_DEBUG,               debug ? EGL_TRUE : EGL_FALSE,
+                                EGL_NONE
+                        };
+                        mContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+                        if (mContext == EGL_NO_CONTEXT)
+                                throw exception("al::gl", "headless_context", "headless_context", "couldn't create a GL 4.0 core context", etype::unexpected);
+
+                        // drawing never goes to the surface, it only has to exist
+                        if (!surfaceless) {
+                                const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+                                mSurface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+                                if (mSurface == EGL_NO_SURFACE)
+                                        throw exception("al::gl", "headless_context", "headless_context", "couldn't create a pbuffer", etype::unexpected);
+                        }
+
+                        makeCurrent();
+                        if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress)))
+                                throw exception("al::gl", "headless_context", "headless_context", "couldn't initialize GLAD", etype::unexpected);
+
+                        // the cache may still hold an earlier context's bindings, whose names GL hands out again
+                        glstate().invalidate();
+
+                        mTarget = std::make_unique<framebuffer>(width, height, std::vector<int>{ GL_RGBA8 });
+                        mTarget->bind();
+                }
+                catch (...) {
+                        destroy();
+                        throw;
+                }
+#else
+                throw exception("al::gl", "headless_context", "headless_context", "built without EGL, configure with HEADLESS on", etype::unexpected);
+#endif
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        headless_context::~headless_context()
+        {
+                destroy();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void headless_context::destroy()
+        {
+#ifdef LOVELACE_EGL
+                if (!mDisplay)
+                        return;
+
+                // the target's GL objects go while their context is still current
+                mTarget.reset();
+                eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+                if (mSurface)
+                        eglDestroySurface(mDisplay, mSurface);
+                if (mContext)
+                        eglDestroyContext(mDisplay, mContext);
+                eglTerminate(mDisplay);
+                mDisplay = mContext = mSurface = nullptr;
+                glstate().invalidate();
+#endif
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void headless_context::makeCurrent() const
+        {
+#ifdef LOVELACE_EGL
+                EGLSurface surface = mSurface ? mSurface : EGL_NO_SURFACE;
+                if (!eglMakeCurrent(mDisplay, surface, surface, mContext))
+                        throw exception("al::gl", "headless_context", "makeCurrent", "couldn't make the context current", etype::unexpected);
+#endif
+        }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "glframebuffer.h"
+
+#include <memory>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // GL 4 core context without a window or a display server, through EGL: Mesa's
+        // surfaceless platform when present, such as llvmpipe on a render node without a
+        // GPU, the default display otherwise, with a pbuffer where surfaceless contexts
+        // are not supported. Loads GLAD, then draws into getTarget(), an RGBA8 and D24S8
+        // framebuffer left bound. Only available when built with LOVELACE_EGL
+        class headless_context
+        {
+                void* mDisplay = nullptr;
+                void* mContext = nullptr;
+                void* mSurface = nullptr;
+                std::unique_ptr<framebuffer> mTarget;
+
+                void destroy();
+        public:
+                headless_context(int width, int height, bool debug = false);
+                ~headless_context();
+
+                headless_context(const headless_context&) = delete;
+                headless_context& operator=(const headless_context&) = delete;
+
+                static bool isSupported();
+
+                void makeCurrent() const;
+
+                framebuffer& getTarget()                        { return *mTarget; }
+                const framebuffer& getTarget() const            { return *mTarget; }
+        };
+}
@@ -0,0 +1,173 @@
+#include "glindirect_queue.h"
+#include "error.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        indirect_queue::indirect_queue(geometry_pool& pool, const material_table* materials)
+                : mPool{pool}, mMaterials{materials}, mIndirect{isSupported()},
+                  mCommandBuffer(GL_DRAW_INDIRECT_BUFFER, std::vector<draw_elements_command>(64), GL_DYNAMIC_DRAW) {}
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool indirect_queue::isSupported()
+        {
+                return GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int indirect_queue::findTextureId(const mesh& m, int material)
+        {
+                auto id = mDrawTextures.find({&m, material});
+                if (id != mDrawTextures.end())
+                        return id->second;
+
+                // same rule as render_queue, the mesh's textures then its material's
+                std::vector<const texture2D*> textures(m.mTextures.begin(), m.mTextures.end());
+                if (material >= 0 && mMaterials) {
+                        const phong_material& mat = (*mMaterials)[material];
+                        textures.push_back(mat.mEnableAmbientTexture ? mat.mAmbientTexture : nullptr);
+                        textures.push_back(mat.mEnableDiffuseTexture ? mat.mDiffuseTexture : nullptr);
+                        textures.push_back(mat.mEnableSpecularTexture ? mat.mSpecularTexture : nullptr);
+                }
+
+                int textureId = mTextureIds.emplace(std::move(textures), static_cast<int>(mTextureIds.size())).first->second;
+                return mDrawTextures.emplace(std::make_pair(&m, material), textureId).first->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void indirect_queue::submit(const mesh& m, program& p, const glm::mat4& model, int material, int mode)
+        {
+                int range = mPool.find(m);
+                if (range < 0)
+                        throw exception("al::gl", "indirect_queue", "submit", "the mesh isn't part of the queue's geometry pool", etype::unexpected);
+
+                int programId = mProgramIds.emplace(&p, static_cast<int>(mProgramIds.size())).first->second;
+                if (programId > 0xffff)
+                        throw exception("al::gl", "indirect_queue", "submit", "more than 65536 programs in one frame", etype::unexpected);
+
+                std::uint64_t key = 0;
+                key |= static_cast<std::uint64_t>(programId)                            << 48;
+                key |= static_cast<std::uint64_t>(mode & 0xff)                          << 40;
+                key |= static_cast<std::uint64_t>(findTextureId(m, material));
+
+                mPackets.push_back({key, &m, &p, range, material, mode, model});
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void indirect_queue::uploadCommands()
+        {
+                size_t count = mCommands.size();
+                if (count > mCommandBuffer.getSize()) {
+                        std::vector<draw_elements_command> data(std::max(count, 2 * mCommandBuffer.getSize()));
+                        std::copy(mCommands.begin(), mCommands.end(), data.begin());
+                        mCommandBuffer = buffer<draw_elements_command>(GL_DRAW_INDIRECT_BUFFER, std::move(data), GL_DYNAMIC_DRAW);
+                        mCommandBuffer.bind();
+                        return;
+                }
+
+                std::copy(mCommands.begin(), mCommands.end(), mCommandBuffer.getData().begin());
+                mCommandBuffer.upload(0, count);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void indirect_queue::bindState(const packet& first)
+        {
+                first.p->use();
+
+                // the instance matrix is the whole transform, uModel would be applied on top
+                auto handle = mModelHandles.find(first.p);
+                if (handle == mModelHandles.end())
+                        handle = mModelHandles.emplace(first.p, first.p->hasUniform("uModel") ? first.p->handle<glm::mat4>("uModel")
+                                                                                               : uniform_handle<glm::mat4>{}).first;
+                if (handle->second.isValid())
+                        first.p->uniform(handle->second, glm::mat4(1.0f));
+
+                first.m->bindTextures();
+                if (first.material >= 0 && mMaterials)
+                        mMaterials->bindTextures(first.material);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void indirect_queue::clear()
+        {
+                mPackets.clear();
+                mProgramIds.clear();
+                mTextureIds.clear();
+                mDrawTextures.clear();
+                mModelHandles.clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void indirect_queue::execute()
+        {
+                mStats = {};
+                if (mPackets.empty()) {
+                        clear();
+                        return;
+                }
+
+                size_t n = mPackets.size();
+                mOrder.resize(n);
+                std::iota(mOrder.begin(), mOrder.end(), 0);
+                std::stable_sort(mOrder.begin(), mOrder.end(), [this](std::uint32_t a, std::uint32_t b) { return mPackets[a].key < mPackets[b].key; });
+
+                // command i reads instance i, baseInstance is the draw id
+                mInstances.clear();
+                mCommands.clear();
+                for (size_t i = 0; i < n; ++i) {
+                        const packet& pk = mPackets[mOrder[i]];
+                        const pool_range& range = mPool[pk.range];
+                        mInstances.push_back({pk.model, pk.material});
+                        mCommands.push_back({range.mIndexCount, 1, range.mFirstIndex, range.mBaseVertex, static_cast<unsigned>(i)});
+                }
+
+                const vao<float, unsigned>& poolVao = mPool.getVao();
+                if (mIndirect) {
+                        mInstanceBuffer.set(mInstances);
+                        mInstanceBuffer.attach(poolVao);
+                        uploadCommands();
+                }
+                else {
+                        poolVao.detach(instance_buffer::getLayout());
+                }
+                poolVao.bind();
+
+                for (size_t first = 0; first < n;) {
+                        size_t last = first + 1;
+                        while (last < n && mPackets[mOrder[last]].key == mPackets[mOrder[first]].key)
+                                ++last;
+
+                        const packet& pk = mPackets[mOrder[first]];
+                        bindState(pk);
+
+                        if (mIndirect) {
+                                glMultiDrawElementsIndirect(pk.mode, GL_UNSIGNED_INT, (void*)(first * sizeof(draw_elements_command)),
+                                                            static_cast<int>(last - first), 0);
+                                ++mStats.mCalls;
+                        }
+                        else {
+                                for (size_t i = first; i < last; ++i) {
+                                        const instance_data& instance = mInstances[i];
+                                        const draw_elements_command& command = mCommands[i];
+                                        for (int c = 0; c < 4; ++c)
+                                                glVertexAttrib4fv(INSTANCE_MODEL_LOCATION + c, &instance.mModel[c][0]);
+                                        glVertexAttribI1i(INSTANCE_MATERIAL_LOCATION, instance.mMaterial);
+                                        glDrawElementsBaseVertex(pk.mode, command.mCount, GL_UNSIGNED_INT,
+                                                                 (void*)(command.mFirstIndex * sizeof(unsigned)), command.mBaseVertex);
+                                        ++mStats.mCalls;
+                                }
+                        }
+
+                        ++mStats.mBuckets;
+                        first = last;
+                }
+
+                mStats.mDraws = n;
+                clear();
+        }
+}
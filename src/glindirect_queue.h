@@ -0,0 +1,100 @@
+#pragma once
+
+#include "glbuffer.h"
+#include "glgeometry_pool.h"
+#include "glinstance_buffer.h"
+#include "glmaterial_table.h"
+#include "glmesh.h"
+#include "glprogram.h"
+#include "gltexture2D.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // layout fixed by GL for glMultiDrawElementsIndirect
+        struct draw_elements_command
+        {
+                unsigned mCount;
+                unsigned mInstanceCount;
+                unsigned mFirstIndex;
+                int mBaseVertex;
+                unsigned mBaseInstance;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct indirect_stats
+        {
+                size_t mDraws                   = 0;    // meshes drawn
+                size_t mBuckets                 = 0;    // runs sharing program, textures and mode
+                size_t mCalls                   = 0;    // GL draw calls issued
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // draws meshes of a geometry_pool with one glMultiDrawElementsIndirect per state
+        // bucket; each command's baseInstance selects its model matrix and material from
+        // the instance attributes, so programs must be shader_features::mInstanced
+        class indirect_queue
+        {
+                struct packet
+                {
+                        std::uint64_t key;
+                        const mesh* m;
+                        program* p;
+                        int range;
+                        int material;
+                        int mode;
+                        glm::mat4 model;
+                };
+
+                geometry_pool& mPool;
+                const material_table* mMaterials;
+                bool mIndirect;
+
+                std::vector<packet> mPackets;
+                std::vector<std::uint32_t> mOrder;
+                std::vector<instance_data> mInstances;
+                std::vector<draw_elements_command> mCommands;
+
+                instance_buffer mInstanceBuffer;
+                buffer<draw_elements_command> mCommandBuffer;
+
+                // keyed by address, so they only live for one frame's submits: a freed mesh or
+                // program may hand its address to another, and a mesh may change its textures
+                std::unordered_map<const program*, int> mProgramIds;
+                std::map<std::vector<const texture2D*>, int> mTextureIds;
+                std::map<std::pair<const mesh*, int>, int> mDrawTextures;
+                std::unordered_map<const program*, uniform_handle<glm::mat4>> mModelHandles;
+
+                indirect_stats mStats;
+
+                int findTextureId(const mesh& m, int material);
+                void uploadCommands();
+                void bindState(const packet& first);
+                void clear();
+        public:
+                explicit indirect_queue(geometry_pool& pool, const material_table* materials = nullptr);
+
+                // m must have been added to the pool; model is the whole transform of the draw
+                void submit(const mesh& m, program& p, const glm::mat4& model, int material = -1, int mode = GL_TRIANGLES);
+
+                void execute();
+
+                // GL 4.3 or ARB_multi_draw_indirect with ARB_base_instance, false loops over
+                // glDrawElementsBaseVertex and passes the per-draw data as constant attributes
+                static bool isSupported();
+                void setIndirect(bool indirect)                 { mIndirect = indirect && isSupported(); }
+                bool isIndirect() const                         { return mIndirect; }
+
+                size_t getNumPackets() const                    { return mPackets.size(); }
+                const indirect_stats& getStats() const          { return mStats; }
+        };
+}
@@ -0,0 +1,64 @@
+#include "glinstance_buffer.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        std::uint64_t instance_buffer::genKey()
+        {
+                static std::uint64_t next = 0;
+                return ++next;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        instance_buffer::instance_buffer(size_t capacity)
+                : mBuffer(GL_ARRAY_BUFFER, std::vector<instance_data>(std::max<size_t>(capacity, 1)), GL_DYNAMIC_DRAW),
+                  mKey{genKey()} {}
+
+        ////////////////////////////////////////////////////////////////////////////////
+        instance_buffer::instance_buffer(const instance_buffer& other)
+                : mBuffer{other.mBuffer}, mCount{other.mCount}, mKey{genKey()} {}
+
+        ////////////////////////////////////////////////////////////////////////////////
+        instance_buffer& instance_buffer::operator=(const instance_buffer& other)
+        {
+                if (this != &other) {
+                        mBuffer = other.mBuffer;
+                        mCount  = other.mCount;
+                        mKey    = genKey();
+                }
+                return *this;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void instance_buffer::set(const std::vector<instance_data>& instances)
+        {
+                mCount = instances.size();
+                if (mCount > mBuffer.getSize()) {
+                        // doubled so a slowly growing count doesn't reallocate every frame
+                        std::vector<instance_data> data(std::max(mCount, 2 * mBuffer.getSize()));
+                        std::copy(instances.begin(), instances.end(), data.begin());
+                        mBuffer = buffer<instance_data>(GL_ARRAY_BUFFER, std::move(data), GL_DYNAMIC_DRAW);
+                        mKey = genKey();
+                        return;
+                }
+
+                std::copy(instances.begin(), instances.end(), mBuffer.getData().begin());
+                mBuffer.upload(0, mCount);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        const std::vector<vao_info>& instance_buffer::getLayout()
+        {
+                static const std::vector<vao_info> layout {
+                        { INSTANCE_MODEL_LOCATION + 0, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(offsetof(instance_data, mModel) + 0 * sizeof(glm::vec4)), 1 },
+                        { INSTANCE_MODEL_LOCATION + 1, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(offsetof(instance_data, mModel) + 1 * sizeof(glm::vec4)), 1 },
+                        { INSTANCE_MODEL_LOCATION + 2, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(offsetof(instance_data, mModel) + 2 * sizeof(glm::vec4)), 1 },
+                        { INSTANCE_MODEL_LOCATION + 3, 4, GL_FLOAT, GL_FALSE, sizeof(instance_data), (void*)(offsetof(instance_data, mModel) + 3 * sizeof(glm::vec4)), 1 },
+                        { INSTANCE_MATERIAL_LOCATION,  1, GL_INT,   GL_FALSE, sizeof(instance_data), (void*)offsetof(instance_data, mMaterial), 1 }
+                };
+                return layout;
+        }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "glbuffer.h"
+#include "glvao.h"
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // a mat4 attribute takes one location per column
+        constexpr unsigned INSTANCE_MODEL_LOCATION      = 3;
+        constexpr unsigned INSTANCE_MATERIAL_LOCATION   = 7;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct instance_data
+        {
+                glm::mat4 mModel                        = glm::mat4(1.0f);
+
+                // material_table index, -1 falls back to uMaterialIndex
+                int mMaterial                           = -1;
+                int mPadding[3]                         = {};
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // per-instance attributes of drawInstanced, one buffer shared by every mesh it draws
+        class instance_buffer
+        {
+                buffer<instance_data> mBuffer;
+                size_t mCount = 0;
+
+                // changes whenever mBuffer is a different GL buffer, vaos re-attach on mismatch
+                std::uint64_t mKey;
+
+                static std::uint64_t genKey();
+        public:
+                explicit instance_buffer(size_t capacity = 64);
+
+                instance_buffer(const instance_buffer&);
+                instance_buffer& operator=(const instance_buffer&);
+
+                instance_buffer(instance_buffer&&) = default;
+                instance_buffer& operator=(instance_buffer&&) = default;
+
+                // grows the GL buffer when needed, otherwise a single glBufferSubData
+                void set(const std::vector<instance_data>& instances);
+
+                size_t size() const                             { return mCount; }
+                size_t getCapacity() const                      { return mBuffer.getSize(); }
+
+                // locations 3 to 6 hold the model matrix, 7 the material index
+                static const std::vector<vao_info>& getLayout();
+
+                template <typename VT, typename IT>
+                void attach(const vao<VT, IT>& v) const        { v.attach(mBuffer, getLayout(), mKey); }
+        };
+}
@@ -0,0 +1,126 @@
+#include "glmaterial_table.h"
+#include "error.h"
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        void material_table::load()
+        {
+                glGenTextures(1, &mTexture);
+                upload();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        material_table::material_table()
+                : mBuffer(GL_TEXTURE_BUFFER, std::vector<glm::vec4>(), GL_STATIC_DRAW)
+        {
+                load();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        material_table::material_table(const material_table& other)
+                : mMaterials{other.mMaterials}, mBuffer{other.mBuffer}
+        {
+                load();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        material_table& material_table::operator=(const material_table& other)
+        {
+                if (this != &other) {
+                        glstate().forgetTexture(mTexture);
+                        glDeleteTextures(1, &mTexture);
+
+                        mMaterials      = other.mMaterials;
+                        mBuffer         = other.mBuffer;
+
+                        load();
+                }
+                return *this;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        material_table::material_table(material_table&& other)
+                : mMaterials{std::move(other.mMaterials)}, mBuffer{std::move(other.mBuffer)}, mTexture{other.mTexture}
+        {
+                other.mTexture = 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        material_table& material_table::operator=(material_table&& other)
+        {
+                if (this != &other) {
+                        glstate().forgetTexture(mTexture);
+                        glDeleteTextures(1, &mTexture);
+
+                        mMaterials      = std::move(other.mMaterials);
+                        mBuffer         = std::move(other.mBuffer);
+                        mTexture        = other.mTexture;
+
+                        other.mTexture  = 0;
+                }
+                return *this;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int material_table::add(const phong_material& material)
+        {
+                mMaterials.push_back(material);
+                return static_cast<int>(mMaterials.size()) - 1;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void material_table::upload()
+        {
+                int maxTexels = 0;
+                glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+                if (mMaterials.size() * MATERIAL_TEXELS > static_cast<size_t>(maxTexels))
+                        throw exception("al::gl", "material_table", "upload", "too many materials for a buffer texture", etype::unexpected);
+
+                std::vector<glm::vec4> texels;
+                texels.reserve(mMaterials.size() * MATERIAL_TEXELS);
+                for (const phong_material& m : mMaterials) {
+                        texels.emplace_back(m.mAmbient, m.mEnableAmbientTexture ? 1.0f : 0.0f);
+                        texels.emplace_back(m.mDiffuse, m.mEnableDiffuseTexture ? 1.0f : 0.0f);
+                        texels.emplace_back(m.mSpecular, m.mEnableSpecularTexture ? 1.0f : 0.0f);
+                        texels.emplace_back(m.mShininess, 0.0f, 0.0f, 0.0f);
+                }
+
+                // the texture keeps referencing the old store until it is re-attached
+                mBuffer = buffer<glm::vec4>(GL_TEXTURE_BUFFER, std::move(texels), GL_STATIC_DRAW);
+                glstate().bindTexture(GL_TEXTURE_BUFFER, mTexture);
+                        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mBuffer.getId());
+                glstate().bindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void material_table::attach(program& p) const
+        {
+                // textures are compiled out of permutations without texture coordinates
+                p.uniform("uMaterials", MATERIAL_TABLE_UNIT);
+                if (p.hasUniform("uAmbientTexture"))
+                        p.uniform("uAmbientTexture", MATERIAL_AMBIENT_UNIT);
+                if (p.hasUniform("uDiffuseTexture"))
+                        p.uniform("uDiffuseTexture", MATERIAL_DIFFUSE_UNIT);
+                if (p.hasUniform("uSpecularTexture"))
+                        p.uniform("uSpecularTexture", MATERIAL_SPECULAR_UNIT);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void material_table::bind() const
+        {
+                glstate().bindTexture(MATERIAL_TABLE_UNIT, GL_TEXTURE_BUFFER, mTexture);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void material_table::bindTextures(int index) const
+        {
+                const phong_material& m = mMaterials[index];
+                if (m.mEnableAmbientTexture && m.mAmbientTexture)
+                        m.mAmbientTexture->bind(MATERIAL_AMBIENT_UNIT);
+                if (m.mEnableDiffuseTexture && m.mDiffuseTexture)
+                        m.mDiffuseTexture->bind(MATERIAL_DIFFUSE_UNIT);
+                if (m.mEnableSpecularTexture && m.mSpecularTexture)
+                        m.mSpecularTexture->bind(MATERIAL_SPECULAR_UNIT);
+        }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "glbuffer.h"
+#include "glmaterial.h"
+#include "glprogram.h"
+
+#include <glad/glad.h>
+#include <glm/vec4.hpp>
+
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // texture units of the table and of the material textures, as seen by phong.glsl
+        constexpr int MATERIAL_AMBIENT_UNIT             = 0;
+        constexpr int MATERIAL_DIFFUSE_UNIT             = 1;
+        constexpr int MATERIAL_SPECULAR_UNIT            = 2;
+        constexpr int MATERIAL_TABLE_UNIT               = 3;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // texels of one material, enable flags ride in the w components
+        constexpr int MATERIAL_TEXELS                   = 4;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // every material packed once into a buffer texture, draws pass only an index
+        class material_table
+        {
+                std::vector<phong_material> mMaterials;
+                buffer<glm::vec4> mBuffer;
+                unsigned mTexture;
+
+                void load();
+        public:
+                material_table();
+
+                ~material_table()               { glstate().forgetTexture(mTexture); glDeleteTextures(1, &mTexture); }
+
+                material_table(const material_table&);
+                material_table& operator=(const material_table&);
+
+                material_table(material_table&&);
+                material_table& operator=(material_table&&);
+
+                int add(const phong_material& material);
+                void upload();
+
+                // the program must be in use, points its samplers at the table units
+                void attach(program& p) const;
+
+                void bind() const;
+                void bindTextures(int index) const;
+
+                unsigned getId() const                                  { return mTexture; }
+                size_t getNumMaterials() const                          { return mMaterials.size(); }
+                const phong_material& operator[](int index) const       { return mMaterials[index]; }
+        };
+}
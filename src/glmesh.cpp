@@ -2,9 +2,24 @@
 
 namespace al::gl
 {
+        ////////////////////////////////////////////////////////////////////////////////
+        static bounds positionBounds(const std::vector<float>& vertices, const std::vector<vao_info>& infos)
+        {
+                for (const vao_info& info : infos) {
+                        if (info.index != 0 || info.type != GL_FLOAT || info.size < 3)
+                                continue;
+
+                        size_t stride = info.stride ? info.stride / sizeof(float) : info.size;
+                        size_t offset = reinterpret_cast<size_t>(info.offset) / sizeof(float);
+                        return computeBounds(vertices.data(), vertices.size() / stride, stride, offset);
+                }
+                return bounds{};
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         mesh::mesh(std::vector<float>&& vertices, std::vector<unsigned>&& indices, const std::vector<vao_info>& infos)
                 : mInfos{infos},
+                  mBounds{positionBounds(vertices, infos)},
                   mVao(std::move(buffer(GL_ARRAY_BUFFER, std::move(vertices), GL_STATIC_DRAW)),
                        std::move(buffer(GL_ELEMENT_ARRAY_BUFFER, std::move(indices), GL_STATIC_DRAW)),
                        mInfos) {}
@@ -3,6 +3,8 @@
 #include "glbuffer.h"
 #include "glvao.h"
 #include "gltexture2D.h"
+#include "glinstance_buffer.h"
+#include "culling.h"
 #include "error.h"
 
 #include <vector>
@@ -14,8 +16,19 @@ namespace al::gl
         class mesh
         {
                 std::vector<vao_info> mInfos;
+                bounds mBounds;
                 vao<float, unsigned> mVao;
 
+        public:
+                std::vector<texture2D*> mTextures;
+
+                mesh(std::vector<float>&& vertices, std::vector<unsigned>&& indices, const std::vector<vao_info>& infos);
+
+                const vao<float, unsigned>& getVao() const      { return mVao; }
+
+                // of the position attribute (location 0), in model space
+                const bounds& getBounds() const                 { return mBounds; }
+
                 void bindTextures() const
                 {
                         int count = static_cast<int>(mTextures.size());
@@ -42,23 +55,21 @@ namespace al::gl
                         }
                 }
 
-                void unbindTextures() const
+                // bindings are left in place, the state cache skips them on the next draw
+                void draw(int mode = GL_TRIANGLES) const
                 {
-                        for (int i = static_cast<int>(mTextures.size()) - 1; i >= 0; --i)
-                                mTextures[i]->unbind(i);
+                        bindTextures();
+                        mVao.bind();
+                        mVao.draw(mode);
                 }
-        public:
-                std::vector<texture2D*> mTextures;
 
-                mesh(std::vector<float>&& vertices, std::vector<unsigned>&& indices, const std::vector<vao_info>& infos);
-
-                void draw(int mode = GL_TRIANGLES) const
+                // one draw of every instance, needs a program built with shader_features::mInstanced
+                void drawInstanced(const instance_buffer& instances, int mode = GL_TRIANGLES) const
                 {
                         bindTextures();
+                        instances.attach(mVao);
                         mVao.bind();
-                        mVao.draw(mode);
-                        mVao.unbind();
-                        unbindTextures();
+                        mVao.drawInstanced(instances.size(), mode);
                 }
         };
 
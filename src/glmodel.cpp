@@ -12,19 +12,36 @@ namespace al::gl
                 if (!ai_scene || ai_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !ai_scene->mRootNode)
                         throw exception("al::gl", "model", "model", importer.GetErrorString(), etype::unexpected);
 
-                processNode(ai_scene->mRootNode, ai_scene, textureLoader);
+                processNode(ai_scene->mRootNode, ai_scene, textureLoader, NO_PARENT);
+                mGraph.update();
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        void model::processNode(aiNode* ai_node, const aiScene* ai_scene, texture_loader& textureLoader)
+        // assimp matrices are row major
+        static glm::mat4 toMat4(const aiMatrix4x4& m)
         {
+                glm::mat4 r;
+                r[0][0] = m.a1; r[1][0] = m.a2; r[2][0] = m.a3; r[3][0] = m.a4;
+                r[0][1] = m.b1; r[1][1] = m.b2; r[2][1] = m.b3; r[3][1] = m.b4;
+                r[0][2] = m.c1; r[1][2] = m.c2; r[2][2] = m.c3; r[3][2] = m.c4;
+                r[0][3] = m.d1; r[1][3] = m.d2; r[2][3] = m.d3; r[3][3] = m.d4;
+                return r;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // depth first, so every node lands in the graph after its parent
+        void model::processNode(aiNode* ai_node, const aiScene* ai_scene, texture_loader& textureLoader, int parent)
+        {
+                int node = mGraph.add(parent, toMat4(ai_node->mTransformation));
+
                 for (size_t i = 0; i < ai_node->mNumMeshes; ++i) {
                         aiMesh* ai_mesh = ai_scene->mMeshes[ai_node->mMeshes[i]];
                         mMeshes.push_back(processMesh(ai_mesh, ai_scene, textureLoader));
+                        mMeshNodes.push_back(node);
                 }
 
                 for (size_t i = 0; i < ai_node->mNumChildren; ++i)
-                        processNode(ai_node->mChildren[i], ai_scene, textureLoader);
+                        processNode(ai_node->mChildren[i], ai_scene, textureLoader, node);
         }
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -107,4 +124,33 @@ namespace al::gl
                 for (const mesh& m : mMeshes)
                         m.draw(mode);
         }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void model::drawInstanced(program& p, const instance_buffer& instances, int mode) const
+        {
+                if (instances.size() == 0)
+                        return;
+
+                auto uModel = p.handle<glm::mat4>("uModel");
+                for (size_t i = 0; i < mMeshes.size(); ++i) {
+                        p.uniform(uModel, getMeshTransform(i));
+                        mMeshes[i].drawInstanced(instances, mode);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void model::submit(render_queue& queue, program& p, const glm::mat4& transform, float depth, int material, int pass, int mode) const
+        {
+                for (size_t i = 0; i < mMeshes.size(); ++i)
+                        queue.submit(mMeshes[i], p, transform * getMeshTransform(i), depth, material, pass, mode);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void model::submit(render_queue& queue, program& p, const glm::mat4& transform, const std::vector<unsigned char>& visible,
+                           float depth, int material, int pass, int mode) const
+        {
+                for (size_t i = 0; i < mMeshes.size(); ++i)
+                        if (visible[i])
+                                queue.submit(mMeshes[i], p, transform * getMeshTransform(i), depth, material, pass, mode);
+        }
 }
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "glinstance_buffer.h"
 #include "glmesh.h"
+#include "glprogram.h"
+#include "glrender_queue.h"
 #include "gltexture_loader.h"
+#include "scene_graph.h"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -18,15 +22,36 @@ namespace al::gl
                 std::string mPath;
                 std::vector<mesh> mMeshes;
 
-                void processNode(aiNode* ai_node, const aiScene* ai_scene, texture_loader& loader);
+                // node transforms of the file, mMeshNodes[i] is the node of mMeshes[i]
+                scene_graph mGraph;
+                std::vector<int> mMeshNodes;
+
+                void processNode(aiNode* ai_node, const aiScene* ai_scene, texture_loader& loader, int parent);
                 mesh processMesh(aiMesh* ai_mesh, const aiScene* ai_scene, texture_loader& loader);
         public:
                 model(const std::string& path, texture_loader& loader);
 
+                // ignores node transforms, submit() applies them on top of the given transform
                 void draw(int mode = GL_TRIANGLES) const;
+                void submit(render_queue& queue, program& p, const glm::mat4& transform, float depth = 0.0f,
+                            int material = -1, int pass = 0, int mode = GL_TRIANGLES) const;
+
+                // every mesh once for all instances, p must be an instanced permutation in use;
+                // uModel is set to each mesh's node transform, the instances are applied on top
+                void drawInstanced(program& p, const instance_buffer& instances, int mode = GL_TRIANGLES) const;
+
+                // only meshes with a non-zero entry in visible, indexed like getMeshes()
+                void submit(render_queue& queue, program& p, const glm::mat4& transform, const std::vector<unsigned char>& visible,
+                            float depth = 0.0f, int material = -1, int pass = 0, int mode = GL_TRIANGLES) const;
 
                 std::string getPath() const                             { return mPath; }
                 size_t getNumMeshes() const                             { return mMeshes.size(); }
+                const std::vector<mesh>& getMeshes() const              { return mMeshes; }
+
+                // nodes changed through getGraph() are picked up after getGraph().update()
+                scene_graph& getGraph()                                 { return mGraph; }
+                const scene_graph& getGraph() const                     { return mGraph; }
+                const glm::mat4& getMeshTransform(size_t i) const       { return mGraph.getWorld(mMeshNodes[i]); }
         };
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,140 @@
+#include "glocclusion_queries.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // boxes are pushed out a little so the faces of the mesh they bound, already in
+        // the depth buffer, don't hide them
+        static constexpr float BOX_MARGIN               = 1.01f;
+        static constexpr float BOX_MIN_EXTENT           = 1e-3f;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // a box reaching behind the near plane contains the camera or is clipped open,
+        // its faces can't tell whether it's hidden
+        static bool crossesNear(const glm::mat4& projectionView, const glm::vec3& center, const glm::vec3& extents)
+        {
+                for (int c = 0; c < 8; ++c) {
+                        glm::vec3 corner = center + extents * glm::vec3(c & 1 ? 1.0f : -1.0f, c & 2 ? 1.0f : -1.0f, c & 4 ? 1.0f : -1.0f);
+                        glm::vec4 clip = projectionView * glm::vec4(corner, 1.0f);
+                        if (clip.z < -clip.w)
+                                return true;
+                }
+                return false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        occlusion_queries::occlusion_queries(program& boxProgram, size_t count)
+                : mProgram{boxProgram},
+                  mBox{genCube()},
+                  mPVM{boxProgram.handle<glm::mat4>("uPVM")}
+        {
+                resize(count);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        occlusion_queries::~occlusion_queries()
+        {
+                if (!mQueries.empty())
+                        glDeleteQueries(static_cast<int>(mQueries.size()), mQueries.data());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_queries::resize(size_t count)
+        {
+                size_t old = mQueries.size();
+                if (count < old)
+                        glDeleteQueries(static_cast<int>(old - count), mQueries.data() + count);
+
+                mQueries.resize(count, 0);
+                if (count > old)
+                        glGenQueries(static_cast<int>(count - old), mQueries.data() + old);
+
+                mVisible.resize(count, 1);
+                mPending.resize(count, 0);
+                mIssued.resize(count, 0);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_queries::update()
+        {
+                ++mFrame;
+                mStats = {};
+
+                std::uint64_t latency = 0;
+                for (size_t i = 0; i < mQueries.size(); ++i) {
+                        if (!mPending[i])
+                                continue;
+
+                        // results come back in order, but polling each keeps it simple
+                        int available = 0;
+                        glGetQueryObjectiv(mQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+                        if (!available)
+                                continue;
+
+                        unsigned passed = 0;
+                        glGetQueryObjectuiv(mQueries[i], GL_QUERY_RESULT, &passed);
+                        mVisible[i] = passed != 0;
+                        mPending[i] = 0;
+
+                        latency += mFrame - mIssued[i];
+                        ++mStats.mResults;
+                }
+
+                if (mStats.mResults)
+                        mStats.mLatency = static_cast<double>(latency) / mStats.mResults;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_queries::issue(const cull_set& boxes, const std::vector<unsigned char>& candidates, const glm::mat4& projectionView)
+        {
+                if (boxes.size() > mQueries.size())
+                        resize(boxes.size());
+
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                glDepthMask(GL_FALSE);
+                glDepthFunc(GL_LEQUAL);
+
+                mProgram.use();
+                mBox.getVao().bind();
+
+                for (size_t i = 0; i < boxes.size(); ++i) {
+                        if (!candidates[i])
+                                continue;
+
+                        if (!mVisible[i])
+                                ++mStats.mObjectsSkipped;
+                        else if (mPending[i])
+                                ++mStats.mConditionalDraws;
+
+                        // the last query is still in flight, its answer will do
+                        if (mPending[i])
+                                continue;
+
+                        glm::vec3 center = boxes.getCenter(i);
+                        glm::vec3 extents = glm::max(boxes.getExtents(i) * BOX_MARGIN, glm::vec3(BOX_MIN_EXTENT));
+                        if (crossesNear(projectionView, center, extents)) {
+                                mVisible[i] = 1;
+                                continue;
+                        }
+
+                        glm::mat4 pvm = projectionView * glm::scale(glm::translate(glm::mat4(1.0f), center), extents);
+                        mProgram.uniform(mPVM, pvm);
+
+                        glBeginQuery(GL_ANY_SAMPLES_PASSED, mQueries[i]);
+                        mBox.getVao().draw(GL_TRIANGLES);
+                        glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+                        mPending[i] = 1;
+                        mIssued[i] = mFrame;
+                        ++mStats.mQueriesIssued;
+                }
+
+                // no glGet* per frame, the caller's state is the documented one
+                glDepthFunc(GL_LESS);
+                glDepthMask(GL_TRUE);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "culling.h"
+#include "glmesh.h"
+#include "glprogram.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        struct occlusion_stats
+        {
+                size_t mQueriesIssued           = 0;
+                size_t mObjectsSkipped          = 0;    // known hidden, never submitted
+                size_t mConditionalDraws        = 0;    // result still in flight, the GPU decides
+                size_t mResults                 = 0;    // results collected this frame
+                double mLatency                 = 0.0;  // average frames from issue to result
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // GL_ANY_SAMPLES_PASSED queries on the bounding boxes of a cull_set, one per box;
+        // results are read only once available, so a frame acts on what earlier frames
+        // found and the CPU never waits on the GPU
+        class occlusion_queries
+        {
+                program& mProgram;
+                mesh mBox;
+                uniform_handle<glm::mat4> mPVM;
+
+                std::vector<unsigned> mQueries;
+                std::vector<unsigned char> mVisible;
+                std::vector<unsigned char> mPending;
+                std::vector<std::uint64_t> mIssued;
+                std::uint64_t mFrame = 0;
+
+                occlusion_stats mStats;
+        public:
+                // boxProgram draws aPos with uPVM, like shaders/bounds.glsl
+                explicit occlusion_queries(program& boxProgram, size_t count = 0);
+                ~occlusion_queries();
+
+                occlusion_queries(const occlusion_queries&) = delete;
+                occlusion_queries& operator=(const occlusion_queries&) = delete;
+
+                void resize(size_t count);
+                size_t size() const                             { return mQueries.size(); }
+
+                // starts a frame, collects the results that are ready
+                void update();
+
+                // hidden according to the last result, objects never queried are visible
+                bool isVisible(size_t i) const                  { return mVisible[i]; }
+
+                // the query to pass to render_queue::submit, 0 once its result was read
+                unsigned getCondition(size_t i) const           { return mPending[i] ? mQueries[i] : 0; }
+
+                // draws the boxes of the candidates with a query each, after the frame's
+                // occluders are in the depth buffer; boxes still in flight are skipped. Call it
+                // with the state between passes, depth test on with GL_LESS and every write mask
+                // on: it tests with GL_LEQUAL and no writes, then sets exactly that state back
+                void issue(const cull_set& boxes, const std::vector<unsigned char>& candidates, const glm::mat4& projectionView);
+
+                const occlusion_stats& getStats() const         { return mStats; }
+        };
+}
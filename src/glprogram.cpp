@@ -1,4 +1,6 @@
 #include "glprogram.h"
+#include "gluniform_blocks.h"
+#include "glutils.h"
 #include "error.h"
 
 #include <vector>
@@ -16,10 +18,150 @@ namespace al::gl
                         mUniforms.emplace(name, loc);
                         return loc;
                 }
+                else if (u->second == -1)
+                        throw exception("al::gl", "program", "findUniform", "couldn't find " + name, etype::unexpected);
                 else
                         return u->second;
         }
 
+        ////////////////////////////////////////////////////////////////////////////////
+        int program::findOptionalUniform(const std::string& name)
+        {
+                // -1 is silently ignored by glUniform*, for uniforms a permutation compiled out
+                auto u = mUniforms.find(name);
+                if (u == mUniforms.end()) {
+                        int loc = glGetUniformLocation(mId, name.c_str());
+                        mUniforms.emplace(name, loc);
+                        return loc;
+                }
+                return u->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program::reflect()
+        {
+                // relinking resets every uniform to its default value
+                mUniforms.clear();
+                mLocations.clear();
+                mShadows.clear();
+
+                int count = 0, maxLength = 0;
+                glGetProgramiv(mId, GL_ACTIVE_UNIFORMS, &count);
+                glGetProgramiv(mId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+                // the type tells replace() which glUniform* re-sends a shadowed value
+                auto track = [this](int loc, GLenum type) {
+                        if (loc < 0)
+                                return;
+                        if (static_cast<size_t>(loc) >= mShadows.size())
+                                mShadows.resize(loc + 1);
+                        mShadows[loc].type = type;
+                };
+
+                std::vector<char> buffer(maxLength + 1);
+                for (int i = 0; i < count; ++i) {
+                        int length = 0, size = 0;
+                        GLenum type;
+                        glGetActiveUniform(mId, i, maxLength, &length, &size, &type, buffer.data());
+
+                        std::string name(buffer.data(), length);
+                        int loc = glGetUniformLocation(mId, name.c_str());
+                        if (loc == -1)          // members of uniform blocks
+                                continue;
+                        mUniforms.emplace(name, loc);
+                        track(loc, type);
+
+                        // arrays of basic types are reported once, as name[0]
+                        if (name.ends_with("[0]")) {
+                                std::string base = name.substr(0, name.size() - 3);
+                                mUniforms.emplace(base, loc);
+                                for (int j = 1; j < size; ++j) {
+                                        std::string element = base + '[' + std::to_string(j) + ']';
+                                        int elementLoc = glGetUniformLocation(mId, element.c_str());
+                                        mUniforms.emplace(element, elementLoc);
+                                        track(elementLoc, type);
+                                }
+                        }
+                }
+
+                // uniform blocks go to the fixed binding points shared by all programs
+                int numBlocks = 0;
+                glGetProgramiv(mId, GL_ACTIVE_UNIFORM_BLOCKS, &numBlocks);
+                for (int i = 0; i < numBlocks; ++i) {
+                        char blockName[128];
+                        glGetActiveUniformBlockName(mId, i, sizeof(blockName), nullptr, blockName);
+                        int binding = findBlockBinding(blockName);
+                        if (binding != -1)
+                                glUniformBlockBinding(mId, i, binding);
+                }
+
+                // handles outlive relinking, only their locations change
+                for (handle_info& info : mHandleInfos)
+                        resolve(info);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool program::resolve(handle_info& info)
+        {
+                info.offset = static_cast<int>(mLocations.size());
+                info.count = 0;
+
+                auto resolveElement = [this, &info](const std::string& prefix) {
+                        bool found = false;
+                        for (int f = 0; f < info.numFields; ++f) {
+                                int loc = findOptionalUniform(prefix + info.fields[f]);
+                                found |= loc != -1;
+                                mLocations.push_back(loc);
+                        }
+                        return found;
+                };
+
+                if (!info.array) {
+                        info.count = 1;
+                        return resolveElement(info.name);
+                }
+
+                for (;;) {
+                        size_t start = mLocations.size();
+                        if (!resolveElement(info.name + '[' + std::to_string(info.count))) {
+                                mLocations.resize(start);
+                                break;
+                        }
+                        ++info.count;
+                }
+                return info.count > 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int program::findHandle(const std::string& name, const char* const* fields, int numFields, bool array)
+        {
+                auto h = mHandles.find(name);
+                if (h != mHandles.end()) {
+                        if (mHandleInfos[h->second].fields != fields)
+                                throw exception("al::gl", "program", "handle", name + " was resolved as a different type", etype::unexpected);
+                        return h->second;
+                }
+
+                handle_info info{name, fields, numFields, array, 0, 0};
+                if (!resolve(info))
+                        throw exception("al::gl", "program", "handle", "couldn't find " + name, etype::unexpected);
+
+                int index = static_cast<int>(mHandleInfos.size());
+                mHandleInfos.push_back(info);
+                mHandles.emplace(name, index);
+                return index;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool program::isReady() const
+        {
+                if (!utils::hasParallelCompile())
+                        return true;
+                int done;
+                glGetProgramiv(mId, GL_COMPLETION_STATUS_KHR, &done);
+                return done;
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         void program::check()
         {
@@ -30,6 +172,67 @@ namespace al::gl
                         glGetProgramInfoLog(mId, 512, nullptr, infolog);
                         throw exception("al::gl", "program", "check", infolog, etype::unexpected);
                 }
+                reflect();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program::replace(program&& next)
+        {
+                unsigned current = glstate().getProgram();
+                bool wasCurrent = current == mId;
+
+                auto uniforms = std::move(mUniforms);
+                auto shadows = std::move(mShadows);
+
+                glstate().forgetProgram(mId);
+                glDeleteProgram(mId);
+                mId             = next.mId;
+                mShaders        = std::move(next.mShaders);
+                next.mId        = 0;
+
+                reflect();
+
+                glstate().useProgram(mId);
+                restore(uniforms, shadows);
+                glstate().useProgram(wasCurrent ? mId : current);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program::restore(const std::unordered_map<std::string, int>& uniforms, const std::vector<uniform_shadow>& shadows)
+        {
+                for (const auto& [name, oldLoc] : uniforms) {
+                        if (oldLoc < 0 || static_cast<size_t>(oldLoc) >= shadows.size() || shadows[oldLoc].size == 0)
+                                continue;
+
+                        // uniforms that were removed or changed type keep their defaults
+                        auto u = mUniforms.find(name);
+                        if (u == mUniforms.end() || u->second < 0)
+                                continue;
+                        int loc = u->second;
+                        const uniform_shadow& old = shadows[oldLoc];
+                        if (static_cast<size_t>(loc) >= mShadows.size() || mShadows[loc].type != old.type || mShadows[loc].size != 0)
+                                continue;
+
+                        const float* f = reinterpret_cast<const float*>(old.data);
+                        const int* i = reinterpret_cast<const int*>(old.data);
+                        switch (old.type) {
+                                case GL_FLOAT:          glUniform1fv(loc, 1, f); break;
+                                case GL_FLOAT_VEC2:     glUniform2fv(loc, 1, f); break;
+                                case GL_FLOAT_VEC3:     glUniform3fv(loc, 1, f); break;
+                                case GL_FLOAT_VEC4:     glUniform4fv(loc, 1, f); break;
+                                case GL_FLOAT_MAT2:     glUniformMatrix2fv(loc, 1, GL_FALSE, f); break;
+                                case GL_FLOAT_MAT3:     glUniformMatrix3fv(loc, 1, GL_FALSE, f); break;
+                                case GL_FLOAT_MAT4:     glUniformMatrix4fv(loc, 1, GL_FALSE, f); break;
+                                case GL_INT_VEC2:
+                                case GL_BOOL_VEC2:      glUniform2iv(loc, 1, i); break;
+                                case GL_INT_VEC3:
+                                case GL_BOOL_VEC3:      glUniform3iv(loc, 1, i); break;
+                                case GL_INT_VEC4:
+                                case GL_BOOL_VEC4:      glUniform4iv(loc, 1, i); break;
+                                default:                glUniform1iv(loc, 1, i); break;         // int, bool and samplers
+                        }
+                        mShadows[loc] = old;
+                }
         }
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -41,9 +244,32 @@ namespace al::gl
                                 throw exception("al::gl", "program", "load", "one of the provided shaders is nullptr", etype::unexpected);
                         glAttachShader(mId, s->getId());
                 }
+                if (utils::hasProgramBinary())
+                        glProgramParameteri(mId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
                 glLinkProgram(mId);
         }
 
+        ////////////////////////////////////////////////////////////////////////////////
+        void program::loadBinary(int format, const std::vector<char>& binary)
+        {
+                mId = glCreateProgram();
+                glProgramBinary(mId, format, binary.data(), static_cast<int>(binary.size()));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program::clone(const program& other)
+        {
+                // programs created from a binary have no shaders to relink
+                if (mShaders.empty()) {
+                        int format;
+                        std::vector<char> binary = other.getBinary(format);
+                        loadBinary(format, binary);
+                }
+                else
+                        load();
+                check();
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         program::program(std::initializer_list<shader*> shaders)
         {
@@ -53,31 +279,62 @@ namespace al::gl
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        program::program(const program& other)
-                : mShaders{other.mShaders}, mUniforms{other.mUniforms}
+        program::program(const std::vector<shader*>& shaders, bool wait)
+                : mShaders{shaders}
         {
                 load();
-                check();
+                if (wait)
+                        check();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        program::program(int format, const std::vector<char>& binary)
+        {
+                if (!utils::hasProgramBinary())
+                        throw exception("al::gl", "program", "program", "program binaries are not supported", etype::expected);
+
+                loadBinary(format, binary);
+
+                int success;
+                glGetProgramiv(mId, GL_LINK_STATUS, &success);
+                if (!success) {
+                        glstate().forgetProgram(mId);
+                        glDeleteProgram(mId);
+                        throw exception("al::gl", "program", "program", "program binary was rejected by the driver", etype::expected);
+                }
+                reflect();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        program::program(const program& other)
+                : mShaders{other.mShaders}, mUniforms{other.mUniforms},
+                  mHandleInfos{other.mHandleInfos}, mHandles{other.mHandles}
+        {
+                clone(other);
         }
 
         ////////////////////////////////////////////////////////////////////////////////
         program& program::operator=(const program& other)
         {
                 if (this != &other) {
+                        glstate().forgetProgram(mId);
                         glDeleteProgram(mId);
 
                         mShaders        = other.mShaders;
                         mUniforms       = other.mUniforms;
+                        mHandleInfos    = other.mHandleInfos;
+                        mHandles        = other.mHandles;
 
-                        load();
-                        check();
+                        clone(other);
                 }
                 return *this;
         }
 
         ////////////////////////////////////////////////////////////////////////////////
         program::program(program&& other)
-                : mId{other.mId}, mShaders{std::move(other.mShaders)}, mUniforms{std::move(other.mUniforms)}
+                : mId{other.mId}, mShaders{std::move(other.mShaders)}, mUniforms{std::move(other.mUniforms)},
+                  mLocations{std::move(other.mLocations)}, mHandleInfos{std::move(other.mHandleInfos)}, mHandles{std::move(other.mHandles)},
+                  mShadows{std::move(other.mShadows)}, mIssuedUniforms{other.mIssuedUniforms}, mSkippedUniforms{other.mSkippedUniforms}
         {
                 other.mId = 0;
         }
@@ -86,11 +343,19 @@ namespace al::gl
         program& program::operator=(program&& other)
         {
                 if (this != &other) {
+                        glstate().forgetProgram(mId);
                         glDeleteProgram(mId);
 
                         mId             = other.mId;
                         mShaders        = std::move(other.mShaders);
                         mUniforms       = std::move(other.mUniforms);
+                        mLocations      = std::move(other.mLocations);
+                        mHandleInfos    = std::move(other.mHandleInfos);
+                        mHandles        = std::move(other.mHandles);
+
+                        mShadows                = std::move(other.mShadows);
+                        mIssuedUniforms         = other.mIssuedUniforms;
+                        mSkippedUniforms        = other.mSkippedUniforms;
 
                         other.mId       = 0;
                 }
@@ -98,90 +363,121 @@ namespace al::gl
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        void program::uniform(const std::string& name, const basic_material& material)
+        std::vector<char> program::getBinary(int& format) const
+        {
+                int length = 0;
+                glGetProgramiv(mId, GL_PROGRAM_BINARY_LENGTH, &length);
+                std::vector<char> binary(length);
+
+                GLenum binaryFormat = 0;
+                glGetProgramBinary(mId, length, nullptr, &binaryFormat, binary.data());
+                format = static_cast<int>(binaryFormat);
+                return binary;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        const int* program::locations(int index, size_t count) const
+        {
+                const handle_info& info = mHandleInfos[index];
+                if (count > static_cast<size_t>(info.count))
+                        throw exception("al::gl", "program", "uniform", info.name + " has only " + std::to_string(info.count) + " elements", etype::unexpected);
+                return &mLocations[info.offset];
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program::uniform(uniform_handle<basic_material> h, const basic_material& material)
         {
-                glUniform3fv(findUniform(name + ".color"), 1, glm::value_ptr(material.mColor));
-                glUniform1i(findUniform(name + ".materialTexture"), 0);
-                glUniform1i(findUniform(name + ".enableTexture"), material.mEnableTexture);
+                if (!h.isValid())
+                        return;
+                const int* loc = locations(h.mIndex, 1);
+                set(loc[0], material.mColor);
+                set(loc[1], 0);
+                set(loc[2], static_cast<int>(material.mEnableTexture));
                 if (material.mEnableTexture && material.mBasicTexture)
                         material.mBasicTexture->bind();
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        void program::uniform(const std::string& name, const phong_material& material)
+        void program::uniform(uniform_handle<phong_material> h, const phong_material& material)
         {
-                glUniform3fv(findUniform(name + ".ambientColor"), 1, glm::value_ptr(material.mAmbient));
-                glUniform3fv(findUniform(name + ".diffuseColor"), 1, glm::value_ptr(material.mDiffuse));
-                glUniform3fv(findUniform(name + ".specularColor"), 1, glm::value_ptr(material.mSpecular));
-                glUniform1f(findUniform(name + ".shininess"), material.mShininess);
+                if (!h.isValid())
+                        return;
+                const int* loc = locations(h.mIndex, 1);
+                set(loc[0], material.mAmbient);
+                set(loc[1], material.mDiffuse);
+                set(loc[2], material.mSpecular);
+                set(loc[3], material.mShininess);
 
-                glUniform1i(findUniform(name + ".ambientTexture"), 0);
-                glUniform1i(findUniform(name + ".enableAmbientTexture"), material.mEnableAmbientTexture);
+                set(loc[4], 0);
+                set(loc[5], static_cast<int>(material.mEnableAmbientTexture));
                 if (material.mEnableAmbientTexture && material.mAmbientTexture)
                         material.mAmbientTexture->bind(0);
 
-                glUniform1i(findUniform(name + ".diffuseTexture"), 1);
-                glUniform1i(findUniform(name + ".enableDiffuseTexture"), material.mEnableDiffuseTexture);
+                set(loc[6], 1);
+                set(loc[7], static_cast<int>(material.mEnableDiffuseTexture));
                 if (material.mEnableDiffuseTexture && material.mDiffuseTexture)
                         material.mDiffuseTexture->bind(1);
 
-                glUniform1i(findUniform(name + ".specularTexture"), 2);
-                glUniform1i(findUniform(name + ".enableSpecularTexture"), material.mEnableSpecularTexture);
+                set(loc[8], 2);
+                set(loc[9], static_cast<int>(material.mEnableSpecularTexture));
                 if (material.mEnableSpecularTexture && material.mSpecularTexture)
                         material.mSpecularTexture->bind(2);
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        void program::uniform(const std::string& name, const std::vector<dir_light>& lights)
+        void program::uniform(uniform_handle<std::vector<dir_light>> h, const std::vector<dir_light>& lights)
         {
-                int i = 0;
+                if (!h.isValid())
+                        return;
+                const int* loc = locations(h.mIndex, lights.size());
                 for (const auto& light : lights) {
-                        std::string s = name + "[" + std::to_string(i);
-                        glUniform3fv(findUniform(s + "].ambient"),   1, glm::value_ptr(light.mAmbient));
-                        glUniform3fv(findUniform(s + "].diffuse"),   1, glm::value_ptr(light.mDiffuse));
-                        glUniform3fv(findUniform(s + "].specular"),  1, glm::value_ptr(light.mSpecular));
-                        glUniform3fv(findUniform(s + "].direction"), 1, glm::value_ptr(light.mDirection));
-                        glUniform1f(findUniform(s + "].intensity"),  light.mIntensity);
-                        ++i;
+                        set(loc[0], light.mAmbient);
+                        set(loc[1], light.mDiffuse);
+                        set(loc[2], light.mSpecular);
+                        set(loc[3], light.mDirection);
+                        set(loc[4], light.mIntensity);
+                        loc += std::size(uniform_traits<std::vector<dir_light>>::fields);
                 }
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        void program::uniform(const std::string& name, const std::vector<point_light>& lights)
+        void program::uniform(uniform_handle<std::vector<point_light>> h, const std::vector<point_light>& lights)
         {
-                int i = 0;
+                if (!h.isValid())
+                        return;
+                const int* loc = locations(h.mIndex, lights.size());
                 for (const auto& light : lights) {
-                        std::string s = name + "[" + std::to_string(i);
-                        glUniform3fv(findUniform(s + "].diffuse"),  1, glm::value_ptr(light.mDiffuse));
-                        glUniform3fv(findUniform(s + "].specular"), 1, glm::value_ptr(light.mSpecular));
-                        glUniform3fv(findUniform(s + "].position"), 1, glm::value_ptr(light.mPosition));
-                        glUniform1f(findUniform(s + "].range"),     light.mRange);
-                        glUniform1f(findUniform(s + "].intensity"), light.mIntensity);
-                        glUniform1f(findUniform(s + "].constant"),  light.mConstant);
-                        glUniform1f(findUniform(s + "].linear"),    light.mLinear);
-                        glUniform1f(findUniform(s + "].quadratic"), light.mQuadratic);
-                        ++i;
+                        set(loc[0], light.mDiffuse);
+                        set(loc[1], light.mSpecular);
+                        set(loc[2], light.mPosition);
+                        set(loc[3], light.mRange);
+                        set(loc[4], light.mIntensity);
+                        set(loc[5], light.mConstant);
+                        set(loc[6], light.mLinear);
+                        set(loc[7], light.mQuadratic);
+                        loc += std::size(uniform_traits<std::vector<point_light>>::fields);
                 }
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        void program::uniform(const std::string& name, const std::vector<spot_light>& lights)
+        void program::uniform(uniform_handle<std::vector<spot_light>> h, const std::vector<spot_light>& lights)
         {
-                int i = 0;
+                if (!h.isValid())
+                        return;
+                const int* loc = locations(h.mIndex, lights.size());
                 for (const auto& light : lights) {
-                        std::string s = name + "[" + std::to_string(i);
-                        glUniform3fv(findUniform(s + "].diffuse"),   1, glm::value_ptr(light.mDiffuse));
-                        glUniform3fv(findUniform(s + "].specular"),  1, glm::value_ptr(light.mSpecular));
-                        glUniform3fv(findUniform(s + "].position"),  1, glm::value_ptr(light.mPosition));
-                        glUniform3fv(findUniform(s + "].direction"), 1, glm::value_ptr(light.mDirection));
-                        glUniform1f(findUniform(s + "].range"),      light.mRange);
-                        glUniform1f(findUniform(s + "].intensity"),  light.mIntensity);
-                        glUniform1f(findUniform(s + "].cutoff"),     light.mCutoff);
-                        glUniform1f(findUniform(s + "].outerCutoff"),light.mOuterCutoff);
-                        glUniform1f(findUniform(s + "].constant"),   light.mConstant);
-                        glUniform1f(findUniform(s + "].linear"),     light.mLinear);
-                        glUniform1f(findUniform(s + "].quadratic"),  light.mQuadratic);
-                        ++i;
+                        set(loc[0], light.mDiffuse);
+                        set(loc[1], light.mSpecular);
+                        set(loc[2], light.mPosition);
+                        set(loc[3], light.mDirection);
+                        set(loc[4], light.mRange);
+                        set(loc[5], light.mIntensity);
+                        set(loc[6], light.mCutoff);
+                        set(loc[7], light.mOuterCutoff);
+                        set(loc[8], light.mConstant);
+                        set(loc[9], light.mLinear);
+                        set(loc[10], light.mQuadratic);
+                        loc += std::size(uniform_traits<std::vector<spot_light>>::fields);
                 }
         }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "glshader.h"
+#include "glstate.h"
 #include "lights.h"
 #include "glmaterial.h"
 
@@ -13,27 +14,156 @@
 #include <glm/vec4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstring>
 #include <initializer_list>
+#include <iterator>
 #include <vector>
 #include <unordered_map>
 #include <string>
 
 namespace al::gl
 {
+        ////////////////////////////////////////////////////////////////////////////////
+        // names of the uniforms a C++ type is uploaded to, relative to the uniform's name
+        template <typename T>
+        struct uniform_traits
+        {
+                static constexpr const char* fields[] = { "" };
+                static constexpr bool array = false;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <>
+        struct uniform_traits<basic_material>
+        {
+                static constexpr const char* fields[] = { ".color", ".materialTexture", ".enableTexture" };
+                static constexpr bool array = false;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <>
+        struct uniform_traits<phong_material>
+        {
+                static constexpr const char* fields[] = { ".ambientColor", ".diffuseColor", ".specularColor", ".shininess",
+                                                          ".ambientTexture", ".enableAmbientTexture",
+                                                          ".diffuseTexture", ".enableDiffuseTexture",
+                                                          ".specularTexture", ".enableSpecularTexture" };
+                static constexpr bool array = false;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <>
+        struct uniform_traits<std::vector<dir_light>>
+        {
+                static constexpr const char* fields[] = { "].ambient", "].diffuse", "].specular", "].direction", "].intensity" };
+                static constexpr bool array = true;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <>
+        struct uniform_traits<std::vector<point_light>>
+        {
+                static constexpr const char* fields[] = { "].diffuse", "].specular", "].position", "].range", "].intensity",
+                                                          "].constant", "].linear", "].quadratic" };
+                static constexpr bool array = true;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <>
+        struct uniform_traits<std::vector<spot_light>>
+        {
+                static constexpr const char* fields[] = { "].diffuse", "].specular", "].position", "].direction", "].range", "].intensity",
+                                                          "].cutoff", "].outerCutoff", "].constant", "].linear", "].quadratic" };
+                static constexpr bool array = true;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // resolved once per program, updates through it are plain array reads
+        template <typename T>
+        class uniform_handle
+        {
+                friend class program;
+                int mIndex = -1;
+
+                explicit uniform_handle(int index) : mIndex{index} {}
+        public:
+                uniform_handle() = default;
+
+                bool isValid() const            { return mIndex >= 0; }
+        };
+
         ////////////////////////////////////////////////////////////////////////////////
         class program
         {
+                struct handle_info
+                {
+                        std::string name;
+                        const char* const* fields;
+                        int numFields;
+                        bool array;
+                        int count;
+                        int offset;
+                };
+
                 unsigned mId;
                 std::vector<shader*> mShaders;
                 std::unordered_map<std::string, int> mUniforms;
 
+                // last value sent to each location, size 0 until the first upload
+                struct uniform_shadow
+                {
+                        alignas(16) unsigned char data[sizeof(glm::mat4)];
+                        unsigned char size = 0;
+                        unsigned type = 0;
+                };
+
+                // handles index mHandleInfos, which point into the flat location table
+                std::vector<int> mLocations;
+                std::vector<handle_info> mHandleInfos;
+                std::unordered_map<std::string, int> mHandles;
+
+                std::vector<uniform_shadow> mShadows;
+                size_t mIssuedUniforms = 0;
+                size_t mSkippedUniforms = 0;
+
                 void load();
-                void check();
+                void loadBinary(int format, const std::vector<char>& binary);
+                void clone(const program& other);
+                void reflect();
+                bool resolve(handle_info& info);
+                void restore(const std::unordered_map<std::string, int>& uniforms, const std::vector<uniform_shadow>& shadows);
+                int findHandle(const std::string& name, const char* const* fields, int numFields, bool array);
                 int findUniform(const std::string& name);
+                int findOptionalUniform(const std::string& name);
+
+                const int* locations(int index, size_t count) const;
+
+                // -1 for a default-constructed handle, set() then skips it like a compiled out uniform
+                int location(int index) const   { return index < 0 ? -1 : mLocations[mHandleInfos[index].offset]; }
+
+                template <typename T>
+                bool changed(int loc, const T& value);
+
+                void set(int loc, float x)                      { if (changed(loc, x)) glUniform1f(loc, x); }
+                void set(int loc, int x)                        { if (changed(loc, x)) glUniform1i(loc, x); }
+
+                void set(int loc, const glm::vec2& v)           { if (changed(loc, v)) glUniform2fv(loc, 1, glm::value_ptr(v)); }
+                void set(int loc, const glm::vec3& v)           { if (changed(loc, v)) glUniform3fv(loc, 1, glm::value_ptr(v)); }
+                void set(int loc, const glm::vec4& v)           { if (changed(loc, v)) glUniform4fv(loc, 1, glm::value_ptr(v)); }
+
+                void set(int loc, const glm::ivec2& v)          { if (changed(loc, v)) glUniform2iv(loc, 1, glm::value_ptr(v)); }
+                void set(int loc, const glm::ivec3& v)          { if (changed(loc, v)) glUniform3iv(loc, 1, glm::value_ptr(v)); }
+                void set(int loc, const glm::ivec4& v)          { if (changed(loc, v)) glUniform4iv(loc, 1, glm::value_ptr(v)); }
+
+                void set(int loc, const glm::mat2& m)           { if (changed(loc, m)) glUniformMatrix2fv(loc, 1, GL_FALSE, glm::value_ptr(m)); }
+                void set(int loc, const glm::mat3& m)           { if (changed(loc, m)) glUniformMatrix3fv(loc, 1, GL_FALSE, glm::value_ptr(m)); }
+                void set(int loc, const glm::mat4& m)           { if (changed(loc, m)) glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(m)); }
         public:
                 explicit program(std::initializer_list<shader*> shaders);
+                explicit program(const std::vector<shader*>& shaders, bool wait = true);
+                program(int format, const std::vector<char>& binary);
 
-                ~program()                      { glDeleteProgram(mId); }
+                ~program()                      { glstate().forgetProgram(mId); glDeleteProgram(mId); }
 
                 program(const program&);
                 program& operator=(const program&);
@@ -42,40 +172,103 @@ namespace al::gl
                 program& operator=(program&&);
 
                 unsigned getId() const          { return mId; }
+                std::vector<char> getBinary(int& format) const;
+
+                bool isReady() const;
+                void check();
+
+                // takes over a linked program, handles stay valid and uniform values carry over
+                void replace(program&& next);
 
-                void use() const                { glUseProgram(mId); }
-                void halt() const               { glUseProgram(0); }
+                bool hasUniform(const std::string& name)        { return findOptionalUniform(name) != -1; }
 
-                void uniform(const std::string& name, float x)                                  { glUniform1f(findUniform(name), x); }
-                void uniform(const std::string& name, float x, float y)                         { glUniform2f(findUniform(name), x, y); }
-                void uniform(const std::string& name, float x, float y, float z)                { glUniform3f(findUniform(name), x, y, z); }
-                void uniform(const std::string& name, float x, float y, float z, float w)       { glUniform4f(findUniform(name), x, y, z, w); }
+                void use() const                { glstate().useProgram(mId); }
+                void halt() const               { glstate().useProgram(0); }
 
-                void uniform(const std::string& name, int x)                                    { glUniform1i(findUniform(name), x); }
-                void uniform(const std::string& name, int x, int y)                             { glUniform2i(findUniform(name), x, y); }
-                void uniform(const std::string& name, int x, int y, int z)                      { glUniform3i(findUniform(name), x, y, z); }
-                void uniform(const std::string& name, int x, int y, int z, int w)               { glUniform4i(findUniform(name), x, y, z, w); }
+                // uploads of a value identical to the last one are skipped, values set
+                // through raw glUniform* calls on getId() bypass the shadow copies
+                size_t getIssuedUniforms() const        { return mIssuedUniforms; }
+                size_t getSkippedUniforms() const       { return mSkippedUniforms; }
+                void resetUniformCounters()             { mIssuedUniforms = mSkippedUniforms = 0; }
 
-                void uniform(const std::string& name, const glm::vec2& v)                       { glUniform2fv(findUniform(name), 1, glm::value_ptr(v)); }
-                void uniform(const std::string& name, const glm::vec3& v)                       { glUniform3fv(findUniform(name), 1, glm::value_ptr(v)); }
-                void uniform(const std::string& name, const glm::vec4& v)                       { glUniform4fv(findUniform(name), 1, glm::value_ptr(v)); }
+                template <typename T>
+                uniform_handle<T> handle(const std::string& name)
+                {
+                        using traits = uniform_traits<T>;
+                        return uniform_handle<T>(findHandle(name, traits::fields, static_cast<int>(std::size(traits::fields)), traits::array));
+                }
 
-                void uniform(const std::string& name, const glm::mat2& m)                       { glUniformMatrix2fv(findUniform(name), 1, GL_FALSE, glm::value_ptr(m)); }
-                void uniform(const std::string& name, const glm::mat3& m)                       { glUniformMatrix3fv(findUniform(name), 1, GL_FALSE, glm::value_ptr(m)); }
-                void uniform(const std::string& name, const glm::mat4& m)                       { glUniformMatrix4fv(findUniform(name), 1, GL_FALSE, glm::value_ptr(m)); }
+                void uniform(const std::string& name, float x)                                  { set(findUniform(name), x); }
+                void uniform(const std::string& name, float x, float y)                         { set(findUniform(name), glm::vec2(x, y)); }
+                void uniform(const std::string& name, float x, float y, float z)                { set(findUniform(name), glm::vec3(x, y, z)); }
+                void uniform(const std::string& name, float x, float y, float z, float w)       { set(findUniform(name), glm::vec4(x, y, z, w)); }
 
-                void uniform(const std::string& name, const basic_material&);
-                void uniform(const std::string& name, const phong_material&);
+                void uniform(const std::string& name, int x)                                    { set(findUniform(name), x); }
+                void uniform(const std::string& name, int x, int y)                             { set(findUniform(name), glm::ivec2(x, y)); }
+                void uniform(const std::string& name, int x, int y, int z)                      { set(findUniform(name), glm::ivec3(x, y, z)); }
+                void uniform(const std::string& name, int x, int y, int z, int w)               { set(findUniform(name), glm::ivec4(x, y, z, w)); }
 
-                void uniform(const std::string& name, const std::vector<dir_light>&);
-                void uniform(const std::string& name, const std::vector<point_light>&);
-                void uniform(const std::string& name, const std::vector<spot_light>&);
+                void uniform(const std::string& name, const glm::vec2& v)                       { set(findUniform(name), v); }
+                void uniform(const std::string& name, const glm::vec3& v)                       { set(findUniform(name), v); }
+                void uniform(const std::string& name, const glm::vec4& v)                       { set(findUniform(name), v); }
+
+                void uniform(const std::string& name, const glm::mat2& m)                       { set(findUniform(name), m); }
+                void uniform(const std::string& name, const glm::mat3& m)                       { set(findUniform(name), m); }
+                void uniform(const std::string& name, const glm::mat4& m)                       { set(findUniform(name), m); }
+
+                void uniform(const std::string& name, const basic_material& m)                  { uniform(handle<basic_material>(name), m); }
+                void uniform(const std::string& name, const phong_material& m)                  { uniform(handle<phong_material>(name), m); }
+
+                void uniform(const std::string& name, const std::vector<dir_light>& l)          { uniform(handle<std::vector<dir_light>>(name), l); }
+                void uniform(const std::string& name, const std::vector<point_light>& l)        { uniform(handle<std::vector<point_light>>(name), l); }
+                void uniform(const std::string& name, const std::vector<spot_light>& l)         { uniform(handle<std::vector<spot_light>>(name), l); }
+
+                void uniform(uniform_handle<float> h, float x)                                  { set(location(h.mIndex), x); }
+                void uniform(uniform_handle<int> h, int x)                                      { set(location(h.mIndex), x); }
+
+                void uniform(uniform_handle<glm::vec2> h, const glm::vec2& v)                   { set(location(h.mIndex), v); }
+                void uniform(uniform_handle<glm::vec3> h, const glm::vec3& v)                   { set(location(h.mIndex), v); }
+                void uniform(uniform_handle<glm::vec4> h, const glm::vec4& v)                   { set(location(h.mIndex), v); }
+
+                void uniform(uniform_handle<glm::mat2> h, const glm::mat2& m)                   { set(location(h.mIndex), m); }
+                void uniform(uniform_handle<glm::mat3> h, const glm::mat3& m)                   { set(location(h.mIndex), m); }
+                void uniform(uniform_handle<glm::mat4> h, const glm::mat4& m)                   { set(location(h.mIndex), m); }
+
+                void uniform(uniform_handle<basic_material> h, const basic_material&);
+                void uniform(uniform_handle<phong_material> h, const phong_material&);
+
+                void uniform(uniform_handle<std::vector<dir_light>> h, const std::vector<dir_light>&);
+                void uniform(uniform_handle<std::vector<point_light>> h, const std::vector<point_light>&);
+                void uniform(uniform_handle<std::vector<spot_light>> h, const std::vector<spot_light>&);
         };
 
+        ////////////////////////////////////////////////////////////////////////////////
+        template <typename T>
+        bool program::changed(int loc, const T& value)
+        {
+                static_assert(sizeof(T) <= sizeof(uniform_shadow::data));
+
+                // -1 is a uniform the permutation compiled out, glUniform* would ignore it
+                if (loc < 0)
+                        return false;
+                if (static_cast<size_t>(loc) >= mShadows.size())
+                        mShadows.resize(loc + 1);
+
+                uniform_shadow& shadow = mShadows[loc];
+                if (shadow.size == sizeof(T) && std::memcmp(shadow.data, &value, sizeof(T)) == 0) {
+                        ++mSkippedUniforms;
+                        return false;
+                }
+
+                std::memcpy(shadow.data, &value, sizeof(T));
+                shadow.size = sizeof(T);
+                ++mIssuedUniforms;
+                return true;
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         inline bool operator==(const program& first, const program& second) { return first.getId() == second.getId(); }
 
         ////////////////////////////////////////////////////////////////////////////////
         inline bool operator!=(const program& first, const program& second) { return first.getId() != second.getId(); }
 }
-
@@ -0,0 +1,130 @@
+#include "glprogram_cache.h"
+#include "glutils.h"
+#include "error.h"
+#include "hash.h"
+#include "log.h"
+#include "io.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <filesystem>
+#include <sstream>
+#include <iomanip>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        program_cache::program_cache(const std::string& directory)
+                : mDirectory{directory}
+        {
+                auto glString = [](int name) {
+                        const GLubyte* s = glGetString(name);
+                        return s ? std::string(reinterpret_cast<const char*>(s)) : std::string();
+                };
+                mDriver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+
+                int numFormats = 0;
+                if (utils::hasProgramBinary())
+                        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+                mEnabled = numFormats > 0;
+
+                if (!mEnabled)
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::program_cache] Program binaries are not supported, caching is disabled");
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std::string program_cache::genPath(const std::vector<std::string>& sources) const
+        {
+                std::uint64_t key = hash(mDriver);
+                for (const std::string& source : sources)
+                        key = hash(source, key);
+
+                std::ostringstream ss;
+                ss << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+                return (std::filesystem::path(mDirectory) / ss.str()).string();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std::optional<program> program_cache::find(const std::vector<std::string>& sources) const
+        {
+                if (!mEnabled)
+                        return std::nullopt;
+
+                std::string path = genPath(sources);
+                if (!std::filesystem::exists(path))
+                        return std::nullopt;
+
+                // layout: binary format followed by the binary itself
+                std::vector<char> data = readBinary(path);
+                if (data.size() <= sizeof(int))
+                        return std::nullopt;
+
+                int format;
+                std::memcpy(&format, data.data(), sizeof(int));
+                std::vector<char> binary(data.begin() + sizeof(int), data.end());
+
+                try {
+                        std::optional<program> cached;
+                        cached.emplace(format, binary);
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::program_cache] Loaded ", path);
+                        return cached;
+                }
+                catch (const exception& e) {
+                        if (e.getType() != etype::expected)
+                                throw;
+                        // driver update or different GPU, recompile and overwrite
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::program_cache] Rejected ", path);
+                        std::error_code ec;
+                        std::filesystem::remove(path, ec);
+                        return std::nullopt;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program_cache::store(const program& p, const std::vector<std::string>& sources) const
+        {
+                if (!mEnabled)
+                        return;
+
+                int format;
+                std::vector<char> binary = p.getBinary(format);
+                if (binary.empty())
+                        return;
+
+                std::vector<char> data(sizeof(int));
+                std::memcpy(data.data(), &format, sizeof(int));
+                data.insert(data.end(), binary.begin(), binary.end());
+
+                std::string path = genPath(sources);
+                std::error_code ec;
+                std::filesystem::create_directories(mDirectory, ec);
+                try {
+                        writeBinary(path, data);
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::program_cache] Stored ", path, " [", data.size(), " bytes]");
+                }
+                catch (const exception& e) {
+                        // a read-only cache directory only costs us startup time
+                        log(std::cerr, __FILE__, __LINE__, "[Lovelace] [al::gl::program_cache] ", e.getMessage());
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        program program_cache::load(shader_loader& loader, std::initializer_list<shader_stage> stages, const shader_features& features) const
+        {
+                std::vector<std::string> sources;
+                for (const shader_stage& stage : stages)
+                        sources.push_back(loader.preprocess(stage.type, stage.url, features));
+
+                if (std::optional<program> cached = find(sources))
+                        return std::move(*cached);
+
+                std::vector<shader*> shaders;
+                for (const shader_stage& stage : stages)
+                        shaders.push_back(loader.load(stage.type, stage.url, features));
+
+                program p(shaders);
+                store(p, sources);
+                return p;
+        }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "glprogram.h"
+#include "glshader_loader.h"
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        struct shader_stage
+        {
+                int type;
+                std::string url;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        class program_cache
+        {
+                std::string mDirectory;
+                std::string mDriver;
+                bool mEnabled = false;
+
+                std::string genPath(const std::vector<std::string>& sources) const;
+        public:
+                explicit program_cache(const std::string& directory);
+
+                bool isEnabled() const                          { return mEnabled; }
+                std::string getDirectory() const                { return mDirectory; }
+                std::string getDriver() const                   { return mDriver; }
+
+                std::optional<program> find(const std::vector<std::string>& sources) const;
+                void store(const program& p, const std::vector<std::string>& sources) const;
+
+                program load(shader_loader& loader, std::initializer_list<shader_stage> stages, const shader_features& features = {}) const;
+        };
+}
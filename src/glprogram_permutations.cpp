@@ -0,0 +1,203 @@
+#include "glprogram_permutations.h"
+#include "glutils.h"
+#include "error.h"
+#include "log.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <optional>
+#include <unordered_set>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        static constexpr int STAGES[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        program_permutations::program_permutations(shader_loader& loader, const std::string& url, const program_cache* cache)
+                : mLoader{&loader}, mCache{cache}, mUrl{url}
+        {
+                // let the driver pick as many compiler threads as it likes
+                if (GLAD_GL_KHR_parallel_shader_compile)
+                        glMaxShaderCompilerThreadsKHR(0xffffffff);
+                else if (GLAD_GL_ARB_parallel_shader_compile)
+                        glMaxShaderCompilerThreadsARB(0xffffffff);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program_permutations::compile(const std::vector<shader_features>& permutations)
+        {
+                struct pending_program
+                {
+                        std::uint64_t key;
+                        std::vector<std::string> sources;
+                        std::vector<shader*> shaders;
+                };
+
+                std::vector<pending_program> pending;
+                std::unordered_set<std::uint64_t> seen;
+
+                // dispatch every compile before waiting on any of them
+                for (const shader_features& features : permutations) {
+                        std::uint64_t key = features.key();
+                        if (mPrograms.count(key) || !seen.insert(key).second)
+                                continue;
+                        mFeatures.emplace(key, features);
+
+                        std::vector<std::string> sources {
+                                mLoader->preprocess(GL_VERTEX_SHADER, mUrl, features),
+                                mLoader->preprocess(GL_FRAGMENT_SHADER, mUrl, features)
+                        };
+
+                        if (mCache) {
+                                if (std::optional<program> cached = mCache->find(sources)) {
+                                        mPrograms.emplace(key, std::move(*cached));
+                                        continue;
+                                }
+                        }
+
+                        std::vector<shader*> shaders {
+                                mLoader->load(GL_VERTEX_SHADER, mUrl, features, false),
+                                mLoader->load(GL_FRAGMENT_SHADER, mUrl, features, false)
+                        };
+                        pending.push_back({key, std::move(sources), std::move(shaders)});
+                }
+
+                std::vector<program> linking;
+                linking.reserve(pending.size());
+                for (const pending_program& p : pending)
+                        linking.emplace_back(p.shaders, false);
+
+                // with GL_KHR_parallel_shader_compile the checks below overlap on driver threads
+                for (size_t i = 0; i < pending.size(); ++i) {
+                        for (shader* s : pending[i].shaders)
+                                s->check();
+                        linking[i].check();
+
+                        if (mCache)
+                                mCache->store(linking[i], pending[i].sources);
+                        mPrograms.emplace(pending[i].key, std::move(linking[i]));
+                }
+
+                if (!pending.empty())
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::program_permutations] Compiled ", pending.size(), " permutations of ", mUrl,
+                                                           utils::hasParallelCompile() ? " in parallel" : "");
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        program* program_permutations::get(const shader_features& features)
+        {
+                std::uint64_t key = features.key();
+                auto p = mPrograms.find(key);
+                if (p == mPrograms.end()) {
+                        compile({features});
+                        return &mPrograms.at(key);
+                }
+                return &p->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void program_permutations::reload()
+        {
+                // a reload already in flight is superseded by the newer source
+                mReloads.clear();
+
+                // reserved, growing would copy shaders and programs, which recompiles them
+                mReloads.reserve(mFeatures.size());
+                for (const auto& [key, features] : mFeatures) {
+                        pending_reload r{key, {}, {}, std::nullopt, false};
+                        try {
+                                for (int type : STAGES)
+                                        r.sources.push_back(mLoader->preprocess(type, mUrl, features));
+                        }
+                        catch (const exception& e) {
+                                // editors may briefly leave the file missing while saving
+                                log(std::cerr, __FILE__, __LINE__, "[Lovelace] [al::gl::program_permutations] Reload of ", mUrl, " failed: ", e.getMessage());
+                                mReloads.clear();
+                                return;
+                        }
+
+                        if (mCache) {
+                                if (std::optional<program> cached = mCache->find(r.sources)) {
+                                        r.linked.emplace(std::move(*cached));
+                                        r.cached = true;
+                                }
+                        }
+
+                        if (!r.linked) {
+                                r.shaders.reserve(std::size(STAGES));
+                                for (size_t i = 0; i < std::size(STAGES); ++i)
+                                        r.shaders.emplace_back(STAGES[i], r.sources[i], false);
+                        }
+                        mReloads.push_back(std::move(r));
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool program_permutations::advance(pending_reload& r)
+        {
+                if (!r.linked) {
+                        for (const shader& s : r.shaders)
+                                if (!s.isReady())
+                                        return false;
+                        for (shader& s : r.shaders)
+                                s.check();
+
+                        // the old program is linked already and doesn't need its shaders anymore
+                        const shader_features& features = mFeatures.at(r.key);
+                        std::vector<shader*> shaders;
+                        for (size_t i = 0; i < std::size(STAGES); ++i)
+                                shaders.push_back(mLoader->replace(STAGES[i], mUrl, features, std::move(r.shaders[i])));
+                        r.linked.emplace(shaders, false);
+                        return false;
+                }
+
+                if (!r.linked->isReady())
+                        return false;
+                if (!r.cached) {
+                        r.linked->check();
+                        if (mCache)
+                                mCache->store(*r.linked, r.sources);
+                }
+
+                mPrograms.at(r.key).replace(std::move(*r.linked));
+                return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool program_permutations::update()
+        {
+                size_t swapped = 0;
+                for (auto r = mReloads.begin(); r != mReloads.end(); ) {
+                        try {
+                                if (!advance(*r)) {
+                                        ++r;
+                                        continue;
+                                }
+                                ++swapped;
+                        }
+                        catch (const exception& e) {
+                                // the previous program keeps drawing until the source is fixed
+                                log(std::cerr, __FILE__, __LINE__, "[Lovelace] [al::gl::program_permutations] Reload of ", mUrl, " failed: ", e.getMessage());
+                        }
+                        r = mReloads.erase(r);
+                }
+
+                if (swapped)
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::program_permutations] Reloaded ", swapped, " permutations of ", mUrl);
+                return swapped > 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shader_features specialize(shader_features features, const phong_material& material)
+        {
+                bool hasTexCoords               = features.mVertexFormat & VERTEX_TEXCOORD;
+
+                features.mStaticMaterial        = true;
+                features.mAmbientTexture        = hasTexCoords && material.mEnableAmbientTexture;
+                features.mDiffuseTexture        = hasTexCoords && material.mEnableDiffuseTexture;
+                features.mSpecularTexture       = hasTexCoords && material.mEnableSpecularTexture;
+                return features;
+        }
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "glprogram.h"
+#include "glprogram_cache.h"
+#include "glshader_loader.h"
+#include "glshader_features.h"
+#include "glmaterial.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        class program_permutations
+        {
+                // a recompile in flight, the shaders move to the loader once they all compile
+                struct pending_reload
+                {
+                        std::uint64_t key;
+                        std::vector<std::string> sources;
+                        std::vector<shader> shaders;
+                        std::optional<program> linked;
+                        bool cached;
+                };
+
+                shader_loader* mLoader;
+                const program_cache* mCache;
+                std::string mUrl;
+                std::unordered_map<std::uint64_t, program> mPrograms;
+                std::unordered_map<std::uint64_t, shader_features> mFeatures;
+                std::vector<pending_reload> mReloads;
+
+                bool advance(pending_reload& reload);
+        public:
+                program_permutations(shader_loader& loader, const std::string& url, const program_cache* cache = nullptr);
+
+                void compile(const std::vector<shader_features>& permutations);
+                program* get(const shader_features& features);
+
+                // reload() starts recompiling every permutation from the current source, update()
+                // never blocks and swaps each program in place once its new version has linked
+                void reload();
+                bool update();
+                bool isReloading() const                        { return !mReloads.empty(); }
+
+                std::string getUrl() const                      { return mUrl; }
+                size_t getNumPrograms() const                   { return mPrograms.size(); }
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shader_features specialize(shader_features features, const phong_material& material);
+}
@@ -0,0 +1,109 @@
+#include "glreadback_ring.h"
+#include "glstate.h"
+#include "error.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        readback_ring::readback_ring(size_t slots)
+                : mSlots(slots)
+        {
+                if (slots == 0)
+                        throw exception("al::gl", "readback_ring", "readback_ring", "slots must not be zero", etype::unexpected);
+
+                for (slot& s : mSlots)
+                        glGenBuffers(1, &s.mId);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        readback_ring::~readback_ring()
+        {
+                for (slot& s : mSlots) {
+                        if (s.mFence)
+                                glDeleteSync(s.mFence);
+                        glstate().forgetBuffer(s.mId);
+                        glDeleteBuffers(1, &s.mId);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void readback_ring::read(const framebuffer& source, std::uint64_t tag, size_t color)
+        {
+                if (isFull())
+                        throw exception("al::gl", "readback_ring", "read", "every slot is pending, resolve one first", etype::unexpected);
+
+                slot& s = mSlots[(mOldest + mPending) % mSlots.size()];
+                s.mWidth = source.getWidth();
+                s.mHeight = source.getHeight();
+                s.mTag = tag;
+
+                size_t bytes = static_cast<size_t>(s.mWidth) * s.mHeight * 4;
+                glstate().bindBuffer(GL_PIXEL_PACK_BUFFER, s.mId);
+                if (s.mCapacity < bytes) {
+                        glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+                        s.mCapacity = bytes;
+                }
+
+                int previous = 0;
+                glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, source.getId());
+                glReadBuffer(GL_COLOR_ATTACHMENT0 + static_cast<int>(color));
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glReadPixels(0, 0, s.mWidth, s.mHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+
+                // left bound, glReadPixels into client memory would write into the buffer
+                glstate().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+                s.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                ++mPending;
+                ++mStats.mReads;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool readback_ring::resolve(readback& out, bool wait)
+        {
+                if (mPending == 0)
+                        return false;
+
+                // the flush makes sure the fence reaches the GPU, or it would never signal
+                slot& s = mSlots[mOldest];
+                GLenum status = glClientWaitSync(s.mFence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+                if (status == GL_TIMEOUT_EXPIRED) {
+                        if (!wait)
+                                return false;
+
+                        auto start = std::chrono::steady_clock::now();
+                        do
+                                status = glClientWaitSync(s.mFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                        while (status == GL_TIMEOUT_EXPIRED);
+                        ++mStats.mWaits;
+                        mStats.mWaitTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+                glDeleteSync(s.mFence);
+                s.mFence = nullptr;
+
+                size_t bytes = static_cast<size_t>(s.mWidth) * s.mHeight * 4;
+                out.mPixels.resize(bytes);
+                out.mWidth = s.mWidth;
+                out.mHeight = s.mHeight;
+                out.mTag = s.mTag;
+
+                glstate().bindBuffer(GL_PIXEL_PACK_BUFFER, s.mId);
+                void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+                if (!mapped) {
+                        glstate().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+                        throw exception("al::gl", "readback_ring", "resolve", "couldn't map the pixel pack buffer", etype::unexpected);
+                }
+                std::memcpy(out.mPixels.data(), mapped, bytes);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+                glstate().bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+                mOldest = (mOldest + 1) % mSlots.size();
+                --mPending;
+                return true;
+        }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "glframebuffer.h"
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // copies in flight by default, enough for the GPU to draw the next frames meanwhile
+        constexpr size_t READBACK_SLOTS                 = 3;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct readback
+        {
+                std::vector<unsigned char> mPixels;             // RGBA8, bottom row first like GL
+                int mWidth                      = 0;
+                int mHeight                     = 0;
+                std::uint64_t mTag              = 0;            // what read() was given
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct readback_stats
+        {
+                size_t mReads                   = 0;    // copies queued
+                size_t mWaits                   = 0;    // resolves that had to wait for the GPU
+                double mWaitTime                = 0.0;  // milliseconds spent in those waits
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // asynchronous readback: read() has the GPU copy a color attachment into a pixel
+        // pack buffer behind a fence and returns at once, the target can be drawn to again
+        // right away; resolve() maps the oldest copy once its fence has signaled. With the
+        // ring kept full, readback overlaps the frames rendered after it and the CPU only
+        // waits when it runs a whole ring ahead of the GPU
+        class readback_ring
+        {
+                struct slot
+                {
+                        unsigned mId            = 0;
+                        size_t mCapacity        = 0;
+                        GLsync mFence           = nullptr;
+                        int mWidth              = 0;
+                        int mHeight             = 0;
+                        std::uint64_t mTag      = 0;
+                };
+
+                std::vector<slot> mSlots;
+                size_t mOldest = 0;
+                size_t mPending = 0;
+
+                readback_stats mStats;
+        public:
+                explicit readback_ring(size_t slots = READBACK_SLOTS);
+                ~readback_ring();
+
+                readback_ring(const readback_ring&) = delete;
+                readback_ring& operator=(const readback_ring&) = delete;
+
+                // queues the copy of a color attachment, throws when every slot is pending;
+                // a slot grows to the largest target read through it
+                void read(const framebuffer& source, std::uint64_t tag, size_t color = 0);
+
+                // the oldest pending copy into out; false when there is none, or when it
+                // isn't done yet and wait is false
+                bool resolve(readback& out, bool wait = false);
+
+                bool isFull() const                             { return mPending == mSlots.size(); }
+                size_t getPending() const                       { return mPending; }
+                size_t size() const                             { return mSlots.size(); }
+                const readback_stats& getStats() const          { return mStats; }
+        };
+}
@@ -0,0 +1,189 @@
+#include "glrender_queue.h"
+#include "error.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // LSD radix sort on bytes, stable, passes where every key shares the byte are skipped
+        void render_queue::radixSort(std::vector<sort_item>& items, std::vector<sort_item>& scratch)
+        {
+                size_t counts[8][256] = {};
+                for (const auto& item : items)
+                        for (int b = 0; b < 8; ++b)
+                                ++counts[b][(item.key >> (8 * b)) & 0xff];
+
+                scratch.resize(items.size());
+                for (int b = 0; b < 8; ++b) {
+                        size_t* count = counts[b];
+                        if (count[(items.front().key >> (8 * b)) & 0xff] == items.size())
+                                continue;
+
+                        size_t offset = 0;
+                        for (int i = 0; i < 256; ++i) {
+                                size_t c = count[i];
+                                count[i] = offset;
+                                offset += c;
+                        }
+                        for (const auto& item : items)
+                                scratch[count[(item.key >> (8 * b)) & 0xff]++] = item;
+                        items.swap(scratch);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        const render_queue::draw_ids& render_queue::findDrawIds(const mesh& m, int material)
+        {
+                auto ids = mDrawIds.find({&m, material});
+                if (ids != mDrawIds.end())
+                        return ids->second;
+
+                // the textures a draw binds are the mesh's, then its material's
+                std::vector<const texture2D*> textures(m.mTextures.begin(), m.mTextures.end());
+                if (material >= 0 && mMaterials) {
+                        const phong_material& mat = (*mMaterials)[material];
+                        textures.push_back(mat.mEnableAmbientTexture ? mat.mAmbientTexture : nullptr);
+                        textures.push_back(mat.mEnableDiffuseTexture ? mat.mDiffuseTexture : nullptr);
+                        textures.push_back(mat.mEnableSpecularTexture ? mat.mSpecularTexture : nullptr);
+                }
+
+                auto textureId = mTextureIds.emplace(std::move(textures), static_cast<int>(mTextureIds.size())).first->second;
+                auto vaoId = mVaoIds.emplace(m.getVao().getId(), static_cast<int>(mVaoIds.size())).first->second;
+                return mDrawIds.emplace(std::make_pair(&m, material), draw_ids{textureId, vaoId}).first->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int render_queue::findProgramId(const program& p)
+        {
+                return mProgramIds.emplace(&p, static_cast<int>(mProgramIds.size())).first->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        const render_queue::program_handles& render_queue::findHandles(program& p)
+        {
+                auto h = mHandles.find(&p);
+                if (h != mHandles.end())
+                        return h->second;
+
+                // permutations may compile any of these out
+                program_handles handles;
+                if (p.hasUniform("uModel"))
+                        handles.model = p.handle<glm::mat4>("uModel");
+                if (p.hasUniform("uNormal"))
+                        handles.normal = p.handle<glm::mat4>("uNormal");
+                if (p.hasUniform("uMaterialIndex"))
+                        handles.material = p.handle<int>("uMaterialIndex");
+                return mHandles.emplace(&p, handles).first->second;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void render_queue::submit(const mesh& m, program& p, const glm::mat4& model, float depth, int material, int pass, int mode, unsigned condition)
+        {
+                const draw_ids& ids = findDrawIds(m, material);
+                int programId = findProgramId(p);
+                if (pass < 0 || pass > 0xf)
+                        throw exception("al::gl", "render_queue", "submit", "the pass has to be between 0 and 15", etype::unexpected);
+                if (programId > 0xfff || ids.textures > 0xffff || ids.vao > 0xffff)
+                        throw exception("al::gl", "render_queue", "submit", "more programs, texture sets or vaos in one frame than the key holds", etype::unexpected);
+
+                auto quantizedDepth = static_cast<std::uint64_t>(std::clamp(depth, 0.0f, 1.0f) * 0xffff);
+
+                std::uint64_t key = 0;
+                key |= static_cast<std::uint64_t>(pass)                         << RENDER_KEY_PASS_SHIFT;
+                key |= static_cast<std::uint64_t>(programId)                    << RENDER_KEY_PROGRAM_SHIFT;
+                key |= static_cast<std::uint64_t>(ids.textures)                 << RENDER_KEY_TEXTURES_SHIFT;
+                key |= static_cast<std::uint64_t>(ids.vao)                      << RENDER_KEY_VAO_SHIFT;
+                key |= quantizedDepth;
+
+                mTransforms.push_back(model);
+                mPackets.push_back({key, &m, &p, static_cast<int>(mTransforms.size()) - 1, material, mode, condition});
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void render_queue::clear()
+        {
+                mPackets.clear();
+                mTransforms.clear();
+                mItems.clear();
+                mProgramIds.clear();
+                mTextureIds.clear();
+                mVaoIds.clear();
+                mDrawIds.clear();
+                mHandles.clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void render_queue::sort()
+        {
+                mItems.clear();
+                for (size_t i = 0; i < mPackets.size(); ++i)
+                        mItems.push_back({mPackets[i].mKey, static_cast<std::uint32_t>(i)});
+
+                if (mSorting && !mItems.empty())
+                        radixSort(mItems, mScratch);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void render_queue::execute()
+        {
+                if (mItems.size() != mPackets.size())
+                        sort();
+
+                mStats = {};
+                const program* boundProgram = nullptr;
+                std::uint64_t boundTextures = ~0ull;
+                unsigned boundVao = 0;
+
+                for (const sort_item& item : mItems) {
+                        const render_packet& packet = mPackets[item.index];
+
+                        if (packet.mProgram != boundProgram) {
+                                packet.mProgram->use();
+                                boundProgram = packet.mProgram;
+                                ++mStats.mProgramSwitches;
+                        }
+
+                        std::uint64_t textures = (packet.mKey >> RENDER_KEY_TEXTURES_SHIFT) & 0xffff;
+                        if (textures != boundTextures) {
+                                packet.mMesh->bindTextures();
+                                if (packet.mMaterial >= 0 && mMaterials)
+                                        mMaterials->bindTextures(packet.mMaterial);
+                                boundTextures = textures;
+                                ++mStats.mTextureSwitches;
+                        }
+
+                        const auto& vao = packet.mMesh->getVao();
+                        if (vao.getId() != boundVao) {
+                                vao.bind();
+                                boundVao = vao.getId();
+                                ++mStats.mVaoSwitches;
+                        }
+
+                        // shadowed, so repeated values cost no GL call
+                        const program_handles& handles = findHandles(*packet.mProgram);
+                        const glm::mat4& model = mTransforms[packet.mTransform];
+                        if (handles.model.isValid())
+                                packet.mProgram->uniform(handles.model, model);
+                        if (handles.normal.isValid())
+                                packet.mProgram->uniform(handles.normal, glm::transpose(glm::inverse(model)));
+                        if (handles.material.isValid() && packet.mMaterial >= 0)
+                                packet.mProgram->uniform(handles.material, packet.mMaterial);
+
+                        if (packet.mCondition) {
+                                glBeginConditionalRender(packet.mCondition, GL_QUERY_NO_WAIT);
+                                vao.draw(packet.mMode);
+                                glEndConditionalRender();
+                                ++mStats.mConditionalDraws;
+                        }
+                        else
+                                vao.draw(packet.mMode);
+                        ++mStats.mDraws;
+                }
+
+                clear();
+        }
+}
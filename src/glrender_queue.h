@@ -0,0 +1,116 @@
+#pragma once
+
+#include "glmesh.h"
+#include "glprogram.h"
+#include "glmaterial_table.h"
+#include "gltexture2D.h"
+
+#include <glad/glad.h>
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // sort key, from the most to the least expensive state to change
+        //      63..60  pass            59..48  program
+        //      47..32  textures        31..16  vao             15..0   depth
+        constexpr int RENDER_KEY_PASS_SHIFT             = 60;
+        constexpr int RENDER_KEY_PROGRAM_SHIFT          = 48;
+        constexpr int RENDER_KEY_TEXTURES_SHIFT         = 32;
+        constexpr int RENDER_KEY_VAO_SHIFT              = 16;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct render_packet
+        {
+                std::uint64_t mKey;
+                const mesh* mMesh;
+                program* mProgram;
+                int mTransform;                 // index into the queue's transforms
+                int mMaterial;                  // material table index, -1 for none
+                int mMode;
+                unsigned mCondition;            // occlusion query gating the draw, 0 for none
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct render_stats
+        {
+                size_t mDraws                   = 0;
+                size_t mProgramSwitches         = 0;
+                size_t mTextureSwitches         = 0;
+                size_t mVaoSwitches             = 0;
+                size_t mConditionalDraws        = 0;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // packets are submitted in any order, radix-sorted by key, then executed
+        class render_queue
+        {
+                struct sort_item
+                {
+                        std::uint64_t key;
+                        std::uint32_t index;
+                };
+
+                struct draw_ids
+                {
+                        int textures;
+                        int vao;
+                };
+
+                struct program_handles
+                {
+                        uniform_handle<glm::mat4> model;
+                        uniform_handle<glm::mat4> normal;
+                        uniform_handle<int> material;
+                };
+
+                const material_table* mMaterials;
+
+                std::vector<render_packet> mPackets;
+                std::vector<glm::mat4> mTransforms;
+                std::vector<sort_item> mItems;
+                std::vector<sort_item> mScratch;
+                bool mSorting = true;
+
+                // small ids that fit the key fields; keyed by address, so they only live for
+                // one frame's submits: a freed mesh or program may hand its address to another,
+                // and a material may change its textures
+                std::unordered_map<const program*, int> mProgramIds;
+                std::map<std::vector<const texture2D*>, int> mTextureIds;
+                std::unordered_map<unsigned, int> mVaoIds;
+                std::map<std::pair<const mesh*, int>, draw_ids> mDrawIds;
+                std::unordered_map<const program*, program_handles> mHandles;
+
+                render_stats mStats;
+
+                static void radixSort(std::vector<sort_item>& items, std::vector<sort_item>& scratch);
+
+                const draw_ids& findDrawIds(const mesh& m, int material);
+                int findProgramId(const program& p);
+                const program_handles& findHandles(program& p);
+                void clear();
+        public:
+                explicit render_queue(const material_table* materials = nullptr)
+                        : mMaterials{materials} {}
+
+                // depth is normalized to [0, 1], front to back; a condition query skips the
+                // draw on the GPU when it found no samples, without waiting for its result
+                void submit(const mesh& m, program& p, const glm::mat4& model, float depth = 0.0f,
+                            int material = -1, int pass = 0, int mode = GL_TRIANGLES, unsigned condition = 0);
+
+                void sort();
+                void execute();
+
+                // without sorting, packets execute in submission order
+                void setSorting(bool sorting)                   { mSorting = sorting; }
+
+                size_t getNumPackets() const                    { return mPackets.size(); }
+                const render_stats& getStats() const            { return mStats; }
+        };
+}
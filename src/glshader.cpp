@@ -1,4 +1,5 @@
 #include "glshader.h"
+#include "glutils.h"
 #include "error.h"
 
 namespace al::gl
@@ -25,11 +26,23 @@ namespace al::gl
         }
 
         ////////////////////////////////////////////////////////////////////////////////
-        shader::shader(int type, const std::string& source)
+        bool shader::isReady() const
+        {
+                if (!utils::hasParallelCompile())
+                        return true;
+                int done;
+                glGetShaderiv(mId, GL_COMPLETION_STATUS_KHR, &done);
+                return done;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shader::shader(int type, const std::string& source, bool wait)
                 : mType{type}, mSource{source}
         {
                 load();
-                check();
+                // when not waiting, the caller checks after the driver is done compiling
+                if (wait)
+                        check();
         }
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -14,9 +14,8 @@ namespace al::gl
                 std::string mSource;
 
                 void load();
-                void check();
         public:
-                shader(int type, const std::string& source);
+                shader(int type, const std::string& source, bool wait = true);
 
                 ~shader()                       { glDeleteShader(mId); }
 
@@ -29,6 +28,9 @@ namespace al::gl
                 unsigned getId() const          { return mId; }
                 int getType() const             { return mType; }
                 std::string getSource() const   { return mSource; }
+
+                bool isReady() const;
+                void check();
         };
 
         ////////////////////////////////////////////////////////////////////////////////
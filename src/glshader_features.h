@@ -0,0 +1,157 @@
+#pragma once
+
+#include "lights.h"
+#include "error.h"
+
+#include <cstdint>
+#include <string>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        constexpr unsigned VERTEX_POSITION              = 1 << 0;
+        constexpr unsigned VERTEX_NORMAL                = 1 << 1;
+        constexpr unsigned VERTEX_TEXCOORD              = 1 << 2;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // compile-time switches of a shader permutation, injected as #defines
+        struct shader_features
+        {
+                int mNumDirLights                       = 2;
+                int mNumPointLights                     = 4;
+                int mNumSpotLights                      = 2;
+
+                // when false the material textures are toggled at runtime by uniforms
+                bool mStaticMaterial                    = false;
+                bool mAmbientTexture                    = false;
+                bool mDiffuseTexture                    = false;
+                bool mSpecularTexture                   = false;
+
+                unsigned mVertexFormat                  = VERTEX_POSITION | VERTEX_NORMAL | VERTEX_TEXCOORD;
+
+                // camera and lights come from the shared std140 blocks, light counts are runtime
+                bool mUniformBlocks                     = false;
+
+                // material parameters are fetched from a material_table by uMaterialIndex
+                bool mMaterialTable                     = false;
+
+                // model matrix and material index come from per-instance attributes, see instance_buffer
+                bool mInstanced                         = false;
+
+                // writes depth only, gl_Position is invariant so a GL_EQUAL main pass matches it
+                bool mDepthOnly                         = false;
+
+                // point and spot lights come from the clusters of a clustered_lights, light counts are runtime
+                bool mClustered                         = false;
+
+                // writes the packed material and normal to a gbuffer instead of shading
+                bool mGBuffer                           = false;
+
+                // fullscreen pass shading the pixels of a gbuffer, see deferred_renderer
+                bool mDeferredLighting                  = false;
+
+                // the first directional light is shadowed by the cascades of a shadow_cascades
+                bool mShadows                           = false;
+
+                // clustered point and spot lights with a slot are shadowed from a shadow_atlas
+                bool mLightShadows                      = false;
+
+                // throws when a light count or the vertex format doesn't fit its field,
+                // two permutations must never share a key
+                std::uint64_t key() const;
+                std::string defines() const;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline std::uint64_t shader_features::key() const
+        {
+                if (mNumDirLights < 0 || mNumDirLights > 0xff || mNumPointLights < 0 || mNumPointLights > 0xfff ||
+                    mNumSpotLights < 0 || mNumSpotLights > 0xfff || mVertexFormat > 0xff)
+                        throw exception("al::gl", "shader_features", "key", "a light count or the vertex format is out of range", etype::unexpected);
+
+                std::uint64_t k = 0;
+                k |= static_cast<std::uint64_t>(mNumDirLights);
+                k |= static_cast<std::uint64_t>(mNumPointLights)               << 8;
+                k |= static_cast<std::uint64_t>(mNumSpotLights)                << 20;
+                k |= static_cast<std::uint64_t>(mStaticMaterial)               << 32;
+                k |= static_cast<std::uint64_t>(mAmbientTexture)               << 33;
+                k |= static_cast<std::uint64_t>(mDiffuseTexture)               << 34;
+                k |= static_cast<std::uint64_t>(mSpecularTexture)              << 35;
+                k |= static_cast<std::uint64_t>(mUniformBlocks)                << 36;
+                k |= static_cast<std::uint64_t>(mMaterialTable)                << 37;
+                k |= static_cast<std::uint64_t>(mInstanced)                    << 38;
+                k |= static_cast<std::uint64_t>(mDepthOnly)                    << 39;
+                k |= static_cast<std::uint64_t>(mVertexFormat)                 << 40;
+                k |= static_cast<std::uint64_t>(mClustered)                    << 48;
+                k |= static_cast<std::uint64_t>(mGBuffer)                      << 49;
+                k |= static_cast<std::uint64_t>(mDeferredLighting)             << 50;
+                k |= static_cast<std::uint64_t>(mShadows)                      << 51;
+                k |= static_cast<std::uint64_t>(mLightShadows)                 << 52;
+                return k;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline std::string shader_features::defines() const
+        {
+                auto boolean = [](bool b) { return b ? "true\n" : "false\n"; };
+
+                std::string s;
+                s += "#define NUM_DIR_LIGHTS " + std::to_string(mNumDirLights) + '\n';
+                s += "#define NUM_POINT_LIGHTS " + std::to_string(mNumPointLights) + '\n';
+                s += "#define NUM_SPOT_LIGHTS " + std::to_string(mNumSpotLights) + '\n';
+
+                if (mStaticMaterial) {
+                        s += "#define STATIC_MATERIAL\n";
+                        s += std::string("#define HAS_AMBIENT_TEXTURE ") + boolean(mAmbientTexture);
+                        s += std::string("#define HAS_DIFFUSE_TEXTURE ") + boolean(mDiffuseTexture);
+                        s += std::string("#define HAS_SPECULAR_TEXTURE ") + boolean(mSpecularTexture);
+                }
+
+                if (mUniformBlocks) {
+                        s += "#define UNIFORM_BLOCKS\n";
+                        s += "#define MAX_DIR_LIGHTS " + std::to_string(MAX_DIR_LIGHTS) + '\n';
+                        s += "#define MAX_POINT_LIGHTS " + std::to_string(MAX_POINT_LIGHTS) + '\n';
+                        s += "#define MAX_SPOT_LIGHTS " + std::to_string(MAX_SPOT_LIGHTS) + '\n';
+                }
+
+                if (mMaterialTable)
+                        s += "#define MATERIAL_TABLE\n";
+
+                if (mInstanced)
+                        s += "#define INSTANCED\n";
+
+                if (mDepthOnly)
+                        s += "#define DEPTH_ONLY\n";
+
+                if (mClustered)
+                        s += "#define CLUSTERED\n";
+
+                if (mGBuffer)
+                        s += "#define GBUFFER\n";
+
+                if (mDeferredLighting)
+                        s += "#define DEFERRED_LIGHTING\n";
+
+                if (mShadows) {
+                        s += "#define SHADOWS\n";
+                        s += "#define MAX_SHADOW_CASCADES " + std::to_string(MAX_SHADOW_CASCADES) + '\n';
+                }
+
+                if (mLightShadows) {
+                        s += "#define LIGHT_SHADOWS\n";
+                        s += "#define SHADOW_ATLAS_TEXELS " + std::to_string(SHADOW_ATLAS_TEXELS) + '\n';
+                }
+
+                if (mVertexFormat & VERTEX_NORMAL)
+                        s += "#define HAS_NORMAL\n";
+                if (mVertexFormat & VERTEX_TEXCOORD)
+                        s += "#define HAS_TEXCOORD\n";
+                return s;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline bool operator==(const shader_features& first, const shader_features& second) { return first.key() == second.key(); }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline bool operator!=(const shader_features& first, const shader_features& second) { return first.key() != second.key(); }
+}
@@ -8,27 +8,53 @@
 namespace al::gl
 {
         ////////////////////////////////////////////////////////////////////////////////
-        shader* shader_loader::load(int type, const std::string& url)
+        std::string shader_loader::preprocess(int type, const std::string& url, const shader_features& features) const
         {
-                auto id = url + std::to_string(type);
+                auto shaderSource = std::string("#version 400 core\n");
+                shaderSource += [](int shaderType) {
+                        switch (shaderType) {
+                                case GL_VERTEX_SHADER:
+                                        return "#define VERTEX_SHADER\n";
+                                case GL_FRAGMENT_SHADER:
+                                        return "#define FRAGMENT_SHADER\n";
+                                default:
+                                        return "#define UNKNOWN_SHADER\n";
+                        }
+                }(type);
+                shaderSource += features.defines();
+                shaderSource += read(url);
+                return shaderSource;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std::string shader_loader::genId(int type, const std::string& url, const shader_features& features)
+        {
+                return url + std::to_string(type) + '#' + std::to_string(features.key());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shader* shader_loader::load(int type, const std::string& url, const shader_features& features, bool wait)
+        {
+                auto id = genId(type, url, features);
                 auto savedShader = mShaders.find(id);
                 if (savedShader == mShaders.end()) {
-                        auto shaderSource = std::string("#version 400 core\n");
-                        shaderSource += [](int shaderType) {
-                                switch (shaderType) {
-                                        case GL_VERTEX_SHADER:
-                                                return "#define VERTEX_SHADER\n";
-                                        case GL_FRAGMENT_SHADER:
-                                                return "#define FRAGMENT_SHADER\n";
-                                        default:
-                                                return "#define UNKNOWN_SHADER\n";
-                                }
-                        }(type);
-                        shaderSource += read(url);
-                        auto result = mShaders.emplace(id, std::move(shader(type, shaderSource)));
-                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::shader_loader] Loaded ", url);
+                        auto result = mShaders.emplace(id, std::move(shader(type, preprocess(type, url, features), wait)));
+                        log(std::cout, __FILE__, __LINE__, "[Lovelace] [al::gl::shader_loader] Loaded ", url, " [permutation ", features.key(), "]");
                         return &result.first->second;
                 }
                 return &savedShader->second;
         }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shader* shader_loader::replace(int type, const std::string& url, const shader_features& features, shader&& s)
+        {
+                auto id = genId(type, url, features);
+                auto savedShader = mShaders.find(id);
+                if (savedShader == mShaders.end())
+                        return &mShaders.emplace(id, std::move(s)).first->second;
+
+                // assigned in place, pointers held by programs stay valid
+                savedShader->second = std::move(s);
+                return &savedShader->second;
+        }
 }
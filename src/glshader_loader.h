@@ -1,6 +1,7 @@
 #pragma once
 
 #include "glshader.h"
+#include "glshader_features.h"
 
 #include <string>
 #include <unordered_map>
@@ -13,9 +14,15 @@ namespace al::gl
         private:
                 std::unordered_map<std::string, shader> mShaders;
 
+                static std::string genId(int type, const std::string& url, const shader_features& features);
+
         public:
                 ~shader_loader() { mShaders.clear(); }
 
-                shader* load(int type, const std::string& url);
+                shader* load(int type, const std::string& url, const shader_features& features = {}, bool wait = true);
+                // programs linked against the previous shader keep working, see program_permutations::reload
+                shader* replace(int type, const std::string& url, const shader_features& features, shader&& s);
+
+                std::string preprocess(int type, const std::string& url, const shader_features& features = {}) const;
         };
 }
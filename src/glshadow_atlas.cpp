@@ -0,0 +1,448 @@
+#include "glshadow_atlas.h"
+#include "glstate.h"
+#include "error.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // the cube faces in the order computeLightShadow() in phong.glsl picks them
+        static const glm::vec3 FACE_DIRECTIONS[6] = {
+                { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+                { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+                { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+        };
+        static const glm::vec3 FACE_UPS[6] = {
+                { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+                { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f },
+                { 0.0f, -1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f }
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // two texels on each side of a face are border, so filtering never leaves its tile
+        static float borderedTangent(float tangent, int size)
+        {
+                return tangent * size / (size - 4);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // of a spot light's half angle; wider cones would need more than one perspective tile
+        static float spotTangent(float outerCutoff)
+        {
+                return std::tan(std::min(std::acos(glm::clamp(outerCutoff, -1.0f, 1.0f)), glm::radians(80.0f)));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        static bool touches(const glm::vec3& center, const glm::vec3& extents, const glm::vec3& position, float range)
+        {
+                glm::vec3 d = glm::max(glm::abs(position - center) - extents, glm::vec3(0.0f));
+                return glm::dot(d, d) <= range * range;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shadow_atlas::shadow_atlas(program& depthProgram, size_t slots, int size, int maxTile, int minTile)
+                : mProgram{depthProgram}, mMaxTile{maxTile}, mAllocator(size, minTile), mSlots(slots),
+                  mData(GL_TEXTURE_BUFFER, std::vector<glm::vec4>(std::max<size_t>(slots, 1) * SHADOW_ATLAS_TEXELS), GL_DYNAMIC_DRAW)
+        {
+                if (maxTile > size || maxTile < minTile)
+                        throw exception("al::gl", "shadow_atlas", "shadow_atlas", "maxTile has to be between minTile and size", etype::unexpected);
+
+                mPVM = mProgram.handle<glm::mat4>("uPVM");
+
+                // compared in hardware, linear filtering blends four comparisons
+                glGenTextures(1, &mTexture);
+                glstate().bindTexture(GL_TEXTURE_2D, mTexture);
+                        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+                glstate().bindTexture(GL_TEXTURE_2D, 0);
+
+                int previousFramebuffer = 0;
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+                glGenFramebuffers(1, &mFramebuffer);
+                glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+                        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mTexture, 0);
+                        glDrawBuffer(GL_NONE);
+                        glReadBuffer(GL_NONE);
+                        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+                glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+                if (!complete)
+                        throw exception("al::gl", "shadow_atlas", "shadow_atlas", "incomplete framebuffer", etype::unexpected);
+
+                glGenTextures(1, &mDataTexture);
+                glstate().bindTexture(GL_TEXTURE_BUFFER, mDataTexture);
+                        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, mData.getId());
+                glstate().bindTexture(GL_TEXTURE_BUFFER, 0);
+
+                glGenQueries(2 * SHADOW_ATLAS_QUERY_FRAMES, &mQueries[0][0]);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shadow_atlas::~shadow_atlas()
+        {
+                glDeleteQueries(2 * SHADOW_ATLAS_QUERY_FRAMES, &mQueries[0][0]);
+                glDeleteFramebuffers(1, &mFramebuffer);
+                glstate().forgetTexture(mDataTexture);
+                glstate().forgetTexture(mTexture);
+                glDeleteTextures(1, &mDataTexture);
+                glDeleteTextures(1, &mTexture);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::submit(const mesh& m, const glm::mat4& model, bool dynamic)
+        {
+                if (dynamic)
+                        mDynamic.push_back(mCasters.size());
+                mCasters.push_back({&m, model, dynamic});
+                mBounds.add(m.getBounds(), model);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::invalidate()
+        {
+                for (slot& s : mSlots)
+                        std::fill(std::begin(s.mValid), std::end(s.mValid), false);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::gather(size_t i, int faces, const glm::vec3& position, const glm::vec3& direction, float range, float outerCutoff)
+        {
+                if (i >= mSlots.size())
+                        throw exception("al::gl", "shadow_atlas", "render", "shadow slot out of range", etype::unexpected);
+
+                slot& s = mSlots[i];
+                if (s.mSeen)
+                        throw exception("al::gl", "shadow_atlas", "render", "two lights in one shadow slot", etype::unexpected);
+                s.mSeen = true;
+
+                // a light turned from point to spot or back needs a different number of tiles
+                if (s.mFaces != faces)
+                        release(s);
+
+                if (s.mFaces != faces || glm::vec4(s.mPosition, s.mRange) != glm::vec4(position, range) ||
+                    glm::vec4(s.mDirection, s.mOuterCutoff) != glm::vec4(direction, outerCutoff)) {
+                        s.mFaces = faces;
+                        s.mPosition = position;
+                        s.mDirection = direction;
+                        s.mRange = range;
+                        s.mOuterCutoff = outerCutoff;
+                        std::fill(std::begin(s.mValid), std::end(s.mValid), false);
+                }
+                mOrder.push_back(i);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        int shadow_atlas::wantedSize(const slot& s) const
+        {
+                // a halving per doubling of the distance beyond the range
+                float halvings = std::min(std::log2(1.0f / s.mImportance), 30.0f);
+                if (s.mWanted > 0) {
+                        float current = std::log2(static_cast<float>(mMaxTile) / s.mWanted);
+                        if (halvings > current - SHADOW_ATLAS_HYSTERESIS && halvings < current + 1.0f + SHADOW_ATLAS_HYSTERESIS)
+                                return s.mWanted;
+                }
+
+                int size = mMaxTile;
+                for (int h = static_cast<int>(halvings); h > 0 && size > mAllocator.getMinSize(); --h)
+                        size /= 2;
+                return size;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool shadow_atlas::allocate(slot& s, int size)
+        {
+                // the wanted size first, then smaller until even the smallest tiles don't fit
+                for (; size >= mAllocator.getMinSize(); size /= 2) {
+                        int taken = 0;
+                        while (taken < s.mFaces && mAllocator.allocate(size, s.mTiles[taken]))
+                                ++taken;
+                        if (taken == s.mFaces) {
+                                s.mSize = size;
+                                std::fill(std::begin(s.mValid), std::end(s.mValid), false);
+                                return true;
+                        }
+                        while (taken > 0)
+                                mAllocator.release(s.mTiles[--taken]);
+                }
+                return false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::release(slot& s)
+        {
+                s.mWanted = 0;
+                s.mRepacked = false;
+                if (s.mSize == 0)
+                        return;
+                for (int f = 0; f < s.mFaces; ++f)
+                        mAllocator.release(s.mTiles[f]);
+                s.mSize = 0;
+                mDataDirty = true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::repack()
+        {
+                // in importance order the sizes never grow, so the buddy tiles pack without gaps
+                mAllocator.clear();
+                for (slot& s : mSlots)
+                        s.mSize = 0;
+                for (size_t i : mOrder) {
+                        slot& s = mSlots[i];
+                        int size = wantedSize(s);
+                        allocate(s, size);
+                        s.mWanted = size;
+                        s.mRepacked = s.mSize != size;
+                }
+                mDataDirty = true;
+                mStats.mRepacked = true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::fit(size_t i)
+        {
+                slot& s = mSlots[i];
+
+                // near at a hundredth of the range keeps 24 bits of depth precise enough
+                float near = 0.01f * s.mRange;
+                if (s.mFaces == 6) {
+                        glm::mat4 projection = glm::perspective(2.0f * std::atan(borderedTangent(1.0f, s.mSize)), 1.0f, near, s.mRange);
+                        for (int f = 0; f < 6; ++f)
+                                s.mProjectionView[f] = projection * glm::lookAt(s.mPosition, s.mPosition + FACE_DIRECTIONS[f], FACE_UPS[f]);
+                }
+                else {
+                        glm::vec3 direction = glm::normalize(s.mDirection);
+                        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                        glm::mat4 projection = glm::perspective(2.0f * std::atan(borderedTangent(spotTangent(s.mOuterCutoff), s.mSize)), 1.0f, near, s.mRange);
+                        s.mProjectionView[0] = projection * glm::lookAt(s.mPosition, s.mPosition + direction, up);
+                }
+                mDataDirty = true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::collect()
+        {
+                for (int k = 0; k < SHADOW_ATLAS_QUERY_FRAMES; ++k) {
+                        int q = (mNextQuery + k) % SHADOW_ATLAS_QUERY_FRAMES;
+                        if (!mInFlight[q])
+                                continue;
+
+                        int available = 0;
+                        glGetQueryObjectiv(mQueries[q][1], GL_QUERY_RESULT_AVAILABLE, &available);
+                        if (!available)
+                                continue;
+
+                        // oldest first, the newest result available is the one kept
+                        GLuint64 begin = 0, end = 0;
+                        glGetQueryObjectui64v(mQueries[q][0], GL_QUERY_RESULT, &begin);
+                        glGetQueryObjectui64v(mQueries[q][1], GL_QUERY_RESULT, &end);
+                        mStats.mTime = (end - begin) * 1e-6;
+                        mInFlight[q] = false;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::render(const fpscamera& camera, const std::vector<point_light>& pointLights, const std::vector<spot_light>& spotLights)
+        {
+                collect();
+                double time = mStats.mTime;
+                mStats = shadow_atlas_stats{};
+                mStats.mTime = time;
+
+                // the slotted lights of the frame, slots left empty give their tiles back
+                mOrder.clear();
+                for (slot& s : mSlots)
+                        s.mSeen = false;
+                for (const point_light& l : pointLights)
+                        if (l.mShadow >= 0)
+                                gather(static_cast<size_t>(l.mShadow), 6, l.mPosition, glm::vec3(0.0f), l.mRange, 0.0f);
+                for (const spot_light& l : spotLights)
+                        if (l.mShadow >= 0)
+                                gather(static_cast<size_t>(l.mShadow), 1, l.mPosition, l.mDirection, l.mRange, l.mOuterCutoff);
+                for (slot& s : mSlots)
+                        if (!s.mSeen)
+                                release(s);
+
+                // lights whose range is out of view still get a tile, a smaller one
+                frustum view(camera.getProjection() * camera.getView());
+                for (size_t i : mOrder) {
+                        slot& s = mSlots[i];
+                        float distance = glm::length(s.mPosition - camera.mPosition);
+                        s.mImportance = s.mRange / std::max(distance, s.mRange);
+                        if (!view.contains(s.mPosition, s.mRange))
+                                s.mImportance *= 0.25f;
+                }
+                std::stable_sort(mOrder.begin(), mOrder.end(), [&](size_t a, size_t b) { return mSlots[a].mImportance > mSlots[b].mImportance; });
+
+                // lights that changed tier move, when one doesn't get its size while less
+                // important lights hold enough texels for it, everything is packed again by
+                // importance; a smaller tile than wanted is kept until the tier changes, else
+                // an oversubscribed atlas would reallocate and redraw it every frame, and a
+                // light without tiles retries alone once a repack failed to place it
+                for (size_t k = 0; k < mOrder.size(); ++k) {
+                        slot& s = mSlots[mOrder[k]];
+                        int size = wantedSize(s);
+                        if (size == s.mWanted && s.mSize > 0)
+                                continue;
+
+                        bool repacked = size == s.mWanted && s.mRepacked;
+                        release(s);
+                        s.mWanted = size;
+                        s.mRepacked = repacked;
+                        if ((allocate(s, size) && s.mSize == size) || s.mRepacked)
+                                continue;
+
+                        size_t held = 0;
+                        for (size_t j = k + 1; j < mOrder.size(); ++j) {
+                                const slot& other = mSlots[mOrder[j]];
+                                held += static_cast<size_t>(other.mFaces) * other.mSize * other.mSize;
+                        }
+                        size_t needed = static_cast<size_t>(s.mFaces) * size * size - static_cast<size_t>(s.mFaces) * s.mSize * s.mSize;
+                        if (held >= needed) {
+                                repack();
+                                break;
+                        }
+                }
+
+                int previousFramebuffer = 0;
+                int viewport[4];
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                bool bound = false;
+                int q = mNextQuery;
+                bool measured = false;
+
+                mVisible.resize(mCasters.size());
+                for (size_t i : mOrder) {
+                        slot& s = mSlots[i];
+                        if (s.mSize == 0) {
+                                ++mStats.mDropped;
+                                continue;
+                        }
+                        ++mStats.mLights;
+
+                        if (std::find(std::begin(s.mValid), std::begin(s.mValid) + s.mFaces, false) != std::begin(s.mValid) + s.mFaces)
+                                fit(i);
+
+                        // most lights have no dynamic caster in range and skip the faces' tests
+                        bool reached = false;
+                        for (size_t k : mDynamic)
+                                reached |= touches(mBounds.getCenter(k), mBounds.getExtents(k), s.mPosition, s.mRange);
+
+                        bool rendered = false;
+                        for (int f = 0; f < s.mFaces; ++f) {
+                                frustum face(s.mProjectionView[f]);
+                                bool dynamic = false;
+                                if (reached)
+                                        for (size_t k : mDynamic)
+                                                dynamic |= face.contains(mBounds.getCenter(k), mBounds.getExtents(k));
+                                if (s.mValid[f] && !dynamic && !s.mHadDynamic[f])
+                                        continue;
+
+                                if (!bound) {
+                                        glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+                                        glEnable(GL_SCISSOR_TEST);
+                                        glEnable(GL_POLYGON_OFFSET_FILL);
+                                        glPolygonOffset(1.5f, 4.0f);
+                                        mProgram.use();
+
+                                        measured = !mInFlight[q];
+                                        if (measured)
+                                                glQueryCounter(mQueries[q][0], GL_TIMESTAMP);
+                                        bound = true;
+                                }
+
+                                // the clear is scissored to the tile, the neighbours keep their depth
+                                const atlas_tile& t = s.mTiles[f];
+                                glViewport(t.mX, t.mY, t.mSize, t.mSize);
+                                glScissor(t.mX, t.mY, t.mSize, t.mSize);
+                                glClear(GL_DEPTH_BUFFER_BIT);
+
+                                mBounds.cull(face, mVisible);
+                                for (size_t k = 0; k < mCasters.size(); ++k) {
+                                        if (!mVisible[k])
+                                                continue;
+                                        const caster& cs = mCasters[k];
+                                        mProgram.uniform(mPVM, s.mProjectionView[f] * cs.model);
+                                        cs.m->getVao().bind();
+                                        cs.m->getVao().draw();
+                                        ++mStats.mDraws;
+                                }
+
+                                s.mValid[f] = true;
+                                s.mHadDynamic[f] = dynamic;
+                                ++mStats.mFaces;
+                                rendered = true;
+                        }
+                        mStats.mRendered += rendered;
+                }
+
+                if (bound) {
+                        if (measured) {
+                                glQueryCounter(mQueries[q][1], GL_TIMESTAMP);
+                                mInFlight[q] = true;
+                                mNextQuery = (q + 1) % SHADOW_ATLAS_QUERY_FRAMES;
+                        }
+                        glDisable(GL_POLYGON_OFFSET_FILL);
+                        glDisable(GL_SCISSOR_TEST);
+                        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+                        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                }
+
+                // the layout computeLightShadow() in phong.glsl reads, tiles in atlas coordinates
+                if (mDataDirty) {
+                        std::vector<glm::vec4>& data = mData.getData();
+                        std::fill(data.begin(), data.end(), glm::vec4(0.0f));
+                        float atlasSize = static_cast<float>(mAllocator.getSize());
+                        for (size_t i = 0; i < mSlots.size(); ++i) {
+                                const slot& s = mSlots[i];
+                                if (!s.mSeen || s.mSize == 0)
+                                        continue;
+
+                                glm::vec4* record = data.data() + i * SHADOW_ATLAS_TEXELS;
+                                float tangent = s.mFaces == 6 ? 1.0f : spotTangent(s.mOuterCutoff);
+                                record[0] = glm::vec4(static_cast<float>(s.mFaces), 2.0f * borderedTangent(tangent, s.mSize) / s.mSize, 0.0f, 0.0f);
+                                for (int f = 0; f < s.mFaces; ++f) {
+                                        const atlas_tile& t = s.mTiles[f];
+                                        float half = 0.5f * t.mSize / atlasSize;
+                                        glm::mat4 tile = glm::translate(glm::mat4(1.0f), glm::vec3((t.mX + 0.5f * t.mSize) / atlasSize, (t.mY + 0.5f * t.mSize) / atlasSize, 0.5f));
+                                        tile = glm::scale(tile, glm::vec3(half, half, 0.5f));
+                                        glm::mat4 matrix = tile * s.mProjectionView[f];
+                                        for (int c = 0; c < 4; ++c)
+                                                record[1 + 4 * f + c] = matrix[c];
+                                }
+                        }
+                        mData.upload(0, data.size());
+                        mDataDirty = false;
+                }
+
+                mStats.mUsage = static_cast<float>(mAllocator.getUsed()) / (static_cast<float>(mAllocator.getSize()) * mAllocator.getSize());
+
+                mCasters.clear();
+                mDynamic.clear();
+                mBounds.clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::attach(program& p) const
+        {
+                p.uniform("uShadowAtlas", SHADOW_ATLAS_UNIT);
+                p.uniform("uShadowAtlasData", SHADOW_ATLAS_DATA_UNIT);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_atlas::bind() const
+        {
+                glstate().bindTexture(SHADOW_ATLAS_UNIT, GL_TEXTURE_2D, mTexture);
+                glstate().bindTexture(SHADOW_ATLAS_DATA_UNIT, GL_TEXTURE_BUFFER, mDataTexture);
+        }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "atlas_allocator.h"
+#include "culling.h"
+#include "fpscamera.h"
+#include "glbuffer.h"
+#include "glmesh.h"
+#include "glprogram.h"
+#include "lights.h"
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // texture units of the atlas and of the slots' matrices, after the shadow cascades'
+        constexpr int SHADOW_ATLAS_UNIT                 = 11;
+        constexpr int SHADOW_ATLAS_DATA_UNIT            = 12;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // frames of GPU timestamps in flight before a render goes unmeasured
+        constexpr int SHADOW_ATLAS_QUERY_FRAMES         = 4;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // a slot keeps its tier, and whatever tile size it was granted for it, until the
+        // wanted size is this many halvings beyond the tier
+        constexpr float SHADOW_ATLAS_HYSTERESIS         = 0.25f;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct shadow_atlas_stats
+        {
+                size_t mLights                  = 0;    // slots with tiles this frame
+                size_t mDropped                 = 0;    // slots left without a tile, the atlas is full
+                size_t mRendered                = 0;    // lights with at least one face redrawn
+                size_t mFaces                   = 0;    // faces redrawn, six per point light at most
+                size_t mDraws                   = 0;    // caster draws over every redrawn face
+                bool mRepacked                  = false; // every tile was reallocated by importance
+                float mUsage                    = 0.0f; // allocated fraction of the atlas
+                double mTime                    = 0.0;  // GPU milliseconds of the latest measured render
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // shadow maps of the point and spot lights whose mShadow names a slot, packed into
+        // one depth texture: a point light gets six tiles, a cube face each, a spot light one.
+        // Tiles are sized by importance, the light's range over its distance to the camera,
+        // and a face is redrawn only when its tile is new, its light moved, invalidate() was
+        // called or a dynamic caster is or was in it, so static lights cost nothing per frame.
+        // The depth program has to be phong.glsl with shader_features::mDepthOnly and uPVM,
+        // the lit programs need shader_features::mClustered and mLightShadows
+        class shadow_atlas
+        {
+                struct caster
+                {
+                        const mesh* m;
+                        glm::mat4 model;
+                        bool dynamic;
+                };
+
+                struct slot
+                {
+                        int mFaces = 0;                 // 6 for a point light, 1 for a spot light, 0 unused
+                        glm::vec3 mPosition = glm::vec3(0.0f);
+                        glm::vec3 mDirection = glm::vec3(0.0f);
+                        float mRange = 0.0f;
+                        float mOuterCutoff = 0.0f;
+
+                        float mImportance = 0.0f;
+                        int mSize = 0;                  // of each tile, 0 without tiles
+                        int mWanted = 0;                // the tier's size, mSize is smaller when the atlas was full
+                        bool mRepacked = false;         // a repack already failed to grant mWanted
+                        atlas_tile mTiles[6];
+                        glm::mat4 mProjectionView[6];   // into the light's view, then the face
+                        bool mValid[6] = {};
+                        bool mHadDynamic[6] = {};
+                        bool mSeen = false;
+                };
+
+                program& mProgram;
+                uniform_handle<glm::mat4> mPVM;
+                int mMaxTile;
+
+                atlas_allocator mAllocator;
+                unsigned mTexture;
+                unsigned mFramebuffer;
+
+                std::vector<slot> mSlots;
+                std::vector<size_t> mOrder;
+                buffer<glm::vec4> mData;
+                unsigned mDataTexture;
+                bool mDataDirty = true;
+
+                unsigned mQueries[SHADOW_ATLAS_QUERY_FRAMES][2];
+                bool mInFlight[SHADOW_ATLAS_QUERY_FRAMES] = {};
+                int mNextQuery = 0;
+
+                std::vector<caster> mCasters;
+                std::vector<size_t> mDynamic;
+                cull_set mBounds;
+                std::vector<unsigned char> mVisible;
+
+                shadow_atlas_stats mStats;
+
+                void gather(size_t i, int faces, const glm::vec3& position, const glm::vec3& direction, float range, float outerCutoff);
+                int wantedSize(const slot& s) const;
+                bool allocate(slot& s, int size);
+                void release(slot& s);
+                void repack();
+                void fit(size_t i);
+                void collect();
+        public:
+                // slots is the capacity, tiles are powers of two from minTile to maxTile
+                shadow_atlas(program& depthProgram, size_t slots, int size = 4096, int maxTile = 512, int minTile = 64);
+                ~shadow_atlas();
+
+                shadow_atlas(const shadow_atlas&) = delete;
+                shadow_atlas& operator=(const shadow_atlas&) = delete;
+
+                // every caster of the frame, static ones too, so a redrawn face is complete
+                void submit(const mesh& m, const glm::mat4& model, bool dynamic = false);
+
+                // sizes and packs the tiles of the slotted lights and redraws the stale faces,
+                // then restores the framebuffer and viewport; the casters are consumed
+                void render(const fpscamera& camera, const std::vector<point_light>& pointLights, const std::vector<spot_light>& spotLights);
+
+                // after static casters were added, removed or moved
+                void invalidate();
+
+                // the program must be in use, points uShadowAtlas and uShadowAtlasData at their units
+                void attach(program& p) const;
+
+                void bind() const;
+
+                size_t getNumSlots() const                      { return mSlots.size(); }
+                const shadow_atlas_stats& getStats() const      { return mStats; }
+        };
+}
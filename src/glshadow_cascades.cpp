@@ -0,0 +1,292 @@
+#include "glshadow_cascades.h"
+#include "glstate.h"
+#include "error.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // the box swept by offset is outside a plane only when both of its ends are
+        static bool containsSwept(const frustum& f, const glm::vec3& center, const glm::vec3& extents, const glm::vec3& offset)
+        {
+                for (const glm::vec4& p : f.mPlanes) {
+                        glm::vec3 normal(p);
+                        float reach = glm::dot(glm::abs(normal), extents);
+                        float distance = glm::dot(normal, center) + p.w;
+                        if (distance + reach < 0.0f && distance + glm::dot(normal, offset) + reach < 0.0f)
+                                return false;
+                }
+                return true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shadow_cascades::shadow_cascades(program& depthProgram, int size, int count)
+                : mProgram{depthProgram}, mSize{size}, mCount{count}, mFirstCached{std::max(count - 2, 0)}
+        {
+                if (count < 1 || count > MAX_SHADOW_CASCADES)
+                        throw exception("al::gl", "shadow_cascades", "shadow_cascades", "1 to MAX_SHADOW_CASCADES cascades", etype::unexpected);
+
+                mPVM = mProgram.handle<glm::mat4>("uPVM");
+
+                // compared in hardware, linear filtering blends four comparisons
+                glGenTextures(1, &mTexture);
+                glstate().bindTexture(GL_TEXTURE_2D_ARRAY, mTexture);
+                        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, mSize, mSize, mCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+                        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+                        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+                        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+                glstate().bindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+                glGenFramebuffers(1, &mFramebuffer);
+
+                mCascades.resize(mCount);
+                for (cascade& c : mCascades)
+                        glGenQueries(2 * SHADOW_QUERY_FRAMES, &c.mQueries[0][0]);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        shadow_cascades::~shadow_cascades()
+        {
+                for (cascade& c : mCascades)
+                        glDeleteQueries(2 * SHADOW_QUERY_FRAMES, &c.mQueries[0][0]);
+                glDeleteFramebuffers(1, &mFramebuffer);
+                glstate().forgetTexture(mTexture);
+                glDeleteTextures(1, &mTexture);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::submit(const mesh& m, const glm::mat4& model, bool dynamic)
+        {
+                mCasters.push_back({&m, model, dynamic});
+                mBounds.add(m.getBounds(), model);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::invalidate()
+        {
+                for (cascade& c : mCascades)
+                        c.mValid = false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::fit(int i, const glm::mat4& slice, bool& stale)
+        {
+                cascade& c = mCascades[i];
+
+                // the sphere around the slice doesn't change with the camera's orientation,
+                // so neither does the texel size as long as the splits stay put
+                glm::mat4 inverse = glm::inverse(slice);
+                glm::vec3 corners[8];
+                glm::vec3 center(0.0f);
+                for (int k = 0; k < 8; ++k) {
+                        glm::vec4 p = inverse * glm::vec4((k & 1) ? 1.0f : -1.0f, (k & 2) ? 1.0f : -1.0f, (k & 4) ? 1.0f : -1.0f, 1.0f);
+                        corners[k] = glm::vec3(p) / p.w;
+                        center += corners[k];
+                }
+                center /= 8.0f;
+
+                float radius = 0.0f;
+                for (const glm::vec3& corner : corners)
+                        radius = std::max(radius, glm::length(corner - center));
+                radius = std::ceil(radius * 16.0f) / 16.0f;
+
+                // kept while the slice stays inside the region drawn last
+                glm::vec3 lightCenter = glm::vec3(mLightView * glm::vec4(center, 1.0f));
+                stale = !c.mValid || glm::length(lightCenter - c.mCenter) + radius > c.mRadius;
+                if (!stale)
+                        return;
+
+                // two texels on each side absorb the snapping, cached cascades get the margin too
+                float extent = i >= mFirstCached ? radius * (1.0f + mMargin) : radius;
+                c.mRadius = extent * mSize / (mSize - 4);
+                c.mTexel = 2.0f * c.mRadius / mSize;
+
+                // moving in whole texels keeps edges from crawling as the camera moves
+                c.mCenter = lightCenter;
+                c.mCenter.x = std::floor(lightCenter.x / c.mTexel) * c.mTexel;
+                c.mCenter.y = std::floor(lightCenter.y / c.mTexel) * c.mTexel;
+
+                glm::mat4 projection = glm::ortho(c.mCenter.x - c.mRadius, c.mCenter.x + c.mRadius,
+                                                  c.mCenter.y - c.mRadius, c.mCenter.y + c.mRadius,
+                                                  -c.mCenter.z - c.mRadius - mCasterDistance, -c.mCenter.z + c.mRadius);
+                c.mProjectionView = projection * mLightView;
+                c.mValid = true;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::draw(int i)
+        {
+                cascade& c = mCascades[i];
+                c.mStats.mDraws = 0;
+
+                int q = c.mNextQuery;
+                bool measured = !c.mInFlight[q];
+                if (measured)
+                        glQueryCounter(c.mQueries[q][0], GL_TIMESTAMP);
+
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTexture, 0, i);
+                glClear(GL_DEPTH_BUFFER_BIT);
+
+                for (size_t k = 0; k < mCasters.size(); ++k) {
+                        if (!mVisible[k])
+                                continue;
+                        const caster& cs = mCasters[k];
+                        mProgram.uniform(mPVM, c.mProjectionView * cs.model);
+                        cs.m->getVao().bind();
+                        cs.m->getVao().draw();
+                        ++c.mStats.mDraws;
+                }
+
+                if (measured) {
+                        glQueryCounter(c.mQueries[q][1], GL_TIMESTAMP);
+                        c.mInFlight[q] = true;
+                        c.mNextQuery = (q + 1) % SHADOW_QUERY_FRAMES;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::collect(cascade& c)
+        {
+                for (int k = 0; k < SHADOW_QUERY_FRAMES; ++k) {
+                        int q = (c.mNextQuery + k) % SHADOW_QUERY_FRAMES;
+                        if (!c.mInFlight[q])
+                                continue;
+
+                        int available = 0;
+                        glGetQueryObjectiv(c.mQueries[q][1], GL_QUERY_RESULT_AVAILABLE, &available);
+                        if (!available)
+                                continue;
+
+                        // oldest first, the newest result available is the one kept
+                        GLuint64 begin = 0, end = 0;
+                        glGetQueryObjectui64v(c.mQueries[q][0], GL_QUERY_RESULT, &begin);
+                        glGetQueryObjectui64v(c.mQueries[q][1], GL_QUERY_RESULT, &end);
+                        c.mStats.mTime = (end - begin) * 1e-6;
+                        c.mInFlight[q] = false;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::render(const fpscamera& camera, const dir_light& light)
+        {
+                if (light.mDirection != mLightDirection) {
+                        glm::vec3 direction = glm::normalize(light.mDirection);
+                        glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+                        mLightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+                        mLightDirection = light.mDirection;
+                        invalidate();
+                }
+
+                // distance along the view direction, the third row of the view matrix negated
+                glm::mat4 view = camera.getView();
+                mDepthPlane = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+
+                int previousFramebuffer = 0;
+                int viewport[4];
+                glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+                glGetIntegerv(GL_VIEWPORT, viewport);
+                bool bound = false;
+
+                // practical split scheme, blending logarithmic and uniform splits
+                float near = camera.mNear;
+                float far = std::min(mMaxDistance, camera.mFar);
+                for (int i = 0; i < mCount; ++i) {
+                        cascade& c = mCascades[i];
+                        collect(c);
+
+                        float t = static_cast<float>(i + 1) / mCount;
+                        float split = mLambda * near * std::pow(far / near, t) + (1.0f - mLambda) * (near + (far - near) * t);
+                        float sliceNear = i == 0 ? near : mCascades[i - 1].mStats.mSplit;
+                        c.mStats.mSplit = split;
+
+                        glm::mat4 slice = glm::perspective(glm::radians(camera.mFov), camera.mScreenWidth / camera.mScreenHeight, sliceNear, split) * view;
+                        bool stale;
+                        fit(i, slice, stale);
+
+                        // a dynamic caster only counts where its shadow, the box swept along the
+                        // light, reaches the slice; left out elsewhere, it never stays in a kept map
+                        mVisible.resize(mCasters.size());
+                        mBounds.cull(frustum(c.mProjectionView), mVisible);
+                        frustum sliceFrustum(slice);
+                        glm::vec3 sweep = mCasterDistance * glm::normalize(mLightDirection);
+                        bool dynamic = false;
+                        for (size_t k = 0; k < mCasters.size(); ++k) {
+                                if (!mVisible[k] || !mCasters[k].dynamic)
+                                        continue;
+                                mVisible[k] = containsSwept(sliceFrustum, mBounds.getCenter(k), mBounds.getExtents(k), sweep);
+                                dynamic |= mVisible[k] != 0;
+                        }
+
+                        c.mStats.mCached = !stale && !dynamic && !c.mHadDynamic;
+                        if (c.mStats.mCached) {
+                                c.mStats.mDraws = 0;
+                                continue;
+                        }
+
+                        if (!bound) {
+                                glBindFramebuffer(GL_FRAMEBUFFER, mFramebuffer);
+                                glDrawBuffer(GL_NONE);
+                                glReadBuffer(GL_NONE);
+                                glViewport(0, 0, mSize, mSize);
+
+                                // casters behind the near plane are clamped instead of clipped
+                                glEnable(GL_DEPTH_CLAMP);
+                                glEnable(GL_POLYGON_OFFSET_FILL);
+                                glPolygonOffset(1.5f, 4.0f);
+                                mProgram.use();
+                                bound = true;
+                        }
+                        draw(i);
+                        c.mHadDynamic = dynamic;
+                }
+
+                if (bound) {
+                        glDisable(GL_POLYGON_OFFSET_FILL);
+                        glDisable(GL_DEPTH_CLAMP);
+                        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+                        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+                }
+
+                mCasters.clear();
+                mBounds.clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::attach(program& p) const
+        {
+                p.uniform("uShadowMap", SHADOW_MAP_UNIT);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::uniforms(program& p) const
+        {
+                // from world space to the map's texture coordinates and depth
+                const glm::mat4 bias = glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.5f)), glm::vec3(0.5f));
+
+                glm::vec4 splits(0.0f), texels(0.0f);
+                for (int i = 0; i < mCount; ++i) {
+                        p.uniform("uShadowMatrices[" + std::to_string(i) + ']', bias * mCascades[i].mProjectionView);
+                        splits[i] = mCascades[i].mStats.mSplit;
+                        texels[i] = mCascades[i].mTexel;
+                }
+                p.uniform("uShadowSplits", splits);
+                p.uniform("uShadowTexels", texels);
+                p.uniform("uShadowDepthPlane", mDepthPlane);
+                p.uniform("uShadowCascades", mCount);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void shadow_cascades::bind() const
+        {
+                glstate().bindTexture(SHADOW_MAP_UNIT, GL_TEXTURE_2D_ARRAY, mTexture);
+        }
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "culling.h"
+#include "fpscamera.h"
+#include "glmesh.h"
+#include "glprogram.h"
+#include "lights.h"
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // texture unit of the shadow map array, after the gbuffer's
+        constexpr int SHADOW_MAP_UNIT                   = 10;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // frames of GPU timestamps in flight per cascade before a render goes unmeasured
+        constexpr int SHADOW_QUERY_FRAMES               = 4;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct shadow_cascade_stats
+        {
+                float mSplit                    = 0.0f; // far end, as distance along the view direction
+                size_t mDraws                   = 0;    // casters drawn this frame, 0 when the cascade was kept
+                bool mCached                    = false;  // kept from an earlier frame
+                double mTime                    = 0.0;  // GPU milliseconds of the latest measured render
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // shadow maps of one dir_light over slices of the camera frustum; a cascade is kept
+        // while its last render still covers the slice, the light hasn't moved, invalidate()
+        // wasn't called and no dynamic caster was or is in it, so the far cascades, which
+        // get a margin to move in, are usually redrawn only when the static scene changes.
+        // The depth program has to be phong.glsl with shader_features::mDepthOnly and uPVM
+        class shadow_cascades
+        {
+                struct caster
+                {
+                        const mesh* m;
+                        glm::mat4 model;
+                        bool dynamic;
+                };
+
+                struct cascade
+                {
+                        glm::mat4 mProjectionView = glm::mat4(1.0f);    // of the texels in the map
+                        glm::vec3 mCenter = glm::vec3(0.0f);            // light space, snapped to texels
+                        float mRadius = 0.0f;
+                        float mTexel = 0.0f;                            // world size of a texel
+                        bool mValid = false;
+                        bool mHadDynamic = false;
+
+                        unsigned mQueries[SHADOW_QUERY_FRAMES][2];
+                        bool mInFlight[SHADOW_QUERY_FRAMES] = {};
+                        int mNextQuery = 0;
+
+                        shadow_cascade_stats mStats;
+                };
+
+                program& mProgram;
+                uniform_handle<glm::mat4> mPVM;
+                int mSize;
+                int mCount;
+
+                unsigned mTexture;
+                unsigned mFramebuffer;
+
+                float mMaxDistance = 200.0f;
+                float mLambda = 0.75f;
+                float mCasterDistance = 200.0f;
+                int mFirstCached;
+                float mMargin = 0.5f;
+
+                glm::vec3 mLightDirection = glm::vec3(0.0f);
+                glm::mat4 mLightView = glm::mat4(1.0f);
+                glm::vec4 mDepthPlane = glm::vec4(0.0f);
+                std::vector<cascade> mCascades;
+
+                std::vector<caster> mCasters;
+                cull_set mBounds;
+                std::vector<unsigned char> mVisible;
+
+                void fit(int i, const glm::mat4& slice, bool& stale);
+                void draw(int i);
+                void collect(cascade& c);
+        public:
+                // count cascades of size x size texels, the last two may be cached
+                explicit shadow_cascades(program& depthProgram, int size = 2048, int count = MAX_SHADOW_CASCADES);
+                ~shadow_cascades();
+
+                shadow_cascades(const shadow_cascades&) = delete;
+                shadow_cascades& operator=(const shadow_cascades&) = delete;
+
+                // every caster of the frame, static ones too, so a redrawn cascade is complete
+                void submit(const mesh& m, const glm::mat4& model, bool dynamic = false);
+
+                // fits the cascades to the camera and redraws the stale ones, then restores
+                // the framebuffer and viewport; the casters are consumed
+                void render(const fpscamera& camera, const dir_light& light);
+
+                // after static casters were added, removed or moved
+                void invalidate();
+
+                // the program must be in use, points uShadowMap at SHADOW_MAP_UNIT
+                void attach(program& p) const;
+
+                // the cascades of the last render, per program and frame
+                void uniforms(program& p) const;
+
+                void bind() const;
+
+                // shadows end at maxDistance, lambda blends uniform (0) and logarithmic (1) splits
+                void setSplits(float maxDistance, float lambda)        { mMaxDistance = maxDistance; mLambda = lambda; invalidate(); }
+
+                // how far toward the light casters outside a cascade's slice still cast into it
+                void setCasterDistance(float distance)                  { mCasterDistance = distance; invalidate(); }
+
+                // cascades from first on are fitted with margin times their radius to spare
+                void setCaching(int first, float margin)                { mFirstCached = first; mMargin = margin; invalidate(); }
+
+                int getSize() const                                     { return mSize; }
+                int getNumCascades() const                              { return mCount; }
+                const shadow_cascade_stats& getStats(int i) const       { return mCascades[i].mStats; }
+        };
+}
@@ -0,0 +1,64 @@
+#include "glstate.h"
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        void state_cache::forgetProgram(unsigned id)
+        {
+                // a deleted program stays in use until another one replaces it
+                if (id && mProgram == id)
+                        mProgram = UNKNOWN_BINDING;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void state_cache::forgetVertexArray(unsigned id)
+        {
+                if (id && mVao == id) {
+                        mVao = 0;
+                        mBuffers[findBufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN_BINDING;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void state_cache::forgetBuffer(unsigned id)
+        {
+                if (!id)
+                        return;
+                for (unsigned& buffer : mBuffers)
+                        if (buffer == id)
+                                buffer = 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void state_cache::forgetTexture(unsigned id)
+        {
+                if (!id)
+                        return;
+                for (auto& unit : mTextures)
+                        for (unsigned& texture : unit)
+                                if (texture == id)
+                                        texture = 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void state_cache::invalidate()
+        {
+                mProgram        = UNKNOWN_BINDING;
+                mVao            = UNKNOWN_BINDING;
+                mActiveUnit     = -1;
+                for (unsigned& buffer : mBuffers)
+                        buffer = UNKNOWN_BINDING;
+                mTextures.clear();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        unsigned state_cache::getProgram()
+        {
+                if (mProgram == UNKNOWN_BINDING) {
+                        int current = 0;
+                        glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+                        mProgram = static_cast<unsigned>(current);
+                }
+                return mProgram;
+        }
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // a binding the cache can't vouch for, the next bind always reaches GL
+        constexpr unsigned UNKNOWN_BINDING              = ~0u;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct state_counter
+        {
+                size_t mIssued                          = 0;
+                size_t mSkipped                         = 0;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct state_stats
+        {
+                state_counter mPrograms;
+                state_counter mVaos;
+                state_counter mBuffers;
+                state_counter mActiveTextures;
+                state_counter mTextures;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // shadow of the bindings of the one GL context, every bind in al::gl goes through it
+        class state_cache
+        {
+                static constexpr int BUFFER_SLOTS       = 9;
+                static constexpr int TEXTURE_SLOTS      = 5;
+
+                unsigned mProgram;
+                unsigned mVao;
+                unsigned mBuffers[BUFFER_SLOTS];
+                int mActiveUnit;
+                std::vector<std::array<unsigned, TEXTURE_SLOTS>> mTextures;
+
+                state_stats mStats;
+
+                static int findBufferSlot(int target);
+                static int findTextureSlot(int target);
+
+                unsigned& texture(int unit, int slot);
+        public:
+                state_cache()                                   { invalidate(); }
+
+                void useProgram(unsigned id);
+                void bindVertexArray(unsigned id);
+                void bindBuffer(int target, unsigned id);
+                void bindBufferRange(int target, int index, unsigned id, size_t offset, size_t size);
+                void activeTexture(int unit);
+                void bindTexture(int unit, int target, unsigned id);
+
+                // binds on the active unit, for uploads that don't care which unit they use
+                void bindTexture(int target, unsigned id);
+
+                // GL drops the bindings of deleted objects, and may hand the name out again
+                void forgetProgram(unsigned id);
+                void forgetVertexArray(unsigned id);
+                void forgetBuffer(unsigned id);
+                void forgetTexture(unsigned id);
+
+                // after GL calls that bypass the cache
+                void invalidate();
+
+                unsigned getProgram();
+
+                const state_stats& getStats() const             { return mStats; }
+                void resetStats()                               { mStats = {}; }
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline state_cache& glstate()
+        {
+                static state_cache cache;
+                return cache;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::useProgram(unsigned id)
+        {
+                if (mProgram == id) {
+                        ++mStats.mPrograms.mSkipped;
+                        return;
+                }
+                glUseProgram(id);
+                mProgram = id;
+                ++mStats.mPrograms.mIssued;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::bindVertexArray(unsigned id)
+        {
+                if (mVao == id) {
+                        ++mStats.mVaos.mSkipped;
+                        return;
+                }
+                glBindVertexArray(id);
+                mVao = id;
+                ++mStats.mVaos.mIssued;
+
+                // the element array binding belongs to the vao
+                mBuffers[findBufferSlot(GL_ELEMENT_ARRAY_BUFFER)] = UNKNOWN_BINDING;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::bindBuffer(int target, unsigned id)
+        {
+                int slot = findBufferSlot(target);
+                if (slot != -1 && mBuffers[slot] == id) {
+                        ++mStats.mBuffers.mSkipped;
+                        return;
+                }
+                glBindBuffer(target, id);
+                if (slot != -1)
+                        mBuffers[slot] = id;
+                ++mStats.mBuffers.mIssued;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::bindBufferRange(int target, int index, unsigned id, size_t offset, size_t size)
+        {
+                // indexed bindings aren't tracked, but the call also binds the generic target
+                glBindBufferRange(target, index, id, offset, size);
+                int slot = findBufferSlot(target);
+                if (slot != -1)
+                        mBuffers[slot] = id;
+                ++mStats.mBuffers.mIssued;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::activeTexture(int unit)
+        {
+                if (mActiveUnit == unit) {
+                        ++mStats.mActiveTextures.mSkipped;
+                        return;
+                }
+                glActiveTexture(GL_TEXTURE0 + unit);
+                mActiveUnit = unit;
+                ++mStats.mActiveTextures.mIssued;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::bindTexture(int unit, int target, unsigned id)
+        {
+                int slot = findTextureSlot(target);
+                if (slot != -1 && texture(unit, slot) == id) {
+                        ++mStats.mTextures.mSkipped;
+                        return;
+                }
+                activeTexture(unit);
+                glBindTexture(target, id);
+                if (slot != -1)
+                        texture(unit, slot) = id;
+                ++mStats.mTextures.mIssued;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void state_cache::bindTexture(int target, unsigned id)
+        {
+                bindTexture(mActiveUnit == -1 ? 0 : mActiveUnit, target, id);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline unsigned& state_cache::texture(int unit, int slot)
+        {
+                if (static_cast<size_t>(unit) >= mTextures.size()) {
+                        std::array<unsigned, TEXTURE_SLOTS> unknown;
+                        unknown.fill(UNKNOWN_BINDING);
+                        mTextures.resize(unit + 1, unknown);
+                }
+                return mTextures[unit][slot];
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline int state_cache::findBufferSlot(int target)
+        {
+                switch (target) {
+                        case GL_ARRAY_BUFFER:                   return 0;
+                        case GL_ELEMENT_ARRAY_BUFFER:           return 1;
+                        case GL_UNIFORM_BUFFER:                 return 2;
+                        case GL_TEXTURE_BUFFER:                 return 3;
+                        case GL_PIXEL_PACK_BUFFER:              return 4;
+                        case GL_PIXEL_UNPACK_BUFFER:            return 5;
+                        case GL_DRAW_INDIRECT_BUFFER:           return 6;
+                        case GL_COPY_READ_BUFFER:               return 7;
+                        case GL_COPY_WRITE_BUFFER:              return 8;
+                        default:                                return -1;
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline int state_cache::findTextureSlot(int target)
+        {
+                switch (target) {
+                        case GL_TEXTURE_2D:                     return 0;
+                        case GL_TEXTURE_2D_ARRAY:               return 1;
+                        case GL_TEXTURE_CUBE_MAP:               return 2;
+                        case GL_TEXTURE_BUFFER:                 return 3;
+                        case GL_TEXTURE_3D:                     return 4;
+                        default:                                return -1;
+                }
+        }
+}
@@ -0,0 +1,147 @@
+#include "glstream_buffer.h"
+#include "glstate.h"
+#include "error.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // every region starts aligned for any binding offset the GL asks for
+        constexpr size_t STREAM_REGION_ALIGNMENT        = 256;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        stream_buffer::stream_buffer(int mode, size_t frameSize, bool persistent)
+                : mMode{mode},
+                  mFrameSize{(frameSize + STREAM_REGION_ALIGNMENT - 1) / STREAM_REGION_ALIGNMENT * STREAM_REGION_ALIGNMENT},
+                  mPersistent{persistent && isPersistentSupported()}
+        {
+                if (frameSize == 0)
+                        throw exception("al::gl", "stream_buffer", "stream_buffer", "frameSize must not be zero", etype::unexpected);
+
+                glGenBuffers(1, &mId);
+                glstate().bindBuffer(mMode, mId);
+                if (mPersistent) {
+                        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+                        glBufferStorage(mMode, STREAM_FRAMES * mFrameSize, nullptr, flags);
+                        mMapped = static_cast<unsigned char*>(glMapBufferRange(mMode, 0, STREAM_FRAMES * mFrameSize, flags));
+                        if (!mMapped)
+                                throw exception("al::gl", "stream_buffer", "stream_buffer", "couldn't map the buffer persistently", etype::unexpected);
+                }
+                else {
+                        glBufferData(mMode, mFrameSize, nullptr, GL_STREAM_DRAW);
+                        mStaging.resize(mFrameSize);
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        stream_buffer::~stream_buffer()
+        {
+                for (GLsync fence : mFences)
+                        if (fence)
+                                glDeleteSync(fence);
+                if (mMapped) {
+                        glstate().bindBuffer(mMode, mId);
+                        glUnmapBuffer(mMode);
+                }
+                glstate().forgetBuffer(mId);
+                glDeleteBuffers(1, &mId);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool stream_buffer::isPersistentSupported()
+        {
+                return GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void stream_buffer::begin()
+        {
+                if (mInFrame)
+                        end();
+
+                mRegion = (mRegion + 1) % STREAM_FRAMES;
+                mHead = 0;
+                mFlushed = 0;
+                mInFrame = true;
+
+                if (!mPersistent) {
+                        // the driver hands out fresh storage, the old one lives on for the GPU
+                        glstate().bindBuffer(mMode, mId);
+                        glBufferData(mMode, mFrameSize, nullptr, GL_STREAM_DRAW);
+                        return;
+                }
+
+                GLsync& fence = mFences[mRegion];
+                if (!fence)
+                        return;
+
+                // nearly always signaled already, the GPU is a frame or two behind at most
+                GLenum status = glClientWaitSync(fence, 0, 0);
+                if (status == GL_TIMEOUT_EXPIRED) {
+                        auto start = std::chrono::steady_clock::now();
+                        do
+                                status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+                        while (status == GL_TIMEOUT_EXPIRED);
+                        ++mStats.mWaits;
+                        mStats.mWaitTime += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        stream_range stream_buffer::allocate(size_t bytes, size_t alignment)
+        {
+                if (!mInFrame)
+                        throw exception("al::gl", "stream_buffer", "allocate", "allocate outside of begin() and end()", etype::unexpected);
+
+                size_t base = mPersistent ? mRegion * mFrameSize : 0;
+                size_t offset = (base + mHead + alignment - 1) / alignment * alignment - base;
+                if (offset + bytes > mFrameSize)
+                        throw exception("al::gl", "stream_buffer", "allocate", "the frame's region is full", etype::unexpected);
+
+                mHead = offset + bytes;
+                unsigned char* data = mPersistent ? mMapped + base + offset : mStaging.data() + offset;
+                return { data, base + offset, bytes };
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void stream_buffer::flush()
+        {
+                if (mPersistent || mHead == mFlushed)
+                        return;
+
+                glstate().bindBuffer(mMode, mId);
+                glBufferSubData(mMode, mFlushed, mHead - mFlushed, mStaging.data() + mFlushed);
+                mFlushed = mHead;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void stream_buffer::end()
+        {
+                if (!mInFrame)
+                        return;
+
+                flush();
+                if (mPersistent)
+                        mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+                mInFrame = false;
+
+                mStats.mUsed = mHead;
+                mStats.mPeak = std::max(mStats.mPeak, mHead);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void stream_buffer::bind() const
+        {
+                glstate().bindBuffer(mMode, mId);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void stream_buffer::bindRange(int index, const stream_range& range) const
+        {
+                glstate().bindBufferRange(mMode, index, mId, range.mOffset, range.mSize);
+        }
+}
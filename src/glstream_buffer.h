@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // regions of a stream_buffer, one is written while the GPU may still read the others
+        constexpr int STREAM_FRAMES                     = 3;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct stream_range
+        {
+                unsigned char* mData            = nullptr;      // written by the caller, valid until end()
+                size_t mOffset                  = 0;            // into the GL buffer
+                size_t mSize                    = 0;
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct stream_stats
+        {
+                size_t mUsed                    = 0;    // bytes allocated in the last frame
+                size_t mPeak                    = 0;    // most bytes any frame allocated
+                size_t mWaits                   = 0;    // frames whose region was still read by the GPU
+                double mWaitTime                = 0.0;  // milliseconds spent in those waits
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // per-frame upload ring: every frame allocates from its own region and writes the
+        // data in place. With GL 4.4 or ARB_buffer_storage the buffer is mapped once,
+        // persistently and coherently, and a fence per region keeps the CPU from writing
+        // what the GPU has yet to read; the wait only happens when the CPU runs more than
+        // STREAM_FRAMES ahead. Without them every frame orphans the buffer and the writes
+        // go out with one glBufferSubData per flush()
+        class stream_buffer
+        {
+                int mMode;
+                size_t mFrameSize;
+                bool mPersistent;
+                unsigned mId;
+
+                unsigned char* mMapped = nullptr;       // every region, persistent only
+                std::vector<unsigned char> mStaging;    // the frame's writes otherwise
+                GLsync mFences[STREAM_FRAMES] = {};
+                int mRegion = 0;
+                size_t mHead = 0;
+                size_t mFlushed = 0;
+                bool mInFrame = false;
+
+                stream_stats mStats;
+        public:
+                // frameSize bytes per frame, persistent mapping when asked for and supported
+                stream_buffer(int mode, size_t frameSize, bool persistent = true);
+                ~stream_buffer();
+
+                stream_buffer(const stream_buffer&) = delete;
+                stream_buffer& operator=(const stream_buffer&) = delete;
+
+                static bool isPersistentSupported();
+
+                // moves to the next region, waiting for the GPU to be done with it if needed
+                void begin();
+
+                // offset aligned for the range, throws when the frame's region is full
+                stream_range allocate(size_t bytes, size_t alignment = 16);
+
+                // makes the writes since the last flush visible to commands issued after it;
+                // nothing to do for a coherent mapping
+                void flush();
+
+                // fences the region, everything allocated this frame has been drawn from
+                void end();
+
+                void bind() const;
+                void bindRange(int index, const stream_range& range) const;
+
+                unsigned getId() const                          { return mId; }
+                int getMode() const                             { return mMode; }
+                size_t getFrameSize() const                     { return mFrameSize; }
+                bool isPersistent() const                       { return mPersistent; }
+                const stream_stats& getStats() const            { return mStats; }
+        };
+}
@@ -11,7 +11,7 @@ namespace al::gl
         void texture2D::load()
         {
                 glGenTextures(1, &mId);
-                glBindTexture(GL_TEXTURE_2D, mId);
+                glstate().bindTexture(GL_TEXTURE_2D, mId);
                         // default options
                         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mWrapS);
                         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mWrapT);
@@ -19,7 +19,7 @@ namespace al::gl
                         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mMagF);
                         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, mData);
                         glGenerateMipmap(GL_TEXTURE_2D);
-                glBindTexture(GL_TEXTURE_2D, 0);
+                glstate().bindTexture(GL_TEXTURE_2D, 0);
         }
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -67,6 +67,7 @@ namespace al::gl
                         for (size_t i = 0; i < size; ++i)
                                 mData[i] = other.mData[i];
 
+                        glstate().forgetTexture(mId);
                         glDeleteTextures(1, &mId);
                         load();
                 }
@@ -87,6 +88,7 @@ namespace al::gl
         texture2D& texture2D::operator=(texture2D&& other)
         {
                 if (this != &other) {
+                        glstate().forgetTexture(mId);
                         glDeleteTextures(1, &mId);
                         delete[] mData;
 
@@ -112,6 +114,7 @@ namespace al::gl
         ////////////////////////////////////////////////////////////////////////////////
         texture2D::~texture2D()
         {
+                glstate().forgetTexture(mId);
                 glDeleteTextures(1, &mId);
                 if (mData)
                         stbi_image_free(mData);
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "glstate.h"
+
 #include <glad/glad.h>
 
 #include <string>
@@ -36,8 +38,8 @@ namespace al::gl
                 texture2D(texture2D&&);
                 texture2D& operator=(texture2D&&);
 
-                void bind(int i = 0) const      { glActiveTexture(GL_TEXTURE0 + i); glBindTexture(GL_TEXTURE_2D, mId); }
-                void unbind(int i = 0) const    { glActiveTexture(GL_TEXTURE0 + i); glBindTexture(GL_TEXTURE_2D, 0); }
+                void bind(int i = 0) const      { glstate().bindTexture(i, GL_TEXTURE_2D, mId); }
+                void unbind(int i = 0) const    { glstate().bindTexture(i, GL_TEXTURE_2D, 0); }
 
                 unsigned getId() const          { return mId; }
                 int getWrapS() const            { return mWrapS; }
@@ -0,0 +1,142 @@
+#include "gluniform_blocks.h"
+#include "error.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        std140_dir_light toStd140(const dir_light& light)
+        {
+                std140_dir_light l{};
+                l.mAmbient      = light.mAmbient;
+                l.mDiffuse      = light.mDiffuse;
+                l.mSpecular     = light.mSpecular;
+                l.mDirection    = light.mDirection;
+                l.mIntensity    = light.mIntensity;
+                return l;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std140_point_light toStd140(const point_light& light)
+        {
+                std140_point_light l{};
+                l.mDiffuse      = light.mDiffuse;
+                l.mSpecular     = light.mSpecular;
+                l.mPosition     = light.mPosition;
+                l.mRange        = light.mRange;
+                l.mIntensity    = light.mIntensity;
+                l.mConstant     = light.mConstant;
+                l.mLinear       = light.mLinear;
+                l.mQuadratic    = light.mQuadratic;
+                return l;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std140_spot_light toStd140(const spot_light& light)
+        {
+                std140_spot_light l{};
+                l.mDiffuse      = light.mDiffuse;
+                l.mSpecular     = light.mSpecular;
+                l.mPosition     = light.mPosition;
+                l.mDirection    = light.mDirection;
+                l.mRange        = light.mRange;
+                l.mIntensity    = light.mIntensity;
+                l.mCutoff       = light.mCutoff;
+                l.mOuterCutoff  = light.mOuterCutoff;
+                l.mConstant     = light.mConstant;
+                l.mLinear       = light.mLinear;
+                l.mQuadratic    = light.mQuadratic;
+                return l;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        static size_t genLayout(size_t* offsets, size_t* sizes, size_t& alignmentOut)
+        {
+                int alignment = 256;
+                glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+                alignmentOut = alignment;
+
+                sizes[FRAME_BLOCK_BINDING]              = sizeof(std140_frame);
+                sizes[DIR_LIGHT_BLOCK_BINDING]          = sizeof(std140_dir_light) * MAX_DIR_LIGHTS;
+                sizes[POINT_LIGHT_BLOCK_BINDING]        = sizeof(std140_point_light) * MAX_POINT_LIGHTS;
+                sizes[SPOT_LIGHT_BLOCK_BINDING]         = sizeof(std140_spot_light) * MAX_SPOT_LIGHTS;
+
+                // each range bound with glBindBufferRange must start aligned
+                size_t offset = 0;
+                for (int i = 0; i < 4; ++i) {
+                        offsets[i] = offset;
+                        offset += sizes[i];
+                        offset = (offset + alignment - 1) / alignment * alignment;
+                }
+                return offset;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        frame_blocks::frame_blocks()
+                : mBuffer(GL_UNIFORM_BUFFER, std::vector<unsigned char>(genLayout(mOffsets, mSizes, mAlignment)), GL_DYNAMIC_DRAW) {}
+
+        ////////////////////////////////////////////////////////////////////////////////
+        frame_blocks::frame_blocks(stream_buffer& stream)
+                : frame_blocks()
+        {
+                if (stream.getMode() != GL_UNIFORM_BUFFER)
+                        throw exception("al::gl", "frame_blocks", "frame_blocks", "the stream must be a GL_UNIFORM_BUFFER", etype::unexpected);
+                mStream = &stream;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void frame_blocks::setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos)
+        {
+                mFrame.mProjection      = projection;
+                mFrame.mView            = view;
+                mFrame.mProjectionView  = projection * view;
+                mFrame.mViewPos         = viewPos;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void frame_blocks::setLights(const std::vector<dir_light>& dirLights,
+                                     const std::vector<point_light>& pointLights,
+                                     const std::vector<spot_light>& spotLights)
+        {
+                if (dirLights.size() > MAX_DIR_LIGHTS || pointLights.size() > MAX_POINT_LIGHTS || spotLights.size() > MAX_SPOT_LIGHTS)
+                        throw exception("al::gl", "frame_blocks", "setLights", "too many lights for the light blocks", etype::unexpected);
+
+                write<std140_dir_light>(DIR_LIGHT_BLOCK_BINDING, dirLights);
+                write<std140_point_light>(POINT_LIGHT_BLOCK_BINDING, pointLights);
+                write<std140_spot_light>(SPOT_LIGHT_BLOCK_BINDING, spotLights);
+
+                mFrame.mLightCounts = glm::ivec4(static_cast<int>(dirLights.size()),
+                                                 static_cast<int>(pointLights.size()),
+                                                 static_cast<int>(spotLights.size()), 0);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void frame_blocks::upload()
+        {
+                // the frame block comes first, so the range always starts at zero
+                std::memcpy(mBuffer.getData().data() + mOffsets[FRAME_BLOCK_BINDING], &mFrame, sizeof(std140_frame));
+                mUsed = std::max(mUsed, mOffsets[FRAME_BLOCK_BINDING] + sizeof(std140_frame));
+
+                if (!mStream) {
+                        mBuffer.upload(0, mUsed);
+                        mUsed = 0;
+
+                        for (int i = 0; i < 4; ++i)
+                                mBuffer.bindRange(i, mOffsets[i], mSizes[i]);
+                        return;
+                }
+
+                // the whole layout is taken so every block's range is complete, only the
+                // used part is written; its start is aligned, so are the blocks within.
+                // A new range holds nothing of the previous one, so mUsed stays the high
+                // water mark and lights set once are copied with every camera upload
+                stream_range range = mStream->allocate(mBuffer.getSizeInBytes(), mAlignment);
+                std::memcpy(range.mData, mBuffer.getData().data(), mUsed);
+                mStream->flush();
+
+                for (int i = 0; i < 4; ++i)
+                        mStream->bindRange(i, { nullptr, range.mOffset + mOffsets[i], mSizes[i] });
+        }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "glbuffer.h"
+#include "glstream_buffer.h"
+#include "lights.h"
+
+#include <glad/glad.h>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace al::gl
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // fixed binding points, shared by every program that declares the block
+        constexpr int FRAME_BLOCK_BINDING               = 0;
+        constexpr int DIR_LIGHT_BLOCK_BINDING           = 1;
+        constexpr int POINT_LIGHT_BLOCK_BINDING         = 2;
+        constexpr int SPOT_LIGHT_BLOCK_BINDING          = 3;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline int findBlockBinding(const std::string& name)
+        {
+                if (name == "frame_block")
+                        return FRAME_BLOCK_BINDING;
+                if (name == "dir_light_block")
+                        return DIR_LIGHT_BLOCK_BINDING;
+                if (name == "point_light_block")
+                        return POINT_LIGHT_BLOCK_BINDING;
+                if (name == "spot_light_block")
+                        return SPOT_LIGHT_BLOCK_BINDING;
+                return -1;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // std140 mirrors, vec3 members are padded to 16 bytes unless a float follows
+        struct std140_frame
+        {
+                glm::mat4 mProjection;
+                glm::mat4 mView;
+                glm::mat4 mProjectionView;
+                glm::vec3 mViewPos;
+                float mPad0;
+                glm::ivec4 mLightCounts;
+        };
+        static_assert(sizeof(std140_frame) == 224);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct std140_dir_light
+        {
+                glm::vec3 mAmbient;
+                float mPad0;
+                glm::vec3 mDiffuse;
+                float mPad1;
+                glm::vec3 mSpecular;
+                float mPad2;
+                glm::vec3 mDirection;
+                float mIntensity;
+        };
+        static_assert(sizeof(std140_dir_light) == 64);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct std140_point_light
+        {
+                glm::vec3 mDiffuse;
+                float mPad0;
+                glm::vec3 mSpecular;
+                float mPad1;
+                glm::vec3 mPosition;
+                float mRange;
+                float mIntensity;
+                float mConstant;
+                float mLinear;
+                float mQuadratic;
+        };
+        static_assert(sizeof(std140_point_light) == 64);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        struct std140_spot_light
+        {
+                glm::vec3 mDiffuse;
+                float mPad0;
+                glm::vec3 mSpecular;
+                float mPad1;
+                glm::vec3 mPosition;
+                float mPad2;
+                glm::vec3 mDirection;
+                float mRange;
+                float mIntensity;
+                float mCutoff;
+                float mOuterCutoff;
+                float mConstant;
+                float mLinear;
+                float mQuadratic;
+                float mPad3;
+                float mPad4;
+        };
+        static_assert(sizeof(std140_spot_light) == 96);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std140_dir_light toStd140(const dir_light& light);
+        std140_point_light toStd140(const point_light& light);
+        std140_spot_light toStd140(const spot_light& light);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // per-frame camera and light data, sent with one glBufferSubData, or written into
+        // a stream_buffer so uploading again while earlier draws are in flight never stalls
+        class frame_blocks
+        {
+                size_t mOffsets[4];
+                size_t mSizes[4];
+                size_t mAlignment;
+                buffer<unsigned char> mBuffer;
+                stream_buffer* mStream = nullptr;
+
+                std140_frame mFrame{};
+                size_t mUsed = 0;               // bytes to send, reset by each upload unless streamed
+
+                template <typename T, typename L>
+                void write(int binding, const std::vector<L>& lights);
+        public:
+                frame_blocks();
+
+                // each upload() takes a new range of the stream's frame, which has to be
+                // a GL_UNIFORM_BUFFER between its begin() and end()
+                explicit frame_blocks(stream_buffer& stream);
+
+                void setCamera(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos);
+                void setLights(const std::vector<dir_light>& dirLights,
+                               const std::vector<point_light>& pointLights,
+                               const std::vector<spot_light>& spotLights);
+
+                void upload();
+
+                unsigned getId() const          { return mStream ? mStream->getId() : mBuffer.getId(); }
+                size_t getSizeInBytes() const   { return mBuffer.getSizeInBytes(); }
+        };
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <typename T, typename L>
+        void frame_blocks::write(int binding, const std::vector<L>& lights)
+        {
+                unsigned char* dst = mBuffer.getData().data() + mOffsets[binding];
+                for (const L& light : lights) {
+                        T l = toStd140(light);
+                        std::memcpy(dst, &l, sizeof(T));
+                        dst += sizeof(T);
+                }
+                if (!lights.empty())
+                        mUsed = std::max(mUsed, mOffsets[binding] + lights.size() * sizeof(T));
+        }
+}
@@ -24,4 +24,16 @@ namespace al::gl::utils
                                 return -1;
                 }
         }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline bool hasProgramBinary()
+        {
+                return GLAD_GL_VERSION_4_1 || GLAD_GL_ARB_get_program_binary;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline bool hasParallelCompile()
+        {
+                return GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+        }
 }
@@ -1,10 +1,12 @@
 #pragma once
 
 #include "glbuffer.h"
+#include "glstate.h"
 #include "glutils.h"
 
 #include <glad/glad.h>
 
+#include <cstdint>
 #include <vector>
 
 namespace al::gl
@@ -18,8 +20,26 @@ namespace al::gl
                 int normalized;
                 int stride;
                 void* offset;
+
+                // 0 advances per vertex, n advances once every n instances
+                unsigned divisor        = 0;
         };
 
+        ////////////////////////////////////////////////////////////////////////////////
+        // the buffer bound to GL_ARRAY_BUFFER is the one read by the attribute
+        inline void enableAttribute(const vao_info& info)
+        {
+                bool integer = info.type == GL_INT || info.type == GL_UNSIGNED_INT || info.type == GL_SHORT ||
+                               info.type == GL_UNSIGNED_SHORT || info.type == GL_BYTE || info.type == GL_UNSIGNED_BYTE;
+
+                if (integer && !info.normalized)
+                        glVertexAttribIPointer(info.index, info.size, info.type, info.stride, info.offset);
+                else
+                        glVertexAttribPointer(info.index, info.size, info.type, info.normalized, info.stride, info.offset);
+                glVertexAttribDivisor(info.index, info.divisor);
+                glEnableVertexAttribArray(info.index);
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         template <typename VT, typename IT>
         class vao
@@ -30,11 +50,14 @@ namespace al::gl
 
                 std::vector<vao_info> mInfos;
 
+                // key of the per-instance buffer attached last, 0 when there is none
+                mutable std::uint64_t mInstances = 0;
+
                 void load();
         public:
                 vao(buffer<VT>&& vbo, buffer<IT>&& ebo, const std::vector<vao_info>& infos);
 
-                ~vao()                          { glDeleteVertexArrays(1, &mId); }
+                ~vao()                          { glstate().forgetVertexArray(mId); glDeleteVertexArrays(1, &mId); }
 
                 vao(const vao&);
                 vao& operator=(const vao&);
@@ -44,26 +67,68 @@ namespace al::gl
 
                 unsigned getId() const          { return mId; }
 
-                void bind() const               { glBindVertexArray(mId); }
-                void unbind() const             { glBindVertexArray(0); }
+                const buffer<VT>& getVbo() const                { return mVbo; }
+                const buffer<IT>& getEbo() const                { return mEbo; }
+                const std::vector<vao_info>& getInfos() const   { return mInfos; }
+
+                void bind() const               { glstate().bindVertexArray(mId); }
+                void unbind() const             { glstate().bindVertexArray(0); }
+
+                // points the per-instance attributes at vbo, skipped when key is already attached
+                template <typename T>
+                void attach(const buffer<T>& vbo, const std::vector<vao_info>& infos, std::uint64_t key) const;
+
+                // disables the attributes, they then read the values set by glVertexAttrib*
+                void detach(const std::vector<vao_info>& infos) const;
 
                 void draw(int mode = GL_TRIANGLES) const { glDrawElements(mode, mEbo.getSize(), utils::findEboType<IT>(), nullptr); }
+
+                void drawInstanced(size_t count, int mode = GL_TRIANGLES) const
+                {
+                        glDrawElementsInstanced(mode, mEbo.getSize(), utils::findEboType<IT>(), nullptr, static_cast<int>(count));
+                }
         };
 
+        ////////////////////////////////////////////////////////////////////////////////
+        template <typename VT, typename IT>
+        template <typename T>
+        void vao<VT, IT>::attach(const buffer<T>& vbo, const std::vector<vao_info>& infos, std::uint64_t key) const
+        {
+                if (mInstances == key)
+                        return;
+
+                bind();
+                vbo.bind();
+                for (const vao_info& info : infos)
+                        enableAttribute(info);
+                mInstances = key;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        template <typename VT, typename IT>
+        void vao<VT, IT>::detach(const std::vector<vao_info>& infos) const
+        {
+                if (mInstances == 0)
+                        return;
+
+                bind();
+                for (const vao_info& info : infos)
+                        glDisableVertexAttribArray(info.index);
+                mInstances = 0;
+        }
+
         ////////////////////////////////////////////////////////////////////////////////
         template <typename VT, typename IT>
         void vao<VT, IT>::load()
         {
                 glGenVertexArrays(1, &mId);
-                glBindVertexArray(mId);
+                glstate().bindVertexArray(mId);
                         mVbo.bind();
-                        for (const vao_info& info : mInfos) {
-                                glVertexAttribPointer(info.index, info.size, info.type, info.normalized, info.stride, info.offset);
-                                glEnableVertexAttribArray(info.index);
-                        }
+                        for (const vao_info& info : mInfos)
+                                enableAttribute(info);
                         mVbo.unbind();
                         mEbo.bind();
-                glBindVertexArray(0);
+                glstate().bindVertexArray(0);
                 mEbo.unbind();
         }
 
@@ -88,11 +153,13 @@ namespace al::gl
         vao<VT, IT>& vao<VT, IT>::operator=(const vao<VT, IT>& other)
         {
                 if (this != &other) {
+                        glstate().forgetVertexArray(mId);
                         glDeleteVertexArrays(1, &mId);
 
-                        mVbo    = other.mVbo;
-                        mEbo    = other.mEbo;
-                        mInfos  = other.mInfos;
+                        mVbo            = other.mVbo;
+                        mEbo            = other.mEbo;
+                        mInfos          = other.mInfos;
+                        mInstances      = 0;
 
                         load();
                 }
@@ -102,9 +169,11 @@ namespace al::gl
         ////////////////////////////////////////////////////////////////////////////////
         template <typename VT, typename IT>
         vao<VT, IT>::vao(vao<VT, IT>&& other)
-                : mId{other.mId}, mVbo{std::move(other.mVbo)}, mEbo{std::move(other.mEbo)}, mInfos{std::move(other.mInfos)}
+                : mId{other.mId}, mVbo{std::move(other.mVbo)}, mEbo{std::move(other.mEbo)}, mInfos{std::move(other.mInfos)},
+                  mInstances{other.mInstances}
         {
                 other.mId = 0;
+                other.mInstances = 0;
         }
 
         ////////////////////////////////////////////////////////////////////////////////
@@ -112,14 +181,17 @@ namespace al::gl
         vao<VT, IT>& vao<VT, IT>::operator=(vao<VT, IT>&& other)
         {
                 if (this != &other) {
+                        glstate().forgetVertexArray(mId);
                         glDeleteVertexArrays(1, &mId);
 
                         mId             = other.mId;
                         mVbo            = std::move(other.mVbo);
                         mEbo            = std::move(other.mEbo);
                         mInfos          = std::move(other.mInfos);
+                        mInstances      = other.mInstances;
 
-                        other.mId       = 0;
+                        other.mId               = 0;
+                        other.mInstances        = 0;
                 }
                 return *this;
         }
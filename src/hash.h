@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        constexpr std::uint64_t HASH_SEED = 0xcbf29ce484222325ull;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // FNV-1a, stable across runs and platforms (unlike std::hash)
+        inline std::uint64_t hash(const void* data, std::size_t size, std::uint64_t seed = HASH_SEED)
+        {
+                const unsigned char* bytes = static_cast<const unsigned char*>(data);
+                std::uint64_t h = seed;
+                for (std::size_t i = 0; i < size; ++i) {
+                        h ^= bytes[i];
+                        h *= 0x100000001b3ull;
+                }
+                return h;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline std::uint64_t hash(const std::string& s, std::uint64_t seed = HASH_SEED)
+        {
+                return hash(s.data(), s.size(), seed);
+        }
+}
@@ -4,6 +4,8 @@
 
 #include <fstream>
 #include <string>
+#include <vector>
+#include <iterator>
 
 namespace al
 {
@@ -18,5 +20,39 @@ namespace al
                 }
                 throw exception("al", "", "read", "error reading file " + url, etype::unexpected);
         }
-}
 
+        ////////////////////////////////////////////////////////////////////////////////
+        inline std::vector<char> readBinary(const std::string& url)
+        {
+                if (std::ifstream f{url, std::ios::binary})
+                        return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+                throw exception("al", "", "readBinary", "error reading file " + url, etype::unexpected);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        inline void writeBinary(const std::string& url, const std::vector<char>& data)
+        {
+                std::ofstream f{url, std::ios::binary | std::ios::trunc};
+                if (!f || !f.write(data.data(), static_cast<std::streamsize>(data.size())))
+                        throw exception("al", "", "writeBinary", "error writing file " + url, etype::unexpected);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // binary PPM of RGBA8 pixels, alpha dropped; GL reads rows bottom first, so they
+        // are written in reverse unless flip is false
+        inline void writePPM(const std::string& url, int width, int height, const unsigned char* rgba, bool flip = true)
+        {
+                std::string header = "P6\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+                std::vector<char> data(header.begin(), header.end());
+                data.reserve(header.size() + static_cast<size_t>(width) * height * 3);
+                for (int y = 0; y < height; ++y) {
+                        const unsigned char* row = rgba + static_cast<size_t>(flip ? height - 1 - y : y) * width * 4;
+                        for (int x = 0; x < width; ++x) {
+                                data.push_back(static_cast<char>(row[4 * x + 0]));
+                                data.push_back(static_cast<char>(row[4 * x + 1]));
+                                data.push_back(static_cast<char>(row[4 * x + 2]));
+                        }
+                }
+                writeBinary(url, data);
+        }
+}
@@ -0,0 +1,173 @@
+#include "light_grid.h"
+#include "error.h"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+#ifdef __SSE__
+#include <immintrin.h>
+#endif
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        light_grid::light_grid(int x, int y, int z, worker_pool* workers)
+                : mX{x}, mY{y}, mZ{z}, mWorkers{workers}
+        {
+                if (x <= 0 || y <= 0 || z <= 0 || x > 0xffff || y > 0xffff)
+                        throw exception("al", "light_grid", "light_grid", "invalid cluster counts", etype::unexpected);
+
+                size_t clusters = static_cast<size_t>(x) * y * z;
+                mMinX.resize(clusters); mMinY.resize(clusters); mMinZ.resize(clusters);
+                mMaxX.resize(clusters); mMaxY.resize(clusters); mMaxZ.resize(clusters);
+                mLists.resize(clusters);
+                mPointCounts.resize(clusters);
+                mCells.resize(2 * clusters);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void light_grid::setProjection(float fov, float aspect, float near, float far)
+        {
+                glm::vec4 projection(fov, aspect, near, far);
+                if (projection == mProjection)
+                        return;
+                mProjection = projection;
+
+                float tanY = std::tan(glm::radians(fov) * 0.5f);
+                float tanX = tanY * aspect;
+                for (int k = 0; k < mZ; ++k) {
+                        float zn = near * std::pow(far / near, static_cast<float>(k) / mZ);
+                        float zf = near * std::pow(far / near, static_cast<float>(k + 1) / mZ);
+                        for (int j = 0; j < mY; ++j) {
+                                float y0 = (-1.0f + 2.0f * j / mY) * tanY;
+                                float y1 = (-1.0f + 2.0f * (j + 1) / mY) * tanY;
+                                for (int i = 0; i < mX; ++i) {
+                                        float x0 = (-1.0f + 2.0f * i / mX) * tanX;
+                                        float x1 = (-1.0f + 2.0f * (i + 1) / mX) * tanX;
+
+                                        // the side planes spread with depth, the box spans both ends
+                                        size_t c = (static_cast<size_t>(k) * mY + j) * mX + i;
+                                        mMinX[c] = std::min(x0 * zn, x0 * zf);
+                                        mMaxX[c] = std::max(x1 * zn, x1 * zf);
+                                        mMinY[c] = std::min(y0 * zn, y0 * zf);
+                                        mMaxY[c] = std::max(y1 * zn, y1 * zf);
+                                        mMinZ[c] = -zf;
+                                        mMaxZ[c] = -zn;
+                                }
+                        }
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        float light_grid::getDepthScale() const
+        {
+                return mZ / std::log(mProjection.w / mProjection.z);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        float light_grid::getDepthBias() const
+        {
+                return -mZ * std::log(mProjection.z) / std::log(mProjection.w / mProjection.z);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void light_grid::binSlice(int slice)
+        {
+                size_t first = static_cast<size_t>(slice) * mX * mY;
+                size_t last = first + static_cast<size_t>(mX) * mY;
+                float zn = -mMaxZ[first];
+                float zf = -mMinZ[first];
+
+                for (size_t c = first; c < last; ++c) {
+                        mLists[c].clear();
+                        mPointCounts[c] = 0;
+                }
+
+                for (size_t l = 0; l < mLightX.size(); ++l) {
+                        float x = mLightX[l], y = mLightY[l], z = mLightZ[l], r = mLightRadius[l];
+                        if (-z + r < zn || -z - r > zf)
+                                continue;
+
+                        bool point = l < mNumPoints;
+                        auto index = static_cast<std::uint32_t>(point ? l : l - mNumPoints);
+                        auto add = [&](size_t c) {
+                                mLists[c].push_back(index);
+                                if (point)
+                                        ++mPointCounts[c];
+                        };
+
+                        // squared distance from the sphere center to each box, 4 boxes at a time
+                        size_t c = first;
+#ifdef __SSE__
+                        const __m128 zero = _mm_setzero_ps();
+                        __m128 cx = _mm_set1_ps(x), cy = _mm_set1_ps(y), cz = _mm_set1_ps(z);
+                        __m128 r2 = _mm_set1_ps(r * r);
+                        for (; c + 4 <= last; c += 4) {
+                                __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(mMinX.data() + c), cx), _mm_sub_ps(cx, _mm_loadu_ps(mMaxX.data() + c))), zero);
+                                __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(mMinY.data() + c), cy), _mm_sub_ps(cy, _mm_loadu_ps(mMaxY.data() + c))), zero);
+                                __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(mMinZ.data() + c), cz), _mm_sub_ps(cz, _mm_loadu_ps(mMaxZ.data() + c))), zero);
+                                __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                                int mask = _mm_movemask_ps(_mm_cmple_ps(d2, r2));
+                                for (; mask; mask &= mask - 1)
+                                        add(c + __builtin_ctz(mask));
+                        }
+#endif
+                        for (; c < last; ++c) {
+                                float dx = std::max({mMinX[c] - x, x - mMaxX[c], 0.0f});
+                                float dy = std::max({mMinY[c] - y, y - mMaxY[c], 0.0f});
+                                float dz = std::max({mMinZ[c] - z, z - mMaxZ[c], 0.0f});
+                                if (dx * dx + dy * dy + dz * dz <= r * r)
+                                        add(c);
+                        }
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void light_grid::build(const glm::mat4& view, const std::vector<point_light>& pointLights, const std::vector<spot_light>& spotLights)
+        {
+                if (pointLights.size() > 0xffff || spotLights.size() > 0xffff)
+                        throw exception("al", "light_grid", "build", "too many lights for the cluster counts", etype::unexpected);
+
+                // spot lights are bounded by the sphere of their range
+                size_t count = pointLights.size() + spotLights.size();
+                mLightX.resize(count);
+                mLightY.resize(count);
+                mLightZ.resize(count);
+                mLightRadius.resize(count);
+                mNumPoints = pointLights.size();
+                auto place = [&](size_t l, const glm::vec3& position, float range) {
+                        glm::vec4 p = view * glm::vec4(position, 1.0f);
+                        mLightX[l] = p.x;
+                        mLightY[l] = p.y;
+                        mLightZ[l] = p.z;
+                        mLightRadius[l] = range;
+                };
+                for (size_t l = 0; l < pointLights.size(); ++l)
+                        place(l, pointLights[l].mPosition, pointLights[l].mRange);
+                for (size_t l = 0; l < spotLights.size(); ++l)
+                        place(mNumPoints + l, spotLights[l].mPosition, spotLights[l].mRange);
+
+                // slices own disjoint clusters, they are binned in parallel without locks
+                auto task = [this](size_t slice) { binSlice(static_cast<int>(slice)); };
+                if (mWorkers)
+                        mWorkers->run(mZ, task);
+                else
+                        for (int slice = 0; slice < mZ; ++slice)
+                                task(slice);
+
+                std::uint32_t offset = 0;
+                for (size_t c = 0; c < mLists.size(); ++c) {
+                        auto spots = static_cast<std::uint32_t>(mLists[c].size() - mPointCounts[c]);
+                        mCells[2 * c + 0] = offset;
+                        mCells[2 * c + 1] = mPointCounts[c] | (spots << 16);
+                        offset += static_cast<std::uint32_t>(mLists[c].size());
+                }
+
+                mIndices.resize(offset);
+                for (size_t c = 0; c < mLists.size(); ++c)
+                        std::copy(mLists[c].begin(), mLists[c].end(), mIndices.begin() + mCells[2 * c]);
+        }
+}
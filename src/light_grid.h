@@ -0,0 +1,70 @@
+#pragma once
+
+#include "lights.h"
+#include "worker_pool.h"
+
+#include <glm/vec4.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // default froxels: screen tiles across, exponential depth slices front to back
+        constexpr int LIGHT_GRID_X              = 16;
+        constexpr int LIGHT_GRID_Y              = 9;
+        constexpr int LIGHT_GRID_Z              = 24;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // point and spot lights binned into the clusters of a perspective view frustum;
+        // each cluster lists its point lights, then its spot lights, in one index array
+        class light_grid
+        {
+                int mX, mY, mZ;
+                worker_pool* mWorkers;
+
+                // fov, aspect, near and far the boxes were built for
+                glm::vec4 mProjection = glm::vec4(0.0f);
+
+                // view space boxes of the clusters, one array per component
+                std::vector<float> mMinX, mMinY, mMinZ;
+                std::vector<float> mMaxX, mMaxY, mMaxZ;
+
+                // view space spheres, the point lights then the spot lights
+                std::vector<float> mLightX, mLightY, mLightZ, mLightRadius;
+                size_t mNumPoints = 0;
+
+                std::vector<std::vector<std::uint32_t>> mLists;
+                std::vector<std::uint16_t> mPointCounts;
+
+                std::vector<std::uint32_t> mCells;
+                std::vector<std::uint32_t> mIndices;
+
+                void binSlice(int slice);
+        public:
+                // without workers every slice is binned on the caller
+                light_grid(int x = LIGHT_GRID_X, int y = LIGHT_GRID_Y, int z = LIGHT_GRID_Z, worker_pool* workers = nullptr);
+
+                // vertical fov in degrees as in fpscamera, the boxes are rebuilt only when it changes
+                void setProjection(float fov, float aspect, float near, float far);
+
+                void build(const glm::mat4& view, const std::vector<point_light>& pointLights, const std::vector<spot_light>& spotLights);
+
+                // two per cluster: the first index, then the point count | the spot count << 16;
+                // spot indices count from the first spot light
+                const std::vector<std::uint32_t>& getCells() const      { return mCells; }
+                const std::vector<std::uint32_t>& getIndices() const    { return mIndices; }
+
+                int getX() const                                        { return mX; }
+                int getY() const                                        { return mY; }
+                int getZ() const                                        { return mZ; }
+                size_t size() const                                     { return mLists.size(); }
+
+                // slice = log(depth) * scale + bias
+                float getDepthScale() const;
+                float getDepthBias() const;
+        };
+}
@@ -4,6 +4,20 @@
 
 namespace al
 {
+        ////////////////////////////////////////////////////////////////////////////////
+        // capacities of the light uniform blocks, each block fits in the 16KB minimum
+        constexpr int MAX_DIR_LIGHTS            = 16;
+        constexpr int MAX_POINT_LIGHTS          = 256;
+        constexpr int MAX_SPOT_LIGHTS           = 128;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // shadow map layers of the first dir_light, see al::gl::shadow_cascades
+        constexpr int MAX_SHADOW_CASCADES       = 4;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // texels of a light's record in a gl::shadow_atlas, a header and a matrix per cube face
+        constexpr int SHADOW_ATLAS_TEXELS       = 1 + 6 * 4;
+
         ////////////////////////////////////////////////////////////////////////////////
         struct dir_light
         {
@@ -29,6 +43,9 @@ namespace al
                 float mLinear;
                 float mQuadratic;
 
+                // slot in a gl::shadow_atlas, -1 casts no shadow
+                int mShadow = -1;
+
                 // source: https://wiki.ogre3d.org/Light+Attenuation+Shortcut
                 void recalculateTerms(float constant = 1.0f)
                 {
@@ -56,6 +73,9 @@ namespace al
                 float mLinear;
                 float mQuadratic;
 
+                // slot in a gl::shadow_atlas, -1 casts no shadow
+                int mShadow = -1;
+
                 // source: https://wiki.ogre3d.org/Light+Attenuation+Shortcut
                 void recalculateTerms(float constant = 1.0f)
                 {
@@ -0,0 +1,303 @@
+#include "occlusion.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#ifdef __SSE__
+#include <immintrin.h>
+#endif
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // clamped before the cast, projected coordinates can be far out of int range
+        static int toPixel(float v, int size)
+        {
+                return static_cast<int>(std::floor(std::clamp(v, -1.0f, static_cast<float>(size))));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        std::vector<size_t> selectOccluders(const std::vector<bounds>& meshBounds, const std::vector<size_t>& triangles, size_t budget)
+        {
+                std::vector<float> areas(meshBounds.size());
+                for (size_t i = 0; i < meshBounds.size(); ++i) {
+                        glm::vec3 d = meshBounds[i].mMax - meshBounds[i].mMin;
+                        areas[i] = d.x * d.y + d.y * d.z + d.z * d.x;
+                }
+
+                std::vector<size_t> order(meshBounds.size());
+                std::iota(order.begin(), order.end(), 0);
+                std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return areas[a] > areas[b]; });
+
+                std::vector<size_t> occluders;
+                for (size_t i : order) {
+                        if (triangles[i] > budget)
+                                continue;
+                        budget -= triangles[i];
+                        occluders.push_back(i);
+                }
+                return occluders;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        occlusion_buffer::occlusion_buffer(int width, int height, worker_pool* workers)
+                : mTilesX{(width + OCCLUSION_TILE_WIDTH - 1) / OCCLUSION_TILE_WIDTH},
+                  mTilesY{(height + OCCLUSION_TILE_HEIGHT - 1) / OCCLUSION_TILE_HEIGHT},
+                  mWorkers{workers}, mProjectionView{1.0f}
+        {
+                mWidth = mTilesX * OCCLUSION_TILE_WIDTH;
+                mHeight = mTilesY * OCCLUSION_TILE_HEIGHT;
+                mDepth.assign(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+                mTileMax.assign(static_cast<size_t>(mTilesX) * mTilesY, 1.0f);
+                mBins.resize(mTileMax.size());
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_buffer::begin(const glm::mat4& projectionView)
+        {
+                mProjectionView = projectionView;
+                mTriangles.clear();
+                std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+                std::fill(mTileMax.begin(), mTileMax.end(), 1.0f);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_buffer::addOccluder(const float* vertices, size_t stride, size_t offset,
+                                           const unsigned* indices, size_t count, const glm::mat4& model)
+        {
+                glm::mat4 m = mProjectionView * model;
+                auto project = [&](unsigned index) {
+                        const float* p = vertices + index * stride + offset;
+                        return m * glm::vec4(p[0], p[1], p[2], 1.0f);
+                };
+
+                for (size_t i = 0; i + 2 < count; i += 3)
+                        clipTriangle(project(indices[i]), project(indices[i + 1]), project(indices[i + 2]));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // only the near plane is clipped, the others are handled by the tile bounds
+        void occlusion_buffer::clipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+        {
+                const glm::vec4 in[3] = { a, b, c };
+                float d[3] = { a.z + a.w, b.z + b.w, c.z + c.w };
+
+                if (d[0] >= 0.0f && d[1] >= 0.0f && d[2] >= 0.0f) {
+                        addTriangle(a, b, c);
+                        return;
+                }
+                if (d[0] < 0.0f && d[1] < 0.0f && d[2] < 0.0f)
+                        return;
+
+                glm::vec4 out[4];
+                int n = 0;
+                for (int i = 0; i < 3; ++i) {
+                        int j = (i + 1) % 3;
+                        if (d[i] >= 0.0f)
+                                out[n++] = in[i];
+                        if ((d[i] >= 0.0f) != (d[j] >= 0.0f)) {
+                                float t = d[i] / (d[i] - d[j]);
+                                out[n++] = in[i] + (in[j] - in[i]) * t;
+                        }
+                }
+
+                for (int i = 1; i + 1 < n; ++i)
+                        addTriangle(out[0], out[i], out[i + 1]);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_buffer::addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c)
+        {
+                screen_triangle t;
+                const glm::vec4* v[3] = { &a, &b, &c };
+                for (int i = 0; i < 3; ++i) {
+                        float w = std::max(v[i]->w, 1e-6f);
+                        t.x[i] = (v[i]->x / w * 0.5f + 0.5f) * mWidth;
+                        t.y[i] = (v[i]->y / w * 0.5f + 0.5f) * mHeight;
+                        t.z[i] = v[i]->z / w * 0.5f + 0.5f;
+                }
+
+                float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+                if (std::abs(area) < 1e-6f)
+                        return;
+
+                // counter-clockwise from here on, so inside is where every edge function is positive
+                if (area < 0.0f) {
+                        std::swap(t.x[1], t.x[2]);
+                        std::swap(t.y[1], t.y[2]);
+                        std::swap(t.z[1], t.z[2]);
+                }
+
+                float minX = std::min({t.x[0], t.x[1], t.x[2]}), maxX = std::max({t.x[0], t.x[1], t.x[2]});
+                float minY = std::min({t.y[0], t.y[1], t.y[2]}), maxY = std::max({t.y[0], t.y[1], t.y[2]});
+                if (maxX < 0.0f || maxY < 0.0f || minX >= mWidth || minY >= mHeight)
+                        return;
+
+                mTriangles.push_back(t);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_buffer::rasterize()
+        {
+                for (auto& bin : mBins)
+                        bin.clear();
+
+                for (size_t i = 0; i < mTriangles.size(); ++i) {
+                        const screen_triangle& t = mTriangles[i];
+                        float minX = std::min({t.x[0], t.x[1], t.x[2]}), maxX = std::max({t.x[0], t.x[1], t.x[2]});
+                        float minY = std::min({t.y[0], t.y[1], t.y[2]}), maxY = std::max({t.y[0], t.y[1], t.y[2]});
+
+                        int tx0 = std::clamp(toPixel(minX, mWidth) / OCCLUSION_TILE_WIDTH, 0, mTilesX - 1);
+                        int tx1 = std::clamp(toPixel(maxX, mWidth) / OCCLUSION_TILE_WIDTH, 0, mTilesX - 1);
+                        int ty0 = std::clamp(toPixel(minY, mHeight) / OCCLUSION_TILE_HEIGHT, 0, mTilesY - 1);
+                        int ty1 = std::clamp(toPixel(maxY, mHeight) / OCCLUSION_TILE_HEIGHT, 0, mTilesY - 1);
+                        for (int ty = ty0; ty <= ty1; ++ty)
+                                for (int tx = tx0; tx <= tx1; ++tx)
+                                        mBins[ty * mTilesX + tx].push_back(static_cast<std::uint32_t>(i));
+                }
+
+                auto task = [this](size_t tile) { rasterizeTile(tile); };
+                if (mWorkers)
+                        mWorkers->run(mBins.size(), task);
+                else
+                        for (size_t tile = 0; tile < mBins.size(); ++tile)
+                                task(tile);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void occlusion_buffer::rasterizeTile(size_t tile)
+        {
+                int tileX0 = static_cast<int>(tile % mTilesX) * OCCLUSION_TILE_WIDTH;
+                int tileY0 = static_cast<int>(tile / mTilesX) * OCCLUSION_TILE_HEIGHT;
+                int tileX1 = tileX0 + OCCLUSION_TILE_WIDTH - 1;
+                int tileY1 = tileY0 + OCCLUSION_TILE_HEIGHT - 1;
+
+                for (std::uint32_t index : mBins[tile]) {
+                        const screen_triangle& t = mTriangles[index];
+
+                        // pixels whose centers may be covered, x starts on a SIMD boundary
+                        int minX = std::max(tileX0, toPixel(std::min({t.x[0], t.x[1], t.x[2]}), mWidth)) & ~3;
+                        int maxX = std::min(tileX1, toPixel(std::max({t.x[0], t.x[1], t.x[2]}), mWidth));
+                        int minY = std::max(tileY0, toPixel(std::min({t.y[0], t.y[1], t.y[2]}), mHeight));
+                        int maxY = std::min(tileY1, toPixel(std::max({t.y[0], t.y[1], t.y[2]}), mHeight));
+                        if (minX > maxX || minY > maxY)
+                                continue;
+
+                        // edge k runs from vertex k to k + 1, E(x, y) = A x + B y + C
+                        float a[3], b[3], c[3];
+                        for (int k = 0; k < 3; ++k) {
+                                int l = (k + 1) % 3;
+                                a[k] = t.y[k] - t.y[l];
+                                b[k] = t.x[l] - t.x[k];
+                                c[k] = -(a[k] * t.x[k] + b[k] * t.y[k]);
+                        }
+
+                        // depth is linear in screen space after the divide
+                        float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+                        float dzdx = ((t.z[1] - t.z[0]) * (t.y[2] - t.y[0]) - (t.z[2] - t.z[0]) * (t.y[1] - t.y[0])) / area;
+                        float dzdy = ((t.z[2] - t.z[0]) * (t.x[1] - t.x[0]) - (t.z[1] - t.z[0]) * (t.x[2] - t.x[0])) / area;
+                        float z0 = t.z[0] - dzdx * t.x[0] - dzdy * t.y[0];
+
+                        for (int y = minY; y <= maxY; ++y) {
+                                float py = y + 0.5f;
+                                float* row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+                                float e0 = b[0] * py + c[0], e1 = b[1] * py + c[1], e2 = b[2] * py + c[2];
+                                float zy = z0 + dzdy * py;
+                                int x = minX;
+#ifdef __SSE__
+                                const __m128 zero = _mm_setzero_ps();
+                                const __m128 step = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+                                for (; x <= maxX; x += 4) {
+                                        __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), step);
+                                        __m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), _mm_set1_ps(e0));
+                                        __m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), _mm_set1_ps(e1));
+                                        __m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), _mm_set1_ps(e2));
+                                        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+                                        if (_mm_movemask_ps(inside) == 0)
+                                                continue;
+
+                                        __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(dzdx), px), _mm_set1_ps(zy));
+                                        __m128 depth = _mm_loadu_ps(row + x);
+                                        __m128 nearer = _mm_min_ps(depth, z);
+                                        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+                                }
+#endif
+                                for (; x <= maxX; ++x) {
+                                        float px = x + 0.5f;
+                                        if (a[0] * px + e0 < 0.0f || a[1] * px + e1 < 0.0f || a[2] * px + e2 < 0.0f)
+                                                continue;
+                                        row[x] = std::min(row[x], dzdx * px + zy);
+                                }
+                        }
+                }
+
+                // the farthest depth lets isVisible() skip tiles that hide everything behind them
+                float farthest = 0.0f;
+                for (int y = tileY0; y <= tileY1; ++y) {
+                        const float* row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+                        farthest = std::max(farthest, *std::max_element(row + tileX0, row + tileX1 + 1));
+                }
+                mTileMax[tile] = farthest;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        bool occlusion_buffer::isVisible(const glm::vec3& center, const glm::vec3& extents) const
+        {
+                float minX = static_cast<float>(mWidth), maxX = -1.0f;
+                float minY = static_cast<float>(mHeight), maxY = -1.0f;
+                float minZ = 1.0f;
+
+                for (int i = 0; i < 8; ++i) {
+                        glm::vec3 corner(i & 1 ? extents.x : -extents.x, i & 2 ? extents.y : -extents.y, i & 4 ? extents.z : -extents.z);
+                        glm::vec4 clip = mProjectionView * glm::vec4(center + corner, 1.0f);
+
+                        // reaches past the near plane, the projected rectangle would be wrong
+                        if (clip.z + clip.w < 0.0f || clip.w <= 1e-6f)
+                                return true;
+
+                        float x = (clip.x / clip.w * 0.5f + 0.5f) * mWidth;
+                        float y = (clip.y / clip.w * 0.5f + 0.5f) * mHeight;
+                        minX = std::min(minX, x);
+                        maxX = std::max(maxX, x);
+                        minY = std::min(minY, y);
+                        maxY = std::max(maxY, y);
+                        minZ = std::min(minZ, clip.z / clip.w * 0.5f + 0.5f);
+                }
+
+                if (maxX < 0.0f || maxY < 0.0f || minX >= mWidth || minY >= mHeight)
+                        return false;
+
+                int x0 = std::max(0, toPixel(minX, mWidth)), x1 = std::min(mWidth - 1, toPixel(maxX, mWidth));
+                int y0 = std::max(0, toPixel(minY, mHeight)), y1 = std::min(mHeight - 1, toPixel(maxY, mHeight));
+
+                for (int ty = y0 / OCCLUSION_TILE_HEIGHT; ty <= y1 / OCCLUSION_TILE_HEIGHT; ++ty) {
+                        for (int tx = x0 / OCCLUSION_TILE_WIDTH; tx <= x1 / OCCLUSION_TILE_WIDTH; ++tx) {
+                                if (mTileMax[ty * mTilesX + tx] < minZ)
+                                        continue;
+
+                                int px0 = std::max(x0, tx * OCCLUSION_TILE_WIDTH), px1 = std::min(x1, (tx + 1) * OCCLUSION_TILE_WIDTH - 1);
+                                int py0 = std::max(y0, ty * OCCLUSION_TILE_HEIGHT), py1 = std::min(y1, (ty + 1) * OCCLUSION_TILE_HEIGHT - 1);
+                                for (int y = py0; y <= py1; ++y) {
+                                        const float* row = mDepth.data() + static_cast<size_t>(y) * mWidth;
+                                        for (int x = px0; x <= px1; ++x)
+                                                if (row[x] >= minZ)
+                                                        return true;
+                                }
+                        }
+                }
+                return false;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t occlusion_buffer::test(const cull_set& set, std::vector<unsigned char>& visible) const
+        {
+                size_t count = 0;
+                for (size_t i = 0; i < set.size(); ++i) {
+                        if (visible[i] && !isVisible(set.getCenter(i), set.getExtents(i)))
+                                visible[i] = 0;
+                        count += visible[i];
+                }
+                return count;
+        }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "culling.h"
+#include "worker_pool.h"
+
+#include <glm/vec3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // a tile is rasterized by one thread, widths stay multiples of the 4 wide SIMD step
+        constexpr int OCCLUSION_TILE_WIDTH      = 64;
+        constexpr int OCCLUSION_TILE_HEIGHT     = 32;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // the meshes worth rasterizing: the largest boxes first, until the triangle budget is spent
+        std::vector<size_t> selectOccluders(const std::vector<bounds>& meshBounds, const std::vector<size_t>& triangles, size_t budget);
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // low resolution depth buffer rasterized on the CPU from a few large occluders,
+        // then used to reject boxes hidden behind them; depth is GL window depth, 1 is far
+        class occlusion_buffer
+        {
+                struct screen_triangle
+                {
+                        float x[3], y[3], z[3];
+                };
+
+                int mWidth, mHeight;
+                int mTilesX, mTilesY;
+                worker_pool* mWorkers;
+
+                glm::mat4 mProjectionView;
+                std::vector<float> mDepth;
+                std::vector<float> mTileMax;
+
+                std::vector<screen_triangle> mTriangles;
+                std::vector<std::vector<std::uint32_t>> mBins;
+
+                void clipTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+                void addTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+                void rasterizeTile(size_t tile);
+        public:
+                // the size is rounded up to whole tiles, without workers everything runs on the caller
+                occlusion_buffer(int width, int height, worker_pool* workers = nullptr);
+
+                // clears depth and occluders for a new view
+                void begin(const glm::mat4& projectionView);
+
+                // stride and offset in floats as in computeBounds, three indices per triangle
+                void addOccluder(const float* vertices, size_t stride, size_t offset,
+                                 const unsigned* indices, size_t count, const glm::mat4& model);
+
+                // bins the occluders by tile and rasterizes the tiles in parallel
+                void rasterize();
+
+                // conservative, true unless every pixel under the box is nearer than the box
+                bool isVisible(const glm::vec3& center, const glm::vec3& extents) const;
+
+                // clears visible[i] of the boxes found hidden, returns how many remain visible
+                size_t test(const cull_set& set, std::vector<unsigned char>& visible) const;
+
+                int getWidth() const                            { return mWidth; }
+                int getHeight() const                           { return mHeight; }
+                size_t getNumTriangles() const                  { return mTriangles.size(); }
+                const std::vector<float>& getDepth() const      { return mDepth; }
+        };
+}
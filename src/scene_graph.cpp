@@ -0,0 +1,74 @@
+#include "scene_graph.h"
+#include "error.h"
+
+#include <algorithm>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        int scene_graph::add(int parent, const glm::mat4& local)
+        {
+                int node = static_cast<int>(mParents.size());
+                if (parent != NO_PARENT && (parent < 0 || parent >= node))
+                        throw exception("al", "scene_graph", "add", "the parent of a node must be added before it", etype::unexpected);
+
+                mParents.push_back(parent);
+                mLocals.push_back(local);
+                mWorlds.push_back(local);
+                mDirty.push_back(1);
+                mFirstDirty = std::min(mFirstDirty, static_cast<size_t>(node));
+                return node;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void scene_graph::clear()
+        {
+                mParents.clear();
+                mLocals.clear();
+                mWorlds.clear();
+                mDirty.clear();
+                mFirstDirty = 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void scene_graph::reserve(size_t count)
+        {
+                mParents.reserve(count);
+                mLocals.reserve(count);
+                mWorlds.reserve(count);
+                mDirty.reserve(count);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void scene_graph::setLocal(int node, const glm::mat4& local)
+        {
+                mLocals[node] = local;
+                mDirty[node] = 1;
+                mFirstDirty = std::min(mFirstDirty, static_cast<size_t>(node));
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t scene_graph::update()
+        {
+                size_t n = mParents.size();
+                size_t updated = 0;
+
+                // a parent is visited before its children, so its dirty flag and
+                // world matrix are final by the time a child reads them
+                for (size_t i = mFirstDirty; i < n; ++i) {
+                        int parent = mParents[i];
+                        if (parent != NO_PARENT)
+                                mDirty[i] |= mDirty[parent];
+                        if (!mDirty[i])
+                                continue;
+
+                        mWorlds[i] = parent == NO_PARENT ? mLocals[i] : mWorlds[parent] * mLocals[i];
+                        ++updated;
+                }
+
+                std::fill(mDirty.begin() + std::min(mFirstDirty, n), mDirty.end(), 0);
+                mFirstDirty = n;
+                mUpdated += updated;
+                return updated;
+        }
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <glm/mat4x4.hpp>
+
+#include <cstddef>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        constexpr int NO_PARENT = -1;
+
+        ////////////////////////////////////////////////////////////////////////////////
+        // nodes are indices into parallel arrays and a parent is always added before its
+        // children, so world matrices are resolved in one forward pass without recursion
+        class scene_graph
+        {
+                std::vector<int> mParents;
+                std::vector<glm::mat4> mLocals;
+                std::vector<glm::mat4> mWorlds;
+                std::vector<unsigned char> mDirty;
+
+                // nodes before it are clean, update() starts here
+                size_t mFirstDirty = 0;
+                size_t mUpdated = 0;
+        public:
+                int add(int parent, const glm::mat4& local = glm::mat4(1.0f));
+
+                void clear();
+                void reserve(size_t count);
+
+                // marks the node and, through update(), its whole subtree
+                void setLocal(int node, const glm::mat4& local);
+
+                // recomputes the world matrices of dirty subtrees, returns how many changed
+                size_t update();
+
+                size_t size() const                             { return mParents.size(); }
+                bool isDirty() const                            { return mFirstDirty < mParents.size(); }
+
+                int getParent(int node) const                   { return mParents[node]; }
+                const glm::mat4& getLocal(int node) const       { return mLocals[node]; }
+                const glm::mat4& getWorld(int node) const       { return mWorlds[node]; }
+                const std::vector<glm::mat4>& getWorlds() const { return mWorlds; }
+
+                // world matrices recomputed by update() since the last reset
+                size_t getUpdated() const                       { return mUpdated; }
+                void resetUpdated()                             { mUpdated = 0; }
+        };
+}
@@ -0,0 +1,83 @@
+#include "task_queue.h"
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        task_queue::task_queue(unsigned threads, size_t limit)
+                : mLimit{limit}
+        {
+                mThreads.reserve(threads);
+                for (unsigned i = 0; i < threads; ++i)
+                        mThreads.emplace_back(&task_queue::loop, this);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        task_queue::~task_queue()
+        {
+                wait();
+                {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        mStop = true;
+                }
+                mWake.notify_all();
+                for (std::thread& thread : mThreads)
+                        thread.join();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void task_queue::loop()
+        {
+                for (;;) {
+                        std::function<void()> job;
+                        {
+                                std::unique_lock<std::mutex> lock(mMutex);
+                                mWake.wait(lock, [&] { return mStop || !mJobs.empty(); });
+                                if (mJobs.empty())
+                                        return;
+                                job = std::move(mJobs.front());
+                                mJobs.pop_front();
+                                ++mRunning;
+                        }
+                        // a slot freed up for a push() waiting on the limit
+                        mDone.notify_all();
+
+                        job();
+
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        --mRunning;
+                        if (mJobs.empty() && mRunning == 0)
+                                mDone.notify_all();
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void task_queue::push(std::function<void()> job)
+        {
+                if (mThreads.empty()) {
+                        job();
+                        return;
+                }
+
+                {
+                        std::unique_lock<std::mutex> lock(mMutex);
+                        if (mLimit)
+                                mDone.wait(lock, [&] { return mJobs.size() < mLimit; });
+                        mJobs.push_back(std::move(job));
+                }
+                mWake.notify_one();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void task_queue::wait()
+        {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mDone.wait(lock, [&] { return mJobs.empty() && mRunning == 0; });
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        size_t task_queue::getPending() const
+        {
+                std::lock_guard<std::mutex> lock(mMutex);
+                return mJobs.size() + mRunning;
+        }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "worker_pool.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // persistent threads running jobs the caller doesn't wait on, such as encoding and
+        // writing files while it goes on rendering; worker_pool is for the loops it waits on
+        class task_queue
+        {
+                std::vector<std::thread> mThreads;
+
+                mutable std::mutex mMutex;
+                std::condition_variable mWake;
+                std::condition_variable mDone;
+
+                std::deque<std::function<void()>> mJobs;
+                size_t mLimit;
+                size_t mRunning = 0;
+                bool mStop = false;
+
+                void loop();
+        public:
+                // 0 threads runs every job inside push(); a non-zero limit makes push() wait
+                // while that many jobs are queued, so a slow consumer bounds the memory held
+                explicit task_queue(unsigned threads = worker_pool::defaultThreads(), size_t limit = 0);
+
+                // finishes the queued jobs first
+                ~task_queue();
+
+                task_queue(const task_queue&) = delete;
+                task_queue& operator=(const task_queue&) = delete;
+
+                // jobs start in the order they were pushed and must not throw
+                void push(std::function<void()> job);
+
+                // returns once every job pushed so far has finished
+                void wait();
+
+                size_t getPending() const;
+                size_t size() const                             { return mThreads.size(); }
+        };
+}
@@ -0,0 +1,86 @@
+#include "worker_pool.h"
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        unsigned worker_pool::defaultThreads()
+        {
+                unsigned cores = std::thread::hardware_concurrency();
+                return cores > 1 ? cores - 1 : 0;
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        worker_pool::worker_pool(unsigned threads)
+        {
+                mThreads.reserve(threads);
+                for (unsigned i = 0; i < threads; ++i)
+                        mThreads.emplace_back(&worker_pool::loop, this);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        worker_pool::~worker_pool()
+        {
+                {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        mStop = true;
+                }
+                mWake.notify_all();
+                for (std::thread& thread : mThreads)
+                        thread.join();
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void worker_pool::work()
+        {
+                for (size_t i = mNext++; i < mCount; i = mNext++)
+                        (*mTask)(i);
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void worker_pool::loop()
+        {
+                std::uint64_t generation = 0;
+                for (;;) {
+                        {
+                                std::unique_lock<std::mutex> lock(mMutex);
+                                mWake.wait(lock, [&] { return mStop || mGeneration != generation; });
+                                if (mStop)
+                                        return;
+                                generation = mGeneration;
+                        }
+
+                        work();
+
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        if (--mBusy == 0)
+                                mDone.notify_one();
+                }
+        }
+
+        ////////////////////////////////////////////////////////////////////////////////
+        void worker_pool::run(size_t count, const std::function<void(size_t)>& task)
+        {
+                if (mThreads.empty() || count <= 1) {
+                        for (size_t i = 0; i < count; ++i)
+                                task(i);
+                        return;
+                }
+
+                {
+                        std::lock_guard<std::mutex> lock(mMutex);
+                        mTask = &task;
+                        mCount = count;
+                        mNext = 0;
+                        mBusy = mThreads.size();
+                        ++mGeneration;
+                }
+                mWake.notify_all();
+
+                work();
+
+                // workers read mTask until they leave work(), so it has to outlive them
+                std::unique_lock<std::mutex> lock(mMutex);
+                mDone.wait(lock, [&] { return mBusy == 0; });
+                mTask = nullptr;
+        }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace al
+{
+        ////////////////////////////////////////////////////////////////////////////////
+        // persistent threads for data parallel loops, the calling thread takes part too
+        class worker_pool
+        {
+                std::vector<std::thread> mThreads;
+
+                std::mutex mMutex;
+                std::condition_variable mWake;
+                std::condition_variable mDone;
+
+                const std::function<void(size_t)>* mTask = nullptr;
+                size_t mCount = 0;
+                std::atomic<size_t> mNext{0};
+                size_t mBusy = 0;
+                std::uint64_t mGeneration = 0;
+                bool mStop = false;
+
+                void loop();
+                void work();
+        public:
+                // 0 runs every task on the calling thread
+                explicit worker_pool(unsigned threads = defaultThreads());
+                ~worker_pool();
+
+                worker_pool(const worker_pool&) = delete;
+                worker_pool& operator=(const worker_pool&) = delete;
+
+                // calls task(i) for i in [0, count) and returns once all calls finished;
+                // tasks run concurrently and must not throw
+                void run(size_t count, const std::function<void(size_t)>& task);
+
+                size_t size() const                             { return mThreads.size(); }
+
+                static unsigned defaultThreads();
+        };
+}